@@ -0,0 +1,54 @@
+/* Workload for trace replays (sim.traceReplay = <dir>, see src/trace_frontend.h).
+ * Runs one thread per p0t<N>.trace in <dir>, each simulating trace N, all in
+ * the ROI. Usage: replay_host <dir>
+ */
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "zsim_hooks.h"
+
+#define MAX_TRACES 1024
+
+static pthread_barrier_t startBarrier;
+
+static void* replay(void* arg) {
+    pthread_barrier_wait(&startBarrier);
+    zsim_replay_thread((uint64_t)arg);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <trace dir>\n", argv[0]);
+        return 1;
+    }
+
+    DIR* dir = opendir(argv[1]);
+    if (!dir) {
+        perror(argv[1]);
+        return 1;
+    }
+    uint64_t traces[MAX_TRACES];
+    int n = 0;
+    struct dirent* d;
+    while ((d = readdir(dir)) && n < MAX_TRACES) {
+        unsigned long idx;
+        char end;
+        if (sscanf(d->d_name, "p0t%lu.trace%c", &idx, &end) == 1) traces[n++] = idx;
+    }
+    closedir(dir);
+    if (!n) {
+        fprintf(stderr, "No traces in %s\n", argv[1]);
+        return 1;
+    }
+    printf("Replaying %d traces from %s\n", n, argv[1]);
+
+    pthread_t threads[MAX_TRACES];
+    pthread_barrier_init(&startBarrier, NULL, n);
+    zsim_roi_begin();
+    for (int i = 0; i < n; i++) pthread_create(&threads[i], NULL, replay, (void*)traces[i]);
+    for (int i = 0; i < n; i++) pthread_join(threads[i], NULL);
+    zsim_roi_end();
+    return 0;
+}
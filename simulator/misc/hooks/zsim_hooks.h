@@ -14,6 +14,37 @@
 #define ZSIM_MAGIC_OP_HEARTBEAT         (1028)
 #define ZSIM_MAGIC_OP_WORK_BEGIN        (1029) //ubik
 #define ZSIM_MAGIC_OP_WORK_END          (1030) //ubik
+#define ZSIM_MAGIC_OP_PLACE_CORE        (1033)
+#define ZSIM_MAGIC_OP_PLACE_VAULT       (1034)
+#define ZSIM_MAGIC_OP_PLACE_INTERLEAVE  (1035)
+#define ZSIM_MAGIC_OP_ATOMIC_RANGE      (1036)
+#define ZSIM_MAGIC_OP_REPLAY_THREAD     (1037)
+
+// Data placement for PIM runs: map [start, start + size) to the vault of a
+// core, to a given vault, or interleave it over all vaults in target-byte
+// chunks (0 = cache line). Only Ramulator HMC memories honor placements.
+typedef struct {
+    uint64_t start;
+    uint64_t size;
+    uint64_t target;
+} zsim_placement_t;
+
+// Near-memory atomics: read-for-ownership misses to [start, start + size) are
+// executed in memory as the given HMC 2.x atomic, and their dirty write-backs
+// are dropped (memory already holds the result). Only Ramulator HMC memories
+// execute atomics; elsewhere the range is ignored.
+typedef enum {
+    ZSIM_ATOMIC_ADD8x2, ZSIM_ATOMIC_ADD16, ZSIM_ATOMIC_ADDS8Rx2, ZSIM_ATOMIC_ADDS16R,
+    ZSIM_ATOMIC_INC8, ZSIM_ATOMIC_BWR, ZSIM_ATOMIC_BWR8R, ZSIM_ATOMIC_SWAP16,
+    ZSIM_ATOMIC_CASEQ8, ZSIM_ATOMIC_CASZERO16, ZSIM_ATOMIC_EQ8,
+    ZSIM_ATOMIC_AND16, ZSIM_ATOMIC_OR16, ZSIM_ATOMIC_XOR16,
+} zsim_atomic_op_t;
+
+typedef struct {
+    uint64_t start;
+    uint64_t size;
+    uint64_t op;  // zsim_atomic_op_t
+} zsim_atomic_range_t;
 
 #ifdef __x86_64__
 #define HOOKS_STR  "HOOKS"
@@ -22,11 +53,21 @@ static inline void zsim_magic_op(uint64_t op) {
     __asm__ __volatile__("xchg %%rcx, %%rcx;" : : "c"(op));
     COMPILER_BARRIER();
 }
+
+static inline void zsim_magic_op_arg(uint64_t op, uint64_t arg) {
+    COMPILER_BARRIER();
+    __asm__ __volatile__("xchg %%rcx, %%rcx;" : : "c"(op), "d"(arg));
+    COMPILER_BARRIER();
+}
 #else
 #define HOOKS_STR  "NOP-HOOKS"
 static inline void zsim_magic_op(uint64_t op) {
     //NOP
 }
+
+static inline void zsim_magic_op_arg(uint64_t op, uint64_t arg) {
+    //NOP
+}
 #endif
 
 static inline void zsim_roi_begin() {
@@ -46,4 +87,32 @@ static inline void zsim_heartbeat() {
 static inline void zsim_work_begin() { zsim_magic_op(ZSIM_MAGIC_OP_WORK_BEGIN); }
 static inline void zsim_work_end() { zsim_magic_op(ZSIM_MAGIC_OP_WORK_END); }
 
+static inline void zsim_place(uint64_t op, const void* start, uint64_t size, uint64_t target) {
+    zsim_placement_t p = {(uint64_t)start, size, target};
+    zsim_magic_op_arg(op, (uint64_t)&p);
+}
+
+static inline void zsim_place_on_core(const void* start, uint64_t size, uint64_t core) {
+    zsim_place(ZSIM_MAGIC_OP_PLACE_CORE, start, size, core);
+}
+
+static inline void zsim_place_on_vault(const void* start, uint64_t size, uint64_t vault) {
+    zsim_place(ZSIM_MAGIC_OP_PLACE_VAULT, start, size, vault);
+}
+
+static inline void zsim_place_interleaved(const void* start, uint64_t size, uint64_t granularity) {
+    zsim_place(ZSIM_MAGIC_OP_PLACE_INTERLEAVE, start, size, granularity);
+}
+
+static inline void zsim_atomic_range(const void* start, uint64_t size, zsim_atomic_op_t op) {
+    zsim_atomic_range_t r = {(uint64_t)start, size, (uint64_t)op};
+    zsim_magic_op_arg(ZSIM_MAGIC_OP_ATOMIC_RANGE, (uint64_t)&r);
+}
+
+// Simulates captured trace idx (sim.traceReplay) on the calling thread, and
+// returns at its end. See replay_host.c
+static inline void zsim_replay_thread(uint64_t idx) {
+    zsim_magic_op_arg(ZSIM_MAGIC_OP_REPLAY_THREAD, idx);
+}
+
 #endif /*__ZSIM_HOOKS_H__*/
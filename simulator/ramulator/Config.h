@@ -145,6 +145,28 @@ public:
       return false;
     }
 
+    bool record_heatmap() const {
+      // the default value is false
+      if (options.find("heatmap") != options.end()) {
+        if ((options.find("heatmap"))->second == "on") {
+          return true;
+        }
+        return false;
+      }
+      return false;
+    }
+
+    bool vault_prefetch() const {
+      // the default value is false
+      if (options.find("vault_prefetch") != options.end()) {
+        if ((options.find("vault_prefetch"))->second == "on") {
+          return true;
+        }
+        return false;
+      }
+      return false;
+    }
+
     void set_application_name(const std::string& _application_name){
       application_name = _application_name;
     }
@@ -72,6 +72,15 @@ void Controller<TLDRAM>::tick(){
         }
     }
 
+    /*** 1.1. Serve completed writes ***/
+    if (pending_write.size()) {
+        Request& req = pending_write[0];
+        if (req.depart <= clk) {
+            req.callback(req);
+            pending_write.pop_front();
+        }
+    }
+
     /*** 2. Should we schedule refreshes? ***/
     refresh->tick_ref();
 
@@ -157,6 +166,8 @@ void Controller<TLDRAM>::tick(){
     }
     if (req->type == Request::Type::WRITE) {
         channel->update_serving_requests(req->addr_vec.data(), -1, clk);
+        req->depart = clk + channel->spec->write_latency;
+        pending_write.push_back(*req);
     }
 
     // remove request from queue
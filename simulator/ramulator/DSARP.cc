@@ -23,7 +23,7 @@ string DSARP::standard_name = "DSARP";
 
 map<string, enum DSARP::Org> DSARP::org_map = {
   {"DSARP_8Gb_x8", DSARP::Org::DSARP_8Gb_x8},
-  {"DSARP_16Gb_x9", DSARP::Org::DSARP_16Gb_x8},
+  {"DSARP_16Gb_x8", DSARP::Org::DSARP_16Gb_x8},
   {"DSARP_32Gb_x8", DSARP::Org::DSARP_32Gb_x8},
 };
 
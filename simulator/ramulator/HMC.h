@@ -128,7 +128,9 @@ public:
     /* Translate */
     Command translate[int(Request::Type::MAX)] = {
         Command::RD,  Command::WR,
-        Command::REF, Command::PDE, Command::SRE
+        Command::REF, Command::PDE, Command::SRE,
+        Command::ACT, // EXTENSION, unused
+        Command::RD   // ATOMIC reads the operand, the vault logic writes the result back
     };
 
     /* Prerequisite */
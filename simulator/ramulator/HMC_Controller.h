@@ -12,6 +12,7 @@
 #include "Scheduler.h"
 #include "HMC.h"
 #include "Packet.h"
+#include "VaultPrefetcher.h"
 
 using namespace std;
 
@@ -48,6 +49,13 @@ public:
     VectorStat* record_write_hits;
     VectorStat* record_write_misses;
     VectorStat* record_write_conflicts;
+
+    // Vault prefetcher, indexed by vault
+    VectorStat* vault_prefetch_issued;
+    VectorStat* vault_prefetch_hits;
+    VectorStat* vault_prefetch_late;
+    VectorStat* vault_prefetch_useless;
+    VectorStat* vault_prefetch_dropped;
     // DRAM power estimation statistics
 
     ScalarStat act_energy;
@@ -167,6 +175,7 @@ public:
     Queue writeq;  // queue for write requests
     Queue otherq;  // queue for all "other" requests (e.g., refresh)
     Queue overflow;
+    Queue prefetchq;  // vault prefetches not yet issued, see VaultPrefetcher.h
 
     deque<Request> pending;  // read requests that are about to receive data from DRAM
     deque<Request> pending_write;  //write requests that are about to receive data from DRAM
@@ -191,6 +200,11 @@ public:
     map<long, Packet> incoming_packets_buffer;
     bool pim_mode_enabled = false;
 
+    VaultPrefetcher* prefetcher = nullptr;
+    vector<int> prefetch_cols;
+
+    // Cycles the vault logic takes to compute an atomic once its operand is read
+    int atomic_latency = 4;
 
     /* Constructor */
     Controller(const Config& configs, DRAM<HMC>* channel) :
@@ -225,6 +239,14 @@ public:
         }
 
         pim_mode_enabled = configs.pim_mode_enabled();
+        if (configs.contains("atomic_latency")) {
+          atomic_latency = configs.get_int_value("atomic_latency");
+        }
+        if (configs.vault_prefetch()) {
+          // Memory<HMC> maps addresses at prefetch_size granularity, so this is the usable column count
+          prefetcher = new VaultPrefetcher(configs,
+              channel->spec->org_entry.count[int(HMC::Level::Column)] / channel->spec->prefetch_size);
+        }
         if (with_drampower) {
           // init DRAMPower stats
           act_energy
@@ -547,6 +569,7 @@ public:
         delete rowtable;
         delete channel;
         delete refresh;
+        delete prefetcher;
         cmd_trace_file.close();
     }
 
@@ -560,6 +583,13 @@ public:
         req.burst_count = 2; //TSV = 32 bytes, request = 64 bytes -> 2 bursts
 
       req.transaction_bytes = channel->spec->payload_flits * 16;
+      if (req.type == Request::Type::ATOMIC) {
+        // atomics operate on 16 bytes
+        req.burst_count = 1;
+        req.transaction_bytes = 16;
+      } else if (req.size) {
+        set_size(req);
+      }
       debug_hmc("req.reqid %d, req.coreid %d", req.reqid, req.coreid);
       incoming_packets_buffer[req.reqid] = packet;
       return enqueue(req);
@@ -569,10 +599,23 @@ public:
       req.burst_count = 2; //TSV = 32 bytes, request = 64 bytes -> 2 bursts
 
       req.transaction_bytes = channel->spec->payload_flits * 16;
+      if (req.type == Request::Type::ATOMIC) {
+        req.burst_count = 1;
+        req.transaction_bytes = 16;
+      } else if (req.size) {
+        set_size(req);
+      }
       debug_hmc("req.reqid %d, req.coreid %d", req.reqid, req.coreid);
       return enqueue(req);
     }
 
+    // Multi-line transaction: one burst per prefetch_size * channel_width bits
+    void set_size(Request& req) {
+      int burst_bytes = channel->spec->prefetch_size * channel->spec->channel_width / 8;
+      req.burst_count = max(1, req.size / burst_bytes);
+      req.transaction_bytes = req.size;
+    }
+
     void finish(long dram_cycles) {
       channel->finish(dram_cycles);
     }
@@ -582,6 +625,7 @@ public:
     {
         switch (int(type)) {
             case int(Request::Type::READ): return readq;
+            case int(Request::Type::ATOMIC): return readq;  // the read comes first
             case int(Request::Type::WRITE): return writeq;
             default: return otherq;
         }
@@ -589,6 +633,14 @@ public:
 
     bool enqueue(Request& req)
     {
+        if (prefetcher) {
+          if (req.type == Request::Type::READ && prefetch_demand(req)) {
+            return true;
+          } else if (req.type == Request::Type::WRITE || req.type == Request::Type::ATOMIC) {
+            prefetch_invalidate(req);
+          }
+        }
+
         Queue& queue = get_queue(req.type);
 
         if (queue.max == queue.size()){
@@ -597,6 +649,9 @@ public:
 
         req.arrive = clk;
         queue.q.push_back(req);
+        if (prefetcher && req.type == Request::Type::READ) {
+          prefetch_train(req);
+        }
         // shortcut for read requests, if a write to same addr exists
         // necessary for coherence
         if (req.type == Request::Type::READ && find_if(writeq.q.begin(), writeq.q.end(),
@@ -618,7 +673,10 @@ public:
       int tag = req_packet.header.TAG.value;
       int slid = req_packet.tail.SLID.value;
       int lng = req.type == Request::Type::WRITE ?
-                1 : 1 + channel->spec->payload_flits;
+                1 : 1 + (req.size ? req.size / 16 : channel->spec->payload_flits);
+      if (req.type == Request::Type::ATOMIC) {
+        lng = atomic_cmd_table[int(req.atomic_op)].response_flits;
+      }
       Packet::Command cmd = req_packet.header.CMD.value;
       Packet packet(Packet::Type::RESPONSE, cub, tag, lng, slid, cmd);
       packet.req = req;
@@ -649,13 +707,21 @@ public:
         if (pending.size()) {
           Request& req = pending[0];
           if (req.depart <= clk) {
-            if (req.depart - req.arrive > 1) {
+            if (!req.is_first_command) {  // not forwarded from the write queue or the prefetch buffer
               channel->update_serving_requests(req.addr_vec.data(), -1, clk);
             }
 
-            if(pim_mode_enabled){
+            if (req.is_prefetch) {
+                prefetch_fill(req);
+                pending.pop_front();
+            }
+            else if (req.is_internal) {
+                pending.pop_front();
+            }
+            else if(pim_mode_enabled){
                 req.depart_hmc = clk;
-                if (req.type == Request::Type::READ || req.type == Request::Type::WRITE) {
+                if (req.type == Request::Type::READ || req.type == Request::Type::WRITE
+                    || req.type == Request::Type::ATOMIC) {
                   req.callback(req);
                   pending.pop_front();
                }
@@ -691,6 +757,10 @@ public:
 
         auto req = scheduler->get_head(queue->q);
         if (req == queue->q.end() || !is_ready(req)) {
+          // no demand can go this cycle: use the open rows for prefetches
+          if (prefetcher && issue_prefetch()) {
+            return;
+          }
           if (!no_DRAM_latency) {
             // we couldn't find a command to schedule -- let's try to be speculative
             auto cmd = HMC::Command::PRE;
@@ -707,11 +777,13 @@ public:
         if (req->is_first_command) {
           req->is_first_command = false;
           int coreid = req->coreid;
-          if (req->type == Request::Type::READ || req->type == Request::Type::WRITE) {
+          req->queue_cycles = clk - req->arrive;
+          if (req->type == Request::Type::READ || req->type == Request::Type::WRITE
+              || req->type == Request::Type::ATOMIC) {
             channel->update_serving_requests(req->addr_vec.data(), 1, clk);
           }
-          if (req->type == Request::Type::READ) {
-            (*queueing_latency_sum) += clk - req->arrive;
+          if (req->type == Request::Type::READ || req->type == Request::Type::ATOMIC) {
+            if (req->type == Request::Type::READ) (*queueing_latency_sum) += clk - req->arrive;
             if (is_row_hit(req)) {
                 ++(*read_row_hits)[coreid];
                 ++(*row_hits);
@@ -765,6 +837,21 @@ public:
               req->depart = clk + channel->spec->write_latency;
               pending.push_back(*req);
             }
+        } else if (req->type == Request::Type::ATOMIC) {
+            // Respond once the vault logic has the result, and write it back behind the response
+            --req->burst_count;
+            if (req->burst_count == 0) {
+              req->depart = clk + channel->spec->read_latency + atomic_latency;
+              pending.push_back(*req);
+
+              Request wb = *req;
+              wb.type = Request::Type::WRITE;
+              wb.is_internal = true;
+              wb.is_first_command = true;
+              wb.burst_count = 1;
+              wb.arrive = clk;
+              writeq.q.push_back(wb);  // may exceed writeq.max, by at most the atomics in flight
+            }
         }
 
         // remove request from queue
@@ -833,6 +920,156 @@ public:
     }
 
 private:
+    int get_bank(const Request& req)
+    {
+        return req.addr_vec[int(HMC::Level::BankGroup)] * channel->spec->org_entry.count[int(HMC::Level::Bank)]
+            + req.addr_vec[int(HMC::Level::Bank)];
+    }
+
+    VaultPrefetcher::Entry* find_prefetch(const Request& req)
+    {
+        return prefetcher->find(get_bank(req), req.addr_vec[int(HMC::Level::Row)],
+            req.addr_vec[int(HMC::Level::Column)]);
+    }
+
+    void erase_queued_prefetch(const VaultPrefetcher::Entry* e)
+    {
+        for (auto it = prefetchq.q.begin(); it != prefetchq.q.end(); it++) {
+          if (find_prefetch(*it) == e) {
+            prefetchq.q.erase(it);
+            return;
+          }
+        }
+        assert(false);
+    }
+
+    // Serves a demand read from the prefetch buffer if possible. Returns true if the request was taken
+    bool prefetch_demand(Request& req)
+    {
+        VaultPrefetcher::Entry* e = find_prefetch(req);
+        if (!e) return false;
+        int vault = channel->id;
+        switch (e->state) {
+          case VaultPrefetcher::State::Ready:
+            ++(*vault_prefetch_hits)[vault];
+            prefetcher->release(e);
+            req.arrive = clk;
+            req.depart = clk + prefetcher->latency;
+            pending.push_back(req);
+            break;
+          case VaultPrefetcher::State::Inflight:
+            ++(*vault_prefetch_late)[vault];
+            req.arrive = clk;
+            e->waiters.push_back(req);
+            break;
+          case VaultPrefetcher::State::Queued:
+            // not issued yet, so the demand itself reads the line
+            ++(*vault_prefetch_late)[vault];
+            erase_queued_prefetch(e);
+            prefetcher->release(e);
+            return false;
+          default:
+            assert(false);
+        }
+        prefetch_train(req);
+        return true;
+    }
+
+    // A write makes a buffered copy stale
+    void prefetch_invalidate(const Request& req)
+    {
+        VaultPrefetcher::Entry* e = find_prefetch(req);
+        if (!e) return;
+        if (e->state == VaultPrefetcher::State::Queued) {
+          ++(*vault_prefetch_dropped)[channel->id];
+          erase_queued_prefetch(e);
+          prefetcher->release(e);
+        } else if (e->waiters.empty()) {
+          // an Inflight entry that has waiters is released when it fills
+          ++(*vault_prefetch_useless)[channel->id];
+          prefetcher->release(e);
+        }
+    }
+
+    void prefetch_train(const Request& req)
+    {
+        int bank = get_bank(req);
+        int row = req.addr_vec[int(HMC::Level::Row)];
+        prefetcher->train(req.coreid, bank, row, req.addr_vec[int(HMC::Level::Column)], prefetch_cols);
+        for (int col : prefetch_cols) {
+          if (prefetcher->find(bank, row, col)) continue;
+          bool useless;
+          if (!prefetcher->allocate(bank, row, col, clk, &useless)) {
+            ++(*vault_prefetch_dropped)[channel->id];
+            continue;
+          }
+          if (useless) ++(*vault_prefetch_useless)[channel->id];
+          Request pf = req;
+          pf.addr_vec[int(HMC::Level::Column)] = col;
+          pf.is_prefetch = true;
+          pf.is_first_command = true;
+          pf.arrive = clk;
+          prefetchq.q.push_back(pf);
+        }
+    }
+
+    // Issues one command for the oldest prefetch whose row is open. Prefetches whose bank has
+    // moved on to another row, or whose row no queued demand will open, are dropped
+    bool issue_prefetch()
+    {
+        auto pf = prefetchq.q.begin();
+        while (pf != prefetchq.q.end()) {
+          if (is_row_hit(pf)) break;
+          if (is_row_open(pf) || !row_demanded(*pf)) {
+            ++(*vault_prefetch_dropped)[channel->id];
+            prefetcher->release(find_prefetch(*pf));
+            pf = prefetchq.q.erase(pf);
+          } else {
+            pf++;  // the demand that opens this row has not been issued yet
+          }
+        }
+        if (pf == prefetchq.q.end() || !is_ready(pf)) return false;
+
+        if (pf->is_first_command) {
+          pf->is_first_command = false;
+          ++(*vault_prefetch_issued)[channel->id];
+          find_prefetch(*pf)->state = VaultPrefetcher::State::Inflight;
+          channel->update_serving_requests(pf->addr_vec.data(), 1, clk);
+        }
+        issue_cmd(get_first_cmd(pf), pf->addr_vec);
+        if (--pf->burst_count == 0) {
+          pf->depart = clk + channel->spec->read_latency;
+          pending.push_back(*pf);
+          prefetchq.q.erase(pf);
+        }
+        return true;
+    }
+
+    bool row_demanded(const Request& pf)
+    {
+        int bank = get_bank(pf);
+        int row = pf.addr_vec[int(HMC::Level::Row)];
+        return find_if(readq.q.begin(), readq.q.end(), [&](Request& req) {
+            return get_bank(req) == bank && req.addr_vec[int(HMC::Level::Row)] == row;
+          }) != readq.q.end();
+    }
+
+    void prefetch_fill(const Request& pf)
+    {
+        VaultPrefetcher::Entry* e = find_prefetch(pf);
+        if (!e || e->state != VaultPrefetcher::State::Inflight) return;  // invalidated by a write
+        if (e->waiters.empty()) {
+          e->state = VaultPrefetcher::State::Ready;
+          e->last_use = clk;
+          return;
+        }
+        for (Request& req : e->waiters) {
+          req.depart = clk + prefetcher->latency;
+          pending.push_back(req);
+        }
+        prefetcher->release(e);
+    }
+
     typename HMC::Command get_first_cmd(list<Request>::iterator req)
     {
         typename HMC::Command cmd = channel->spec->translate[int(req->type)];
@@ -2,12 +2,14 @@
 #define __HMC_MEMORY_H
 
 #include "HMC.h"
+#include "HeatMap.h"
 #include "LogicLayer.h"
 #include "LogicLayer.cc"
 #include "Memory.h"
 #include "Packet.h"
 #include "Statistics.h"
 #include <fstream>
+#include <map>
 
 using namespace std;
 
@@ -32,6 +34,7 @@ protected:
   ScalarStat num_dram_cycles;
   VectorStat num_read_requests;
   VectorStat num_write_requests;
+  VectorStat num_atomic_requests;
   ScalarStat ramulator_active_cycles;
   ScalarStat memory_footprint;
   VectorStat incoming_requests_per_channel;
@@ -45,6 +48,7 @@ protected:
   ScalarStat read_latency_avg;
   ScalarStat read_latency_ns_avg;
   ScalarStat read_latency_sum;
+  ScalarStat atomic_latency_sum;
   ScalarStat queueing_latency_avg;
   ScalarStat queueing_latency_ns_avg;
   ScalarStat queueing_latency_sum;
@@ -61,6 +65,7 @@ protected:
   ScalarStat row_hits;
   ScalarStat row_misses;
   ScalarStat row_conflicts;
+  ScalarStat placed_requests;
   VectorStat read_row_hits;
   VectorStat read_row_misses;
   VectorStat read_row_conflicts;
@@ -82,8 +87,16 @@ protected:
   VectorStat record_write_misses;
   VectorStat record_write_conflicts;
 
+  VectorStat vault_prefetch_issued;
+  VectorStat vault_prefetch_hits;
+  VectorStat vault_prefetch_late;
+  VectorStat vault_prefetch_useless;
+  VectorStat vault_prefetch_dropped;
+
   long mem_req_count = 0;
   bool num_cores;
+  HeatMap* heatmap = nullptr;
+  map<long, Placement> placements;  // keyed by start address
 public:
     long clk = 0;
     bool pim_mode_enabled = false;
@@ -206,6 +219,9 @@ public:
         if(configs.get_record_memory_trace()){
           this -> set_address_recorder();
         }
+        if (configs.record_heatmap()) {
+          heatmap = new HeatMap(configs, sz[int(HMC::Level::Vault)], configs.get_core_num());
+        }
 
         // regStats
         dram_capacity
@@ -235,6 +251,13 @@ public:
             .precision(0)
             ;
 
+        num_atomic_requests
+            .init(configs.get_core_num())
+            .name("atomic_requests")
+            .desc("Number of incoming atomic requests to DRAM")
+            .precision(0)
+            ;
+
         incoming_requests_per_channel
             .init(sz[int(HMC::Level::Vault)])
             .name("incoming_requests_per_channel")
@@ -292,6 +315,11 @@ public:
             .desc("The memory latency cycles (in memory time domain) sum for all read requests")
             .precision(0)
             ;
+        atomic_latency_sum
+            .name("atomic_latency_sum")
+            .desc("The memory latency cycles (in memory time domain) sum for all atomic requests, host mode only")
+            .precision(0)
+            ;
         read_latency_avg
             .name("read_latency_avg")
             .desc("The average memory latency cycles (in memory time domain) per request for all read requests")
@@ -377,6 +405,12 @@ public:
             .precision(0)
             ;
 
+        placed_requests
+            .name("placed_requests")
+            .desc("Number of requests sent to a vault chosen by a software placement")
+            .precision(0)
+            ;
+
         read_row_hits
             .init(configs.get_core_num())
             .name("read_row_hits")
@@ -484,6 +518,39 @@ public:
             .desc("record write conflict for this core when it reaches request limit or to the end")
             ;
 
+        if (configs.vault_prefetch()) {
+          vault_prefetch_issued
+              .init(sz[int(HMC::Level::Vault)])
+              .name("vault_prefetch_issued")
+              .desc("Number of prefetch reads issued by each vault prefetcher")
+              .precision(0)
+              ;
+          vault_prefetch_hits
+              .init(sz[int(HMC::Level::Vault)])
+              .name("vault_prefetch_hits")
+              .desc("Number of reads served from each vault's prefetch buffer")
+              .precision(0)
+              ;
+          vault_prefetch_late
+              .init(sz[int(HMC::Level::Vault)])
+              .name("vault_prefetch_late")
+              .desc("Number of reads to a line whose prefetch had not returned yet")
+              .precision(0)
+              ;
+          vault_prefetch_useless
+              .init(sz[int(HMC::Level::Vault)])
+              .name("vault_prefetch_useless")
+              .desc("Number of prefetched lines evicted or overwritten before use")
+              .precision(0)
+              ;
+          vault_prefetch_dropped
+              .init(sz[int(HMC::Level::Vault)])
+              .name("vault_prefetch_dropped")
+              .desc("Number of prefetches dropped before issue (row closed, buffer full or line written)")
+              .precision(0)
+              ;
+        }
+
         for (auto ctrl : ctrls) {
           ctrl->read_transaction_bytes = &read_transaction_bytes;
           ctrl->write_transaction_bytes = &write_transaction_bytes;
@@ -510,11 +577,18 @@ public:
           ctrl->record_write_hits = &record_write_hits;
           ctrl->record_write_misses = &record_write_misses;
           ctrl->record_write_conflicts = &record_write_conflicts;
+
+          ctrl->vault_prefetch_issued = &vault_prefetch_issued;
+          ctrl->vault_prefetch_hits = &vault_prefetch_hits;
+          ctrl->vault_prefetch_late = &vault_prefetch_late;
+          ctrl->vault_prefetch_useless = &vault_prefetch_useless;
+          ctrl->vault_prefetch_dropped = &vault_prefetch_dropped;
         }
     }
 
     ~Memory()
     {
+        delete heatmap;
         for (auto ctrl: ctrls)
             delete ctrl;
         delete spec;
@@ -545,6 +619,9 @@ public:
         for (auto logic_layer : logic_layers) {
           logic_layer->tick();
         }
+        if (heatmap) {
+          heatmap->tick(clk);
+        }
     }
 
     int assign_tag(int slid) {
@@ -573,10 +650,15 @@ public:
       Packet::Command cmd;
       switch (int(req.type)) {
         case int(Request::Type::READ):
-          cmd = read_cmd_map[lng];
+          cmd = read_cmd_map[req.size ? req.size / 16 : lng];
         break;
         case int(Request::Type::WRITE):
-          cmd = write_cmd_map[lng];
+          if (req.size) lng = 1 + req.size / 16;
+          cmd = write_cmd_map[req.size ? req.size / 16 : lng];
+        break;
+        case int(Request::Type::ATOMIC):
+          cmd = atomic_cmd_table[int(req.atomic_op)].cmd;
+          lng = atomic_cmd_table[int(req.atomic_op)].request_flits;
         break;
         default: assert(false);
       }
@@ -621,6 +703,10 @@ public:
       else if(req.type == Request::Type::WRITE){
         req.callback(req);
       }
+      else if (req.type == Request::Type::ATOMIC) {
+        atomic_latency_sum += req.depart_hmc - req.arrive_hmc;
+        req.callback(req);
+      }
     }
 
     bool send(Request req)
@@ -701,6 +787,7 @@ public:
           default:
               assert(false);
         }
+        bool placed = apply_placement(req);
 
         req.arrive_hmc = clk;
 
@@ -716,7 +803,7 @@ public:
 
             int hops = abs(vault_destination_x - vault_origin_x) + abs(vault_destination_y - vault_origin_y);
             if(!network_overhead) hops = 0;
-            if (req.type == Request::Type::READ){
+            if (req.type == Request::Type::READ || req.type == Request::Type::ATOMIC){
               // Let's assume 1 Flit = 128 bytes
               // A read request is 64 bytes
               // One read request will take = 1 Flit*hops + 5*hops
@@ -738,8 +825,13 @@ public:
             if (req.type == Request::Type::WRITE) {
                 ++num_write_requests[coreid];
             }
+            if (req.type == Request::Type::ATOMIC) {
+                ++num_atomic_requests[coreid];
+            }
             ++incoming_requests_per_channel[req.addr_vec[int(HMC::Level::Vault)]];
             ++mem_req_count;
+            if (placed) ++placed_requests;
+            record_heatmap(req);
 
             return true;
         }
@@ -761,8 +853,13 @@ public:
               if (req.type == Request::Type::WRITE) {
                 ++num_write_requests[coreid];
               }
+              if (req.type == Request::Type::ATOMIC) {
+                ++num_atomic_requests[coreid];
+              }
               ++incoming_requests_per_channel[req.addr_vec[int(HMC::Level::Vault)]];
               ++mem_req_count;
+              if (placed) ++placed_requests;
+              record_heatmap(req);
 
               return true;
             }
@@ -774,6 +871,16 @@ public:
         return true;
     }
 
+    bool supports_atomics()
+    {
+        return true;
+    }
+
+    int max_request_bytes()
+    {
+        return spec->maxblock_entry.max_block_size;
+    }
+
     int pending_requests()
     {
         int reqs = 0;
@@ -784,6 +891,9 @@ public:
 
     void finish() {
       std::cout << "[RAMULATOR] Gathering stats \n";
+      if (heatmap) {
+        heatmap->dump(clk);
+      }
 
       dram_capacity = max_address;
       int *sz = spec->org_entry.count;
@@ -867,7 +977,56 @@ public:
     }
 
 
+    // A range with the same start as an existing one replaces it; ranges are
+    // not expected to overlap otherwise
+    void add_placement(const Placement& placement) {
+      assert(placement.size > 0);
+      assert(placement.type != Placement::Type::Interleave || placement.target > 0);
+      placements[placement.start] = placement;
+    }
+
 private:
+    // Only the vault changes: the line keeps the bank, row and column of the
+    // default mapping, so lines from different vaults may share a DRAM row.
+    // Returns whether a placement applied; send() counts it once accepted.
+    bool apply_placement(Request& req) {
+      if (placements.empty()) {
+        return false;
+      }
+      auto it = placements.upper_bound(req._addr);
+      if (it == placements.begin()) {
+        return false;
+      }
+      const Placement& p = (--it)->second;
+      if (req._addr >= p.start + p.size) {
+        return false;
+      }
+
+      int vaults = spec->org_entry.count[int(HMC::Level::Vault)];
+      int vault = 0;
+      switch (p.type) {
+        case Placement::Type::Core:  // PIM cores sit one per vault, core i on vault i
+        case Placement::Type::Vault:
+          vault = p.target % vaults;
+          break;
+        case Placement::Type::Interleave:
+          vault = ((req._addr - p.start) / p.target) % vaults;
+          break;
+      }
+      req.addr_vec[int(HMC::Level::Vault)] = vault;
+      return true;
+    }
+
+    void record_heatmap(const Request& req) {
+      if (!heatmap) {
+        return;
+      }
+      int bank = req.addr_vec[int(HMC::Level::BankGroup)] * spec->org_entry.count[int(HMC::Level::Bank)]
+          + req.addr_vec[int(HMC::Level::Bank)];
+      heatmap->record(req.addr, req.coreid, req.addr_vec[int(HMC::Level::Vault)], bank,
+          req.addr_vec[int(HMC::Level::Row)]);
+    }
+
     int calc_log2(int val){
         int n = 0;
         while ((val >>= 1))
@@ -0,0 +1,206 @@
+#ifndef __HEATMAP_H
+#define __HEATMAP_H
+
+#include "Config.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace ramulator
+{
+
+/*
+ * Approximate access counts over a stream of keys: a depth x width matrix of
+ * counters, one hash function per row. An estimate is the minimum over the
+ * rows, so it can only overcount (by colliding keys), never undercount.
+ * Alongside, it keeps the topk keys with the largest estimates seen so far.
+ */
+class CountMinSketch
+{
+public:
+    struct Entry {
+        long key;
+        long count;
+    };
+
+    CountMinSketch(int depth, int width, int topk)
+        : depth(depth), width(width), counters(depth * width, 0), top(topk)
+    {
+        assert((width & (width - 1)) == 0);
+        width_bits = 0;
+        while ((1 << width_bits) < width)
+            width_bits++;
+        clear();
+    }
+
+    void add(long key, long weight)
+    {
+        long estimate = -1;
+        for (int d = 0; d < depth; d++) {
+            long& c = counters[d * width + hash(key, d)];
+            c += weight;
+            if (estimate < 0 || c < estimate) estimate = c;
+        }
+
+        // Keep the topk heaviest keys; the slot with the smallest estimate is replaced
+        int min_slot = 0;
+        for (int i = 0; i < int(top.size()); i++) {
+            if (top[i].key == key) {
+                top[i].count = estimate;
+                return;
+            }
+            if (top[i].count < top[min_slot].count) min_slot = i;
+        }
+        if (estimate > top[min_slot].count) top[min_slot] = {key, estimate};
+    }
+
+    const vector<Entry>& get_top() const { return top; }
+
+    void clear()
+    {
+        fill(counters.begin(), counters.end(), 0);
+        fill(top.begin(), top.end(), Entry{-1, 0});
+    }
+
+private:
+    int depth;
+    int width;
+    int width_bits;
+    vector<long> counters;
+    vector<Entry> top;
+
+    // Multiply-shift hashing, with a different odd multiplier per row
+    int hash(long key, int d) const
+    {
+        static const uint64_t mult[] = {
+            0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+            0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull,
+            0xff51afd7ed558ccdull, 0xc4ceb9fe1a85ec53ull,
+            0x94d049bb133111ebull, 0xbf58476d1ce4e5b9ull,
+        };
+        uint64_t h = (uint64_t(key) + d) * mult[d % 8];
+        return int(h >> (64 - width_bits));
+    }
+};
+
+/*
+ * Memory-side locality profile for data placement: per vault, the hottest
+ * pages and rows (sampled, count-min sketch + top-K), and an exact core x
+ * vault request matrix. Every interval memory cycles, the profile is
+ * appended to <application>.ramulator.heatmap and reset, so each block
+ * describes one interval.
+ *
+ * Config (all optional):
+ *   heatmap = on                 enable
+ *   heatmap_interval = 1000000   dump period, in memory cycles
+ *   heatmap_sample = 8           sketch 1 out of every N requests (weight N)
+ *   heatmap_topk = 8             hot pages/rows kept per vault
+ *   heatmap_width = 1024         counters per sketch row (power of 2)
+ *   heatmap_depth = 4            sketch rows (hash functions), at most 8
+ *   heatmap_page_size = 4096
+ */
+class HeatMap
+{
+public:
+    HeatMap(const Config& configs, int vaults, int cores)
+        : vaults(vaults), cores(cores),
+          core_vault(cores, vector<long>(vaults, 0))
+    {
+        interval = get_option(configs, "heatmap_interval", 1000000);
+        sample = get_option(configs, "heatmap_sample", 8);
+        int topk = get_option(configs, "heatmap_topk", 8);
+        int width = get_option(configs, "heatmap_width", 1024);
+        int depth = get_option(configs, "heatmap_depth", 4);
+        assert(interval > 0 && sample > 0 && depth > 0 && depth <= 8);
+        long page_size = get_option(configs, "heatmap_page_size", 4096);
+        page_bits = 0;
+        while ((1l << page_bits) < page_size)
+            page_bits++;
+
+        for (int v = 0; v < vaults; v++) {
+            pages.emplace_back(depth, width, topk);
+            rows.emplace_back(depth, width, topk);
+        }
+
+        out.open(configs.get_application_name() + ".ramulator.heatmap");
+        out << "# heatmap: interval " << interval << " cycles, 1/" << sample
+            << " requests sampled, top-" << topk << " per vault" << endl;
+    }
+
+    ~HeatMap()
+    {
+        out.close();
+    }
+
+    // bank is the flattened bank index within the vault
+    void record(long addr, int coreid, int vault, int bank, long row)
+    {
+        if (coreid >= 0 && coreid < cores) core_vault[coreid][vault]++;
+        if (++requests % sample) return;
+        pages[vault].add(addr >> page_bits, sample);
+        rows[vault].add((long(bank) << 32) | row, sample);
+    }
+
+    void tick(long clk)
+    {
+        if (clk - interval_start >= interval) dump(clk);
+    }
+
+    void dump(long clk)
+    {
+        out << "interval " << intervals++ << " cycles " << interval_start
+            << " " << clk << " requests " << requests << "\n";
+        for (int v = 0; v < vaults; v++) {
+            out << "vault " << v << " pages";
+            for (auto& e : pages[v].get_top())
+                if (e.key >= 0) out << " " << hex << (e.key << page_bits) << dec << ":" << e.count;
+            out << "\nvault " << v << " rows";
+            for (auto& e : rows[v].get_top())
+                if (e.key >= 0) out << " " << (e.key >> 32) << "/" << (e.key & 0xffffffffl) << ":" << e.count;
+            out << "\n";
+            pages[v].clear();
+            rows[v].clear();
+        }
+        for (int c = 0; c < cores; c++) {
+            out << "core " << c;
+            for (int v = 0; v < vaults; v++) {
+                out << " " << core_vault[c][v];
+                core_vault[c][v] = 0;
+            }
+            out << "\n";
+        }
+        out.flush();
+        requests = 0;
+        interval_start = clk;
+    }
+
+private:
+    int vaults;
+    int cores;
+    long interval;
+    long sample;
+    int page_bits;
+
+    long requests = 0;
+    long intervals = 0;
+    long interval_start = 0;
+
+    vector<CountMinSketch> pages;
+    vector<CountMinSketch> rows;
+    vector<vector<long>> core_vault;
+    ofstream out;
+
+    long get_option(const Config& configs, const string& name, long default_value)
+    {
+        return configs.contains(name) ? configs.get_int_value(name) : default_value;
+    }
+};
+
+} /*namespace ramulator*/
+
+#endif /*__HEATMAP_H*/
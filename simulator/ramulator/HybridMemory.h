@@ -0,0 +1,389 @@
+#ifndef __HYBRID_MEMORY_H
+#define __HYBRID_MEMORY_H
+
+#include "Config.h"
+#include "Memory.h"
+#include "Request.h"
+#include "Statistics.h"
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+namespace ramulator
+{
+
+/*
+ * Tiered main memory: a small fast tier (typically DRAM) in front of a large
+ * slow tier (typically an NVM such as PCM or STTMRAM).
+ *
+ * Pages are placed first-touch in the fast tier while it has free frames and
+ * in the slow tier afterwards. Every demand access bumps a saturating per-page
+ * counter. Every migration_epoch cycles, up to migrations_per_epoch slow-tier
+ * pages whose counter reached hot_threshold are swapped with the coldest
+ * fast-tier pages, and all counters are halved so hotness follows recent
+ * behavior.
+ *
+ * Migrations are real traffic: each line of both pages is read from its tier
+ * and written to the other one, competing with demand requests. Demand
+ * requests keep using the old location until both pages have been copied,
+ * then the mapping flips.
+ */
+class HybridMemory : public MemoryBase
+{
+protected:
+  ScalarStat fast_accesses;
+  ScalarStat slow_accesses;
+  ScalarStat fast_pages;
+  ScalarStat slow_pages;
+  ScalarStat migrations;
+  ScalarStat migration_bytes;
+  ScalarStat migration_epochs;
+
+  struct Page {
+    bool in_fast;
+    long frame;
+    unsigned count;
+    bool migrating;
+  };
+
+  // One page swap in flight: lines still to read, writes not yet acked
+  struct Migration {
+    long hot;   // slow -> fast
+    long cold;  // fast -> slow, -1 if the fast tier had a free frame
+    long hot_frame;  // fast frame the hot page moves into
+    int reads_left;
+    int writes_left;
+  };
+
+  struct LineMove {
+    int mig;
+    bool from_fast;
+    long src;
+    long dst;
+  };
+
+public:
+    MemoryBase* fast;
+    MemoryBase* slow;
+
+    HybridMemory(const Config& configs, MemoryBase* fast, MemoryBase* slow, int cacheline)
+        : fast(fast), slow(slow), line_size(cacheline)
+    {
+        page_bits = calc_log2(get_option(configs, "page_size", 4096));
+        assert((1l << page_bits) >= line_size);
+        fast_frames = (get_option(configs, "fast_capacity_mb", 64) << 20) >> page_bits;
+        assert(fast_frames > 0);
+        migration_epoch = get_option(configs, "migration_epoch", 100000);
+        if (migration_epoch <= 0) {
+            std::cerr << "Bad hybrid memory config: migration_epoch must be > 0 cycles, got " << migration_epoch << std::endl;
+            exit(1);
+        }
+        hot_threshold = get_option(configs, "hot_threshold", 64);
+        migrations_per_epoch = get_option(configs, "migrations_per_epoch", 16);
+        fast_owner.resize(fast_frames, -1);
+
+        fast_accesses
+            .name("hybrid_fast_accesses")
+            .desc("Number of demand requests served by the fast tier")
+            .precision(0)
+            ;
+        slow_accesses
+            .name("hybrid_slow_accesses")
+            .desc("Number of demand requests served by the slow tier")
+            .precision(0)
+            ;
+        fast_pages
+            .name("hybrid_fast_pages")
+            .desc("Number of pages resident in the fast tier")
+            .precision(0)
+            ;
+        slow_pages
+            .name("hybrid_slow_pages")
+            .desc("Number of pages resident in the slow tier")
+            .precision(0)
+            ;
+        migrations
+            .name("hybrid_migrations")
+            .desc("Number of completed hot/cold page swaps")
+            .precision(0)
+            ;
+        migration_bytes
+            .name("hybrid_migration_bytes")
+            .desc("Bytes moved between tiers by page migrations")
+            .precision(0)
+            ;
+        migration_epochs
+            .name("hybrid_migration_epochs")
+            .desc("Number of migration epochs evaluated")
+            .precision(0)
+            ;
+    }
+
+    ~HybridMemory()
+    {
+        delete fast;
+        delete slow;
+    }
+
+    double clk_ns()
+    {
+        return fast->clk_ns();
+    }
+
+    void tick()
+    {
+        clk++;
+        fast->tick();
+        // Tiers run on their own clocks; the fast tier sets the pace
+        slow_time += fast->clk_ns();
+        while (slow_time >= slow->clk_ns()) {
+            slow->tick();
+            slow_time -= slow->clk_ns();
+        }
+
+        issue_migration_traffic();
+
+        if (clk % migration_epoch == 0) {
+            migration_epochs++;
+            start_migrations();
+        }
+    }
+
+    bool send(Request req)
+    {
+        long page_id = req.addr >> page_bits;
+        auto it = pages.find(page_id);
+        if (it == pages.end()) {
+            it = pages.insert(make_pair(page_id, place(page_id))).first;
+        }
+        Page& page = it->second;
+
+        Request tier_req = req;
+        tier_req.addr = tier_addr(page.frame, req.addr);
+        long addr = req.addr;
+        auto callback = req.callback;
+        tier_req.callback = [addr, callback](Request& r) {
+            r.addr = addr;
+            r._addr = addr;
+            callback(r);
+        };
+
+        MemoryBase* tier = page.in_fast ? fast : slow;
+        if (!tier->send(tier_req)) {
+            return false;
+        }
+
+        if (page.in_fast) fast_accesses++;
+        else slow_accesses++;
+        if (page.count < max_count) page.count++;
+        return true;
+    }
+
+    int pending_requests()
+    {
+        return fast->pending_requests() + slow->pending_requests() +
+            pending_reads.size() + pending_writes.size();
+    }
+
+    void finish()
+    {
+        fast->finish();
+        slow->finish();
+    }
+
+    long page_allocator(long addr, int coreid)
+    {
+        return addr;
+    }
+
+    void record_core(int coreid)
+    {
+        fast->record_core(coreid);
+        slow->record_core(coreid);
+    }
+
+    void set_address_recorder() {}
+    void set_application_name(string _app) {}
+
+private:
+    int line_size;
+    int page_bits;
+    long fast_frames;
+    long migration_epoch;
+    unsigned hot_threshold;
+    unsigned migrations_per_epoch;
+    const unsigned max_count = 1 << 16;
+
+    long clk = 0;
+    double slow_time = 0;
+
+    map<long, Page> pages;
+    vector<long> fast_owner;  // page held by each fast frame, -1 if free
+    long fast_used = 0;
+    vector<long> free_slow_frames;
+    long next_slow_frame = 0;
+
+    int next_migration = 0;
+    map<int, Migration> inflight_migrations;
+    deque<LineMove> pending_reads;
+    deque<LineMove> pending_writes;
+
+    long get_option(const Config& configs, const string& name, long default_value)
+    {
+        return configs.contains(name) ? configs.get_int_value(name) : default_value;
+    }
+
+    long tier_addr(long frame, long addr)
+    {
+        return (frame << page_bits) | (addr & ((1l << page_bits) - 1));
+    }
+
+    long alloc_slow_frame()
+    {
+        if (free_slow_frames.empty()) return next_slow_frame++;
+        long frame = free_slow_frames.back();
+        free_slow_frames.pop_back();
+        return frame;
+    }
+
+    Page place(long page_id)
+    {
+        Page page = {false, -1, 0, false};
+        if (fast_used < fast_frames) {
+            page.in_fast = true;
+            page.frame = fast_used++;
+            fast_owner[page.frame] = page_id;
+            fast_pages++;
+        } else {
+            page.frame = alloc_slow_frame();
+            slow_pages++;
+        }
+        return page;
+    }
+
+    void start_migrations()
+    {
+        vector<pair<unsigned, long>> hot, cold;
+        for (auto& kv : pages) {
+            const Page& page = kv.second;
+            if (page.migrating) continue;
+            if (!page.in_fast && page.count >= hot_threshold) hot.push_back(make_pair(page.count, kv.first));
+            else if (page.in_fast) cold.push_back(make_pair(page.count, kv.first));
+        }
+        sort(hot.rbegin(), hot.rend());
+        sort(cold.begin(), cold.end());
+
+        unsigned budget = migrations_per_epoch - min<unsigned>(migrations_per_epoch, inflight_migrations.size());
+        long free_frames = fast_frames - fast_used;
+        unsigned c = 0;
+        for (unsigned h = 0; h < hot.size() && budget > 0; h++, budget--) {
+            long cold_page = -1;
+            if (free_frames > 0) {
+                free_frames--;
+            } else {
+                // Only swap if it actually moves a hotter page into the fast tier
+                if (c >= cold.size() || cold[c].first >= hot[h].first) break;
+                cold_page = cold[c++].second;
+            }
+            start_swap(hot[h].second, cold_page);
+        }
+
+        for (auto& kv : pages) kv.second.count >>= 1;
+    }
+
+    void start_swap(long hot_id, long cold_id)
+    {
+        int id = next_migration++;
+        Page& hot = pages[hot_id];
+        int lines = (1 << page_bits) / line_size;
+        long hot_dst = (cold_id == -1) ? fast_used : pages[cold_id].frame;
+        Migration mig = {hot_id, cold_id, hot_dst, 0, 0};
+
+        hot.migrating = true;
+        for (int l = 0; l < lines; l++) {
+            long offset = (long)l * line_size;
+            pending_reads.push_back({id, false, tier_addr(hot.frame, offset), tier_addr(hot_dst, offset)});
+        }
+        mig.reads_left += lines;
+        mig.writes_left += lines;
+
+        if (cold_id != -1) {
+            Page& cold = pages[cold_id];
+            cold.migrating = true;
+            for (int l = 0; l < lines; l++) {
+                long offset = (long)l * line_size;
+                pending_reads.push_back({id, true, tier_addr(cold.frame, offset), tier_addr(hot.frame, offset)});
+            }
+            mig.reads_left += lines;
+            mig.writes_left += lines;
+        } else {
+            // Reserve the free fast frame so no new page takes it meanwhile
+            fast_owner[fast_used++] = hot_id;
+        }
+        inflight_migrations[id] = mig;
+    }
+
+    void issue_migration_traffic()
+    {
+        // At most one read and one write per cycle, so demand traffic is not starved
+        if (!pending_reads.empty()) {
+            LineMove move = pending_reads.front();
+            Request req(move.src, Request::Type::READ,
+                [this, move](Request& r) {
+                    pending_writes.push_back(move);
+                    inflight_migrations[move.mig].reads_left--;
+                }, 0);
+            if ((move.from_fast ? fast : slow)->send(req)) pending_reads.pop_front();
+        }
+        if (!pending_writes.empty()) {
+            LineMove move = pending_writes.front();
+            Request req(move.dst, Request::Type::WRITE,
+                [this, move](Request& r) { line_written(move.mig); }, 0);
+            if ((move.from_fast ? slow : fast)->send(req)) pending_writes.pop_front();
+        }
+    }
+
+    void line_written(int id)
+    {
+        Migration& mig = inflight_migrations[id];
+        migration_bytes += line_size;
+        if (--mig.writes_left > 0 || mig.reads_left > 0) return;
+
+        Page& hot = pages[mig.hot];
+        long slow_frame = hot.frame;
+        hot.frame = mig.hot_frame;
+        fast_owner[mig.hot_frame] = mig.hot;
+        if (mig.cold == -1) {
+            free_slow_frames.push_back(slow_frame);
+            fast_pages++;
+            slow_pages--;
+        } else {
+            Page& cold = pages[mig.cold];
+            cold.frame = slow_frame;
+            cold.in_fast = false;
+            cold.migrating = false;
+        }
+        hot.in_fast = true;
+        hot.migrating = false;
+        migrations++;
+        inflight_migrations.erase(id);
+    }
+
+    int calc_log2(long val)
+    {
+        int n = 0;
+        while ((val >>= 1))
+            n++;
+        return n;
+    }
+};
+
+} /*namespace ramulator*/
+
+#endif /*__HYBRID_MEMORY_H*/
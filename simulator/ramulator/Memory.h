@@ -39,6 +39,12 @@ public:
     virtual void record_core(int coreid) = 0;
     virtual void set_address_recorder () = 0;
     virtual void set_application_name(string) = 0;
+    // Only memories with a notion of vault locality honor placements
+    virtual void add_placement(const Placement& placement) {}
+    // Whether send() takes Request::Type::ATOMIC
+    virtual bool supports_atomics() { return false; }
+    // Largest Request::size send() takes, 0 if requests can't be sized
+    virtual int max_request_bytes() { return 0; }
 };
 
 template <class T, template<typename> class Controller = Controller >
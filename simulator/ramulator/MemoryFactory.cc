@@ -4,6 +4,8 @@
 #include "WideIO2.h"
 #include "HBM.h"
 #include "SALP.h"
+#include "TLDRAM.h"
+#include "DSARP.h"
 
 using namespace ramulator;
 
@@ -66,6 +68,51 @@ MemoryBase *MemoryFactory<SALP>::create(const Config& configs, int cacheline) {
     return (MemoryBase *)populate_memory(configs, spec, channels, ranks);
 }
 
+template <>
+MemoryBase *MemoryFactory<TLDRAM>::create(const Config& configs, int cacheline) {
+    int channels = stoi(configs["channels"], NULL, 0);
+    int ranks = stoi(configs["ranks"], NULL, 0);
+    // TL-DRAM splits each subarray's bitlines into a near and a far segment;
+    // "subarrays" carries the far/near segment ratio of the config file
+    int segment_ratio = stoi(configs["subarrays"], NULL, 0);
+    validate(channels, ranks, configs);
+
+    const string& org_name = configs["org"];
+    const string& speed_name = configs["speed"];
+
+    TLDRAM *spec = new TLDRAM(org_name, speed_name, segment_ratio);
+
+    extend_channel_width(spec, cacheline);
+
+    return (MemoryBase *)populate_memory(configs, spec, channels, ranks);
+}
+
+static map<string, DSARP::Type> dsarp_name_to_type = {
+    {"REFAB", DSARP::Type::REFAB}, {"REFPB", DSARP::Type::REFPB},
+    {"DARP", DSARP::Type::DARP}, {"SARP", DSARP::Type::SARP},
+    {"DSARP", DSARP::Type::DSARP},
+};
+
+template <>
+MemoryBase *MemoryFactory<DSARP>::create(const Config& configs, int cacheline) {
+    int channels = stoi(configs["channels"], NULL, 0);
+    int ranks = stoi(configs["ranks"], NULL, 0);
+    int subarrays = stoi(configs["subarrays"], NULL, 0);
+    validate(channels, ranks, configs);
+
+    const string& org_name = configs["org"];
+    const string& speed_name = configs["speed"];
+    // refresh mechanism, see DSARP.h (defaults to the full DSARP scheme)
+    const string type_name = configs.contains("refresh_type") ? configs["refresh_type"] : "DSARP";
+    assert(dsarp_name_to_type.find(type_name) != dsarp_name_to_type.end() && "unrecognized DSARP refresh_type");
+
+    DSARP *spec = new DSARP(org_name, speed_name, dsarp_name_to_type[type_name], subarrays);
+
+    extend_channel_width(spec, cacheline);
+
+    return (MemoryBase *)populate_memory(configs, spec, channels, ranks);
+}
+
 template <>
 MemoryBase *MemoryFactory<HMC>::create(const Config& configs, int cacheline) {
     HMC* hmc = new HMC(configs["org"], configs["speed"], configs["maxblock"],
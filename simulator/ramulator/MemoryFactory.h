@@ -10,6 +10,8 @@
 #include "HMC_Memory.h"
 #include "WideIO2.h"
 #include "SALP.h"
+#include "TLDRAM.h"
+#include "DSARP.h"
 #include "HMC.h"
 #include <iostream>
 
@@ -82,6 +84,10 @@ template <>
 MemoryBase *MemoryFactory<WideIO2>::create(const Config& configs, int cacheline);
 template <>
 MemoryBase *MemoryFactory<SALP>::create(const Config& configs, int cacheline);
+template <>
+MemoryBase *MemoryFactory<TLDRAM>::create(const Config& configs, int cacheline);
+template <>
+MemoryBase *MemoryFactory<DSARP>::create(const Config& configs, int cacheline);
 
 
 } /*namespace ramulator*/
@@ -18,4 +18,16 @@ std::map<int, enum Packet::Command> read_cmd_map = {
   {16, Packet::Command::RD256},
 };
 
+// Operands ride in one data FLIT. Non-returning ops only get a write response
+Packet::AtomicCommand atomic_cmd_table[int(Request::AtomicOp::MAX)] = {
+  {Packet::Command::TWOADD8, 2, 1}, {Packet::Command::ADD16, 2, 1},
+  {Packet::Command::TWOADDS8R, 2, 2}, {Packet::Command::ADDS16R, 2, 2},
+  {Packet::Command::INC8, 1, 1},
+  {Packet::Command::BWR, 2, 1}, {Packet::Command::BWR8R, 2, 2},
+  {Packet::Command::SWAP16, 2, 2}, {Packet::Command::CASEQ8, 2, 2},
+  {Packet::Command::CASZERO16, 2, 2}, {Packet::Command::EQ8, 2, 1},
+  {Packet::Command::AND16, 2, 2}, {Packet::Command::OR16, 2, 2},
+  {Packet::Command::XOR16, 2, 2},
+};
+
 } /*namespace ramulator*/
@@ -36,9 +36,20 @@ class Packet {
     WR16, WR32, WR48, WR64, WR80, WR96, WR112, WR128, WR256,
     // READ Requests
     RD16, RD32, RD48, RD64, RD80, RD96, RD112, RD128, RD256,
+    // ATOMIC Requests (HMC 2.x), in Request::AtomicOp order
+    TWOADD8, ADD16, TWOADDS8R, ADDS16R, INC8,
+    BWR, BWR8R, SWAP16, CASEQ8, CASZERO16, EQ8,
+    AND16, OR16, XOR16,
     MAX
   };
 
+  // Command and packet lengths (in FLITs, header/tail included) of an atomic
+  struct AtomicCommand {
+    Command cmd;
+    int request_flits;
+    int response_flits;
+  };
+
   template<typename ValueType>
   struct Datafield {
     Datafield<ValueType>() {}
@@ -130,6 +141,8 @@ class Packet {
 extern std::map<int, enum Packet::Command> write_cmd_map;
 
 extern std::map<int, enum Packet::Command> read_cmd_map;
+
+extern Packet::AtomicCommand atomic_cmd_table[int(Request::AtomicOp::MAX)];
 } /*namespace ramulator*/
 
 #endif /*__PACKET_H*/
@@ -14,6 +14,12 @@
 #include "WideIO2.h"
 #include "HBM.h"
 #include "SALP.h"
+#include "ALDRAM.h"
+#include "TLDRAM.h"
+#include "DSARP.h"
+#include "PCM.h"
+#include "STTMRAM.h"
+#include "HybridMemory.h"
 
 using namespace ramulator;
 
@@ -25,23 +31,48 @@ static map<string, function<MemoryBase *(const Config&, int)> > name_to_func = {
     {"HBM", &MemoryFactory<HBM>::create},
     {"SALP-1", &MemoryFactory<SALP>::create}, {"SALP-2", &MemoryFactory<SALP>::create},
     {"SALP-MASA", &MemoryFactory<SALP>::create},{"HMC", &MemoryFactory<HMC>::create},
+    {"ALDRAM", &MemoryFactory<ALDRAM>::create}, {"TLDRAM", &MemoryFactory<TLDRAM>::create},
+    {"DSARP", &MemoryFactory<DSARP>::create},
+    {"PCM", &MemoryFactory<PCM>::create}, {"STTMRAM", &MemoryFactory<STTMRAM>::create},
 };
 
+// Tier configs of a Hybrid memory are looked up next to the Hybrid config
+static string tier_config_path(const string& config_path, const string& tier_path)
+{
+    if (tier_path.empty() || tier_path[0] == '/') return tier_path;
+    size_t slash = config_path.find_last_of('/');
+    if (slash == string::npos) return tier_path;
+    return config_path.substr(0, slash + 1) + tier_path;
+}
+
 RamulatorWrapper::RamulatorWrapper(const char* config_path, unsigned num_cpus, int cacheline, bool pim_mode, bool record_memory_trace, const char* application_name, bool networkOverhead)
 {
 
-    Config configs(config_path);
-    configs.set_core_num(num_cpus);
-    configs.set_pim_mode(pim_mode);
-    string app_name(application_name);
-    configs.set_network_overhead(networkOverhead);
+    auto load_config = [&](const string& path) {
+        Config configs(path);
+        configs.set_core_num(num_cpus);
+        configs.set_pim_mode(pim_mode);
+        string app_name(application_name);
+        configs.set_network_overhead(networkOverhead);
 
-    configs.set_application_name(app_name);
-    configs.set_record_memory_trace(record_memory_trace);
+        configs.set_application_name(app_name);
+        configs.set_record_memory_trace(record_memory_trace);
+        return configs;
+    };
+    auto create_memory = [&](const Config& configs) {
+        const string& std_name = configs["standard"];
+        assert(name_to_func.find(std_name) != name_to_func.end() && "unrecognized standard name");
+        return name_to_func[std_name](configs, cacheline);
+    };
 
-    const string& std_name = configs["standard"];
-    assert(name_to_func.find(std_name) != name_to_func.end() && "unrecognized standard name");
-    mem = name_to_func[std_name](configs, cacheline);
+    Config configs = load_config(config_path);
+    if (configs["standard"] == "Hybrid") {
+        Config fast_configs = load_config(tier_config_path(config_path, configs["fast_tier"]));
+        Config slow_configs = load_config(tier_config_path(config_path, configs["slow_tier"]));
+        mem = new HybridMemory(configs, create_memory(fast_configs), create_memory(slow_configs), cacheline);
+    } else {
+        mem = create_memory(configs);
+    }
     tCK = mem->clk_ns();
     std::cout << "[RAMULATOR] Initialized Ramulator" << std::endl;
 }
@@ -59,6 +90,18 @@ bool RamulatorWrapper::send(Request req) {
     return mem->send(req);
 }
 
+void RamulatorWrapper::add_placement(const Placement& placement) {
+    mem->add_placement(placement);
+}
+
+bool RamulatorWrapper::supports_atomics() {
+    return mem->supports_atomics();
+}
+
+int RamulatorWrapper::max_request_bytes() {
+    return mem->max_request_bytes();
+}
+
 void RamulatorWrapper::finish() {
   std::cout << "[RAMULATOR] Finished Ramulator" << std::endl;
   mem->finish();
@@ -11,6 +11,7 @@ namespace ramulator
 {
 
 class Request;
+struct Placement;
 class MemoryBase;
 
 class RamulatorWrapper
@@ -23,6 +24,9 @@ public:
     ~RamulatorWrapper();
     void tick();
     bool send(Request req);
+    void add_placement(const Placement& placement);
+    bool supports_atomics();
+    int max_request_bytes();
     void finish();
     double get_tCK();
 };
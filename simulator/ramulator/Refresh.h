@@ -76,6 +76,9 @@ public:
     clk++;
 
     int refresh_interval = ctrl->channel->spec->speed_entry.nREFI;
+    // Non-volatile standards (PCM, STTMRAM) set nREFI to 0: nothing to refresh
+    if (refresh_interval == 0)
+      return;
 
     // Time to schedule a refresh
     if ((clk - refreshed) >= refresh_interval) {
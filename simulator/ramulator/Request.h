@@ -29,16 +29,31 @@ public:
         POWERDOWN,
         SELFREFRESH,
         EXTENSION,
+        ATOMIC, // read-modify-write executed in memory, only HMC (see MemoryBase::supports_atomics)
         MAX
     } type;
 
+    // HMC 2.x atomic commands. The 2x variants operate on two 8-byte operands,
+    // and the R variants return the original data
+    enum class AtomicOp
+    {
+        ADD8x2, ADD16, ADDS8Rx2, ADDS16R, INC8,
+        BWR, BWR8R, SWAP16, CASEQ8, CASZERO16, EQ8,
+        AND16, OR16, XOR16,
+        MAX
+    } atomic_op = AtomicOp::ADD16;
+
     long arrive = -1;
     long depart;
     long arrive_hmc;
     long depart_hmc;
     unsigned hops = 0;
+    long queue_cycles = 0; // waiting in the controller queue, until its first command issued
     int burst_count = 0;
     int transaction_bytes = 0;
+    int size = 0; // bytes moved, for multi-line HMC transactions; 0 = the memory's default
+    bool is_prefetch = false; // issued by the vault prefetcher, see VaultPrefetcher.h
+    bool is_internal = false; // write-back of an atomic, generated in the vault; gets no response
     function<void(Request&)> callback; // call back with more info
 
 
@@ -56,6 +71,19 @@ public:
 
 };
 
+/*
+ * Software-directed data placement: maps [start, start + size) to a vault
+ * (or channel) chosen by the program instead of by the address mapping.
+ * Core places the range on the vault of a PIM core, Vault on an explicit
+ * vault, and Interleave spreads it over all vaults in target-byte chunks.
+ */
+struct Placement {
+    enum class Type { Core, Vault, Interleave } type;
+    long start;
+    long size;
+    long target;
+};
+
 } /*namespace ramulator*/
 
 #endif /*__REQUEST_H*/
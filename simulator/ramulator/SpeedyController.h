@@ -146,7 +146,7 @@ public:
 
         /*** 2. Should we schedule refreshes? ***/
         int refresh_interval = channel->spec->speed_entry.nREFI;
-        if (clk - refreshed >= refresh_interval) {
+        if (refresh_interval && clk - refreshed >= refresh_interval) {
             auto req_type = Request::Type::REFRESH;
             vector<int> addr_vec(int(T::Level::MAX), -1);
             addr_vec[0] = channel->id;
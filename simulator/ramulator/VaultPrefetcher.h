@@ -0,0 +1,155 @@
+#ifndef __VAULT_PREFETCHER_H
+#define __VAULT_PREFETCHER_H
+
+#include "Config.h"
+#include "Request.h"
+#include <cassert>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace ramulator
+{
+
+/*
+ * Vault-side stream buffer. Each vault controller tracks the column stride of
+ * every core's reads within a bank and row, and once a stride repeats, it
+ * pre-reads the next columns of the same row into a small SRAM buffer. Reads
+ * that hit the buffer skip the DRAM access. The controller only issues
+ * prefetches when no demand is ready, and only while their row is still open,
+ * so they use idle row-buffer bandwidth and never cost an activation.
+ *
+ * Lines are identified by (bank, row, column) within the vault, where bank is
+ * the flattened bank group/bank index. An entry is Queued until its read is
+ * issued, Inflight until the data returns, then Ready. A demand hit consumes
+ * the entry (the line moves to the core's cache). A demand to a Queued entry
+ * is late; it cancels the prefetch and goes to DRAM. A demand to an Inflight
+ * entry is also late; it waits for the prefetch to return.
+ *
+ * Config (all optional):
+ *   vault_prefetch = on            enable
+ *   vault_prefetch_entries = 16    buffer lines per vault
+ *   vault_prefetch_degree = 2      columns prefetched ahead per trigger
+ *   vault_prefetch_streams = 16    stream table entries (indexed by core)
+ *   vault_prefetch_latency = 2     memory cycles to serve a buffer hit
+ */
+class VaultPrefetcher
+{
+public:
+    enum class State { Invalid, Queued, Inflight, Ready };
+
+    struct Entry {
+        State state = State::Invalid;
+        int bank, row, col;
+        long last_use = 0;
+        vector<Request> waiters;
+    };
+
+    int degree;
+    int latency;
+
+    VaultPrefetcher(const Config& configs, int columns)
+        : columns(columns)
+    {
+        int entries = get_option(configs, "vault_prefetch_entries", 16);
+        int streams = get_option(configs, "vault_prefetch_streams", 16);
+        degree = get_option(configs, "vault_prefetch_degree", 2);
+        latency = get_option(configs, "vault_prefetch_latency", 2);
+        assert(entries > 0 && streams > 0 && degree > 0);
+        buffer.resize(entries);
+        table.resize(streams);
+    }
+
+    Entry* find(int bank, int row, int col)
+    {
+        for (auto& e : buffer)
+            if (e.state != State::Invalid && e.bank == bank && e.row == row && e.col == col)
+                return &e;
+        return nullptr;
+    }
+
+    // Finds a slot for a new prefetch: a free one, else the least recently
+    // filled Ready one. Sets *useless if that evicts an unused line
+    Entry* allocate(int bank, int row, int col, long clk, bool* useless)
+    {
+        Entry* victim = nullptr;
+        *useless = false;
+        for (auto& e : buffer) {
+            if (e.state == State::Invalid) {
+                victim = &e;
+                break;
+            }
+            if (e.state == State::Ready && (!victim || e.last_use < victim->last_use))
+                victim = &e;
+        }
+        if (!victim) return nullptr;
+        *useless = victim->state == State::Ready;
+        victim->state = State::Queued;
+        victim->bank = bank;
+        victim->row = row;
+        victim->col = col;
+        victim->last_use = clk;
+        victim->waiters.clear();
+        return victim;
+    }
+
+    void release(Entry* e)
+    {
+        e->state = State::Invalid;
+        e->waiters.clear();
+    }
+
+    // Trains core's stream on a demand read, and returns the columns to prefetch
+    // in the same row (cols is cleared first)
+    void train(int coreid, int bank, int row, int col, vector<int>& cols)
+    {
+        cols.clear();
+        Stream& s = table[(coreid < 0 ? 0 : coreid) % table.size()];
+        if (s.coreid != coreid) {
+            s = Stream();
+            s.coreid = coreid;
+        } else if (s.bank == bank && s.row == row) {
+            int stride = col - s.col;
+            if (!stride) return;  // same column (e.g., the other half of a line)
+            if (stride == s.stride) {
+                if (s.conf < 3) s.conf++;
+            } else {
+                s.stride = stride;
+                s.conf = 0;
+            }
+        }
+        // A stream that moves to a new row keeps its stride
+        s.bank = bank;
+        s.row = row;
+        s.col = col;
+
+        if (s.conf < 1) return;
+        for (int i = 1; i <= degree; i++) {
+            int c = col + i * s.stride;
+            if (c < 0 || c >= columns) break;
+            cols.push_back(c);
+        }
+    }
+
+private:
+    struct Stream {
+        int coreid = -1;
+        int bank = -1, row = -1, col = 0;
+        int stride = 0;
+        int conf = 0;
+    };
+
+    int columns;
+    vector<Entry> buffer;
+    vector<Stream> table;
+
+    long get_option(const Config& configs, const string& name, long default_value)
+    {
+        return configs.contains(name) ? configs.get_int_value(name) : default_value;
+    }
+};
+
+} /*namespace ramulator*/
+
+#endif /*__VAULT_PREFETCHER_H*/
@@ -34,7 +34,7 @@ AcceleratorCore::AcceleratorCore(FilterCache* _l1i, FilterCache* _l1d, uint32_t
     : Core(_name), l1i(_l1i), l1d(_l1d), instrs(0), curCycle(0), cRec(_domain, _name) {}
 
 uint64_t AcceleratorCore::getPhaseCycles() const {
-    return curCycle % zinfo->phaseLength;
+    return curCycle - zinfo->globPhaseCycles;
 }
 
 void AcceleratorCore::initStats(AggregateStat* parentStat) {
@@ -112,7 +112,7 @@ void AcceleratorCore::bblAndRecord(Address bblAddr, BblInfo* bblInfo) {
 }
 
 InstrFuncPtrs AcceleratorCore::GetFuncPtrs() {
-    return {LoadAndRecordFunc, StoreAndRecordFunc, BblAndRecordFunc, BranchFunc, PredLoadAndRecordFunc, PredStoreAndRecordFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, {0}};
+    return {LoadAndRecordFunc, StoreAndRecordFunc, BblAndRecordFunc, BranchFunc, PredLoadAndRecordFunc, PredStoreAndRecordFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, MemBatchFunc};
 }
 
 void AcceleratorCore::OffloadBegin(THREADID tid) {
@@ -121,6 +121,14 @@ void AcceleratorCore::OffloadBegin(THREADID tid) {
 void AcceleratorCore::OffloadEnd(THREADID tid) {
     static_cast<AcceleratorCore*>(cores[tid])->offloadFunction_end();
 }
+void AcceleratorCore::MemBatchFunc(THREADID tid, const BufferedAccess* accs, UINT32 n) {
+    AcceleratorCore* core = static_cast<AcceleratorCore*>(cores[tid]);
+    for (UINT32 i = 0; i < n; i++) {
+        if (accs[i].isStore) core->storeAndRecord(accs[i].addr, accs[i].size);
+        else core->loadAndRecord(accs[i].addr, accs[i].size);
+    }
+}
+
 void AcceleratorCore::LoadAndRecordFunc(THREADID tid, ADDRINT addr, UINT32 size) {
     static_cast<AcceleratorCore*>(cores[tid])->loadAndRecord(addr, size);
 }
@@ -134,7 +142,7 @@ void AcceleratorCore::BblAndRecordFunc(THREADID tid, ADDRINT bblAddr, BblInfo* b
     core->bblAndRecord(bblAddr, bblInfo);
 
     while (core->curCycle > core->phaseEndCycle) {
-        core->phaseEndCycle += zinfo->phaseLength;
+        core->phaseEndCycle += zinfo->nextPhaseLength;
         uint32_t cid = getCid(tid);
         uint32_t newCid = TakeBarrier(tid, cid);
         if (newCid != cid) break; /*context-switch*/
@@ -89,6 +89,7 @@ class AcceleratorCore : public Core {
         static void OffloadBegin(THREADID tid);
         static void OffloadEnd(THREADID tid);
 
+        static void MemBatchFunc(THREADID tid, const BufferedAccess* accs, UINT32 n);
         static void LoadAndRecordFunc(THREADID tid, ADDRINT addr, UINT32 size);
         static void StoreAndRecordFunc(THREADID tid, ADDRINT addr, UINT32 size);
         static void BblAndRecordFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo);
@@ -0,0 +1,131 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Correctness check and microbenchmark for SetAssocArray lookups. Whatever
+ * tag-search kernel this build uses (see findTag() in cache_arrays.cpp), every
+ * lookup is checked against a scalar search over a shadow copy of the tags.
+ * Then reports ns/lookup (without fills) for random, streaming and strided
+ * line address streams.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cache_arrays.h"
+#include "galloc.h"
+#include "hash.h"
+#include "log.h"
+#include "mtrand.h"
+#include "repl_policies.h"
+
+// LRU without a coherence controller (the array is used standalone)
+class StandaloneLRU : public ReplPolicy {
+    private:
+        uint64_t timestamp;
+        uint64_t* array;
+
+    public:
+        explicit StandaloneLRU(uint32_t numLines) : timestamp(1) {
+            array = gm_calloc<uint64_t>(numLines);
+        }
+
+        void update(uint32_t id, const MemReq* req) {array[id] = timestamp++;}
+        void replaced(uint32_t id) {array[id] = 0;}
+
+        template <typename C> inline uint32_t rank(const MemReq* req, C cands) {
+            uint32_t bestCand = *cands.begin();
+            for (auto ci = cands.begin(); ci != cands.end(); ci.inc()) {
+                if (array[*ci] < array[bestCand]) bestCand = *ci;
+            }
+            return bestCand;
+        }
+
+        DECL_RANK_BINDINGS;
+};
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static Address nextAddr(uint32_t stream, uint64_t i, MTRand& rnd, uint32_t footprintLines) {
+    switch (stream) {
+        case 0: return 1 + rnd.randInt(footprintLines - 1);   // random
+        case 1: return 1 + (i % footprintLines);               // stream
+        default: return 1 + ((i * 67) % footprintLines);       // strided (67 lines, ~4KB)
+    }
+}
+
+int main(int argc, char *argv[]) {
+    InitLog("[B] ");
+    uint64_t accesses = (argc > 1)? atol(argv[1]) : 4000000;
+    gm_init(256 << 20);
+
+    const uint32_t numLines = 1 << 16;  // 4MB of 64B lines
+    const uint32_t assocs[] = {4, 8, 16, 32};
+    const char* streamNames[] = {"random", "stream", "strided"};
+    info("%6s %8s %10s %12s", "ways", "stream", "hit rate", "ns/lookup");
+    for (uint32_t assoc : assocs) {
+        for (uint32_t stream = 0; stream < 3; stream++) {
+            uint32_t numSets = numLines/assoc;
+            HashFamily* hf = new H3HashFamily(1, ilog2(numSets), 0xCAC7EAFFA1);
+            SetAssocArray* array = new SetAssocArray(numLines, assoc, new StandaloneLRU(numLines), hf);
+            Address* shadow = gm_calloc<Address>(numLines);
+            MTRand rnd(42 + stream);
+            uint32_t footprintLines = numLines + numLines/2;  // 1.5x the array, so there are hits and misses
+
+            // Checked pass: fills the array and compares every lookup against a scalar search of the shadow tags
+            for (uint64_t i = 0; i < accesses/4; i++) {
+                Address lineAddr = nextAddr(stream, i, rnd, footprintLines);
+                uint32_t first = (hf->hash(0, lineAddr) & (numSets - 1))*assoc;
+                int32_t expected = -1;
+                for (uint32_t id = first; id < first + assoc; id++) {
+                    if (shadow[id] == lineAddr) {expected = id; break;}
+                }
+                int32_t id = array->lookup(lineAddr, nullptr, true);
+                if (id != expected) panic("Lookup mismatch: %d ways, line 0x%lx, got %d, expected %d", assoc, lineAddr, id, expected);
+                if (id == -1) {
+                    Address wbLineAddr;
+                    uint32_t cand = array->preinsert(lineAddr, nullptr, &wbLineAddr);
+                    if (wbLineAddr != shadow[cand]) panic("Victim mismatch at line %d", cand);
+                    array->postinsert(lineAddr, nullptr, cand);
+                    shadow[cand] = lineAddr;
+                }
+            }
+
+            // Timed pass: lookups only (no fills), so it measures hashing + tag search
+            uint64_t hits = 0;
+            double start = now();
+            for (uint64_t i = 0; i < accesses; i++) {
+                Address lineAddr = nextAddr(stream, i, rnd, footprintLines);
+                hits += (array->lookup(lineAddr, nullptr, true) != -1);
+            }
+            double ns = (now() - start)/accesses;
+            info("%6d %8s %9.1f%% %12.2f", assoc, streamNames[stream], 100.0*hits/accesses, ns);
+        }
+    }
+    return 0;
+}
@@ -59,6 +59,13 @@ void Cache::initCacheStats(AggregateStat* cacheStat) {
 }
 
 uint64_t Cache::access(MemReq& req) {
+    return accessImpl(req, array, cc);
+}
+
+/* Templated so StaticCache can instantiate it with final array and CC types, which turns every call below
+ * into a direct (mostly inlined) one; Cache instantiates it with the base types (virtual calls). */
+template <typename A, typename C>
+uint64_t Cache::accessImpl(MemReq& req, A* array, C* cc) {
     uint64_t respCycle = req.cycle;
     bool skipAccess = cc->startAccess(req); //may need to skip access due to races (NOTE: may change req.type!)
     if (likely(!skipAccess)) {
@@ -125,11 +132,16 @@ uint64_t Cache::access(MemReq& req) {
     return respCycle;
 }
 
-void Cache::startInvalidate() {
-    cc->startInv(); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
+void Cache::startInvalidate(Address lineAddr) {
+    cc->startInv(lineAddr); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
 }
 
 uint64_t Cache::finishInvalidate(const InvReq& req) {
+    return finishInvalidateImpl(req, array, cc);
+}
+
+template <typename A, typename C>
+uint64_t Cache::finishInvalidateImpl(const InvReq& req, A* array, C* cc) {
     int32_t lineId = array->lookup(req.lineAddr, nullptr, false);
     assert_msg(lineId != -1, "[%s] Invalidate on non-existing address 0x%lx type %s lineId %d, reqWriteback %d", name.c_str(), req.lineAddr, InvTypeName(req.type), lineId, *req.writeback);
     uint64_t respCycle = req.cycle + invLat;
@@ -139,3 +151,21 @@ uint64_t Cache::finishInvalidate(const InvReq& req) {
 
     return respCycle;
 }
+
+/* StaticCache */
+
+template <typename A, typename C>
+uint64_t StaticCache<A, C>::access(MemReq& req) {
+    return accessImpl(req, static_cast<A*>(array), static_cast<C*>(cc));
+}
+
+template <typename A, typename C>
+uint64_t StaticCache<A, C>::invalidate(const InvReq& req) {
+    static_cast<C*>(cc)->startInv(req.lineAddr);
+    return finishInvalidateImpl(req, static_cast<A*>(array), static_cast<C*>(cc));
+}
+
+template class StaticCache<StaticSetAssocArray<LRUReplPolicy<true>, IdHashFamily>, MESICC>;
+template class StaticCache<StaticSetAssocArray<LRUReplPolicy<true>, H3HashFamily>, MESICC>;
+template class StaticCache<StaticSetAssocArray<LRUReplPolicy<false>, IdHashFamily>, MESICC>;
+template class StaticCache<StaticSetAssocArray<LRUReplPolicy<false>, H3HashFamily>, MESICC>;
@@ -68,15 +68,33 @@ class Cache : public BaseCache {
 
         //NOTE: reqWriteback is pulled up to true, but not pulled down to false.
         virtual uint64_t invalidate(const InvReq& req) {
-            startInvalidate();
+            startInvalidate(req.lineAddr);
             return finishInvalidate(req);
         }
 
     protected:
         void initCacheStats(AggregateStat* cacheStat);
 
-        void startInvalidate(); // grabs cc's downLock
+        void startInvalidate(Address lineAddr); // grabs cc's downLock (for lineAddr's stripe)
         uint64_t finishInvalidate(const InvReq& req); // performs inv and releases downLock
+
+        template <typename A, typename C> uint64_t accessImpl(MemReq& req, A* array, C* cc);
+        template <typename A, typename C> uint64_t finishInvalidateImpl(const InvReq& req, A* array, C* cc);
+};
+
+/* Cache with its array (A) and coherence controller (C) types fixed at compile time. Both are final
+ * classes, so the access and invalidate pipelines make no virtual calls into them. BuildCacheBank uses it
+ * for the common Simple cache configurations (SetAssoc array, None/H3 hash, LRU, MESI), and the generic
+ * Cache for everything else. Instantiated in cache.cpp.
+ */
+template <typename A, typename C>
+class StaticCache final : public Cache {
+    public:
+        StaticCache(uint32_t _numLines, C* _cc, A* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, bool _bypass, const g_string& _name)
+            : Cache(_numLines, _cc, _array, _rp, _accLat, _invLat, _bypass, _name) {}
+
+        uint64_t access(MemReq& req);
+        uint64_t invalidate(const InvReq& req);
 };
 
 #endif  // CACHE_H_
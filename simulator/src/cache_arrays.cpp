@@ -25,12 +25,55 @@
 
 #include "cache_arrays.h"
 #include "hash.h"
+#include "pad.h"
 #include "repl_policies.h"
 
+#if !defined(ZSIM_SCALAR_TAGS) && (defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#endif
+
+/* Returns the position of the first of the n tags equal to lineAddr, or -1. Compares a vector of tags at a
+ * time; the widest kernel the target ISA supports is picked at build time (scons --march, SSE2 for the
+ * default core2). Build with -DZSIM_SCALAR_TAGS for the plain loop. All kernels return the same position.
+ */
+static inline int32_t findTag(const Address* tags, uint32_t n, Address lineAddr) {
+    uint32_t i = 0;
+#if defined(ZSIM_SCALAR_TAGS)
+#elif defined(__AVX512F__)
+    __m512i key = _mm512_set1_epi64(lineAddr);
+    for (; i + 8 <= n; i += 8) {
+        __mmask8 m = _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(tags + i), key);
+        if (m) return i + __builtin_ctz(m);
+    }
+#elif defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x(lineAddr);
+    for (; i + 4 <= n; i += 4) {
+        __m256i eq = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(tags + i)), key);
+        uint32_t m = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+        if (m) return i + __builtin_ctz(m);
+    }
+#elif defined(__SSE2__)
+    __m128i key = _mm_set1_epi64x(lineAddr);
+    for (; i + 2 <= n; i += 2) {
+        // No 64-bit compare before SSE4.1: a 64-bit lane matches if both of its 32-bit halves do
+        __m128i eq32 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(tags + i)), key);
+        __m128i eq = _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+        uint32_t m = _mm_movemask_pd(_mm_castsi128_pd(eq));
+        if (m) return i + __builtin_ctz(m);
+    }
+#endif
+    for (; i < n; i++) {
+        if (tags[i] == lineAddr) return i;
+    }
+    return -1;
+}
+
 /* Set-associative array implementation */
 
 SetAssocArray::SetAssocArray(uint32_t _numLines, uint32_t _assoc, ReplPolicy* _rp, HashFamily* _hf) : rp(_rp), hf(_hf), numLines(_numLines), assoc(_assoc)  {
-    array = gm_calloc<Address>(numLines);
+    // Sets are contiguous; cache line-aligned so that sets of 8+ ways don't straddle lines
+    array = gm_memalign<Address>(CACHE_LINE_BYTES, numLines);
+    memset(array, 0, numLines*sizeof(Address));
     numSets = numLines/assoc;
     setMask = numSets - 1;
     assert_msg(isPow2(numSets), "must have a power of 2 # sets, but you specified %d", numSets);
@@ -39,13 +82,15 @@ SetAssocArray::SetAssocArray(uint32_t _numLines, uint32_t _assoc, ReplPolicy* _r
 int32_t SetAssocArray::lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) {
     uint32_t set = hf->hash(0, lineAddr) & setMask;
     uint32_t first = set*assoc;
-    for (uint32_t id = first; id < first + assoc; id++) {
-        if (array[id] ==  lineAddr) {
-            if (updateReplacement) rp->update(id, req);
-            return id;
-        }
-    }
-    return -1;
+    int32_t way = findTag(&array[first], assoc, lineAddr);
+    if (way == -1) return -1;
+    uint32_t id = first + way;
+    if (updateReplacement) rp->update(id, req);
+    return id;
+}
+
+uint32_t SetAssocArray::getSet(const Address lineAddr) {
+    return hf->hash(0, lineAddr) & setMask;
 }
 
 uint32_t SetAssocArray::preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr) { //TODO: Give out valid bit of wb cand?
@@ -64,6 +109,43 @@ void SetAssocArray::postinsert(const Address lineAddr, const MemReq* req, uint32
     rp->update(candidate, req);
 }
 
+/* Same as SetAssocArray, with qualified (non-virtual) calls on the concrete policy and hash */
+
+template <typename R, typename H>
+int32_t StaticSetAssocArray<R, H>::lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) {
+    uint32_t set = static_cast<H*>(hf)->H::hash(0, lineAddr) & setMask;
+    uint32_t first = set*assoc;
+    int32_t way = findTag(&array[first], assoc, lineAddr);
+    if (way == -1) return -1;
+    uint32_t id = first + way;
+    if (updateReplacement) static_cast<R*>(rp)->R::update(id, req);
+    return id;
+}
+
+template <typename R, typename H>
+uint32_t StaticSetAssocArray<R, H>::preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr) {
+    uint32_t set = static_cast<H*>(hf)->H::hash(0, lineAddr) & setMask;
+    uint32_t first = set*assoc;
+
+    uint32_t candidate = static_cast<R*>(rp)->R::rank(req, SetAssocCands(first, first+assoc));
+
+    *wbLineAddr = array[candidate];
+    return candidate;
+}
+
+template <typename R, typename H>
+void StaticSetAssocArray<R, H>::postinsert(const Address lineAddr, const MemReq* req, uint32_t candidate) {
+    R* r = static_cast<R*>(rp);
+    r->R::replaced(candidate);
+    array[candidate] = lineAddr;
+    r->R::update(candidate, req);
+}
+
+template class StaticSetAssocArray<LRUReplPolicy<true>, IdHashFamily>;
+template class StaticSetAssocArray<LRUReplPolicy<true>, H3HashFamily>;
+template class StaticSetAssocArray<LRUReplPolicy<false>, IdHashFamily>;
+template class StaticSetAssocArray<LRUReplPolicy<false>, H3HashFamily>;
+
 
 /* ZCache implementation */
 
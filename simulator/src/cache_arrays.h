@@ -71,6 +71,25 @@ class SetAssocArray : public CacheArray {
         int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement);
         uint32_t preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr);
         void postinsert(const Address lineAddr, const MemReq* req, uint32_t candidate);
+
+        // Set of lineAddr, for controllers that lock by set (see MESICC::setLockStripes)
+        uint32_t getSet(const Address lineAddr);
+        uint32_t getAssoc() const {return assoc;}
+};
+
+/* SetAssocArray with the replacement policy (R) and hash (H) types fixed at compile time, so the hash,
+ * update and rank calls on every access are direct and get inlined. Final, so callers holding a
+ * StaticSetAssocArray* (see StaticCache) skip the virtual calls into the array too. Only the combinations
+ * instantiated in cache_arrays.cpp exist; BuildCacheBank falls back to SetAssocArray for everything else.
+ */
+template <typename R, typename H>
+class StaticSetAssocArray final : public SetAssocArray {
+    public:
+        StaticSetAssocArray(uint32_t _numLines, uint32_t _assoc, R* _rp, H* _hf) : SetAssocArray(_numLines, _assoc, _rp, _hf) {}
+
+        int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement);
+        uint32_t preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr);
+        void postinsert(const Address lineAddr, const MemReq* req, uint32_t candidate);
 };
 
 /* The cache array that started this simulator :) */
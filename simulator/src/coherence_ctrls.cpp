@@ -27,6 +27,28 @@
 #include "cache.h"
 #include "network.h"
 
+/* CCLocks implementation */
+
+void CCLocks::initStats(AggregateStat* parentStat, const char* name, const char* desc) {
+    AggregateStat* lockStats = new AggregateStat();
+    lockStats->init(name, desc);
+    auto acquiresStat = makeLambdaStat([this]() { return total(&Stripe::acquires); });
+    acquiresStat->init("acquires", "Lock acquires");
+    lockStats->append(acquiresStat);
+    auto contendedStat = makeLambdaStat([this]() { return total(&Stripe::contended); });
+    contendedStat->init("contended", "Lock acquires that had to wait");
+    lockStats->append(contendedStat);
+    auto waitStat = makeLambdaStat([this]() { return total(&Stripe::waitCycles); });
+    waitStat->init("waitCycles", "Host cycles (rdtsc) waiting for the lock");
+    lockStats->append(waitStat);
+    if (isStriped()) {
+        auto stripeStat = makeLambdaVectorStat([this](uint32_t i) { return stripes[i].contended; }, numStripes);
+        stripeStat->init("stripeContended", "Contended acquires per lock stripe");
+        lockStats->append(stripeStat);
+    }
+    parentStat->append(lockStats);
+}
+
 /* Do a simple XOR block hash on address to determine its bank. Hacky for now,
  * should probably have a class that deals with this with a real hash function
  * (TODO)
@@ -67,13 +89,13 @@ uint64_t MESIBottomCC::processEviction(Address wbLineAddr, uint32_t lineId, bool
         case S:
         case E:
             {
-                MemReq req = {wbLineAddr, PUTS, selfId, state, cycle, &ccLock, *state, srcId, 0 /*no flags*/};
+                MemReq req = {wbLineAddr, PUTS, selfId, state, cycle, locks.lineLock(lineId), *state, srcId, 0 /*no flags*/, 0 /*no pc*/};
                 respCycle = parents[getParentId(wbLineAddr)]->access(req);
             }
             break;
         case M:
             {
-                MemReq req = {wbLineAddr, PUTX, selfId, state, cycle, &ccLock, *state, srcId, 0 /*no flags*/};
+                MemReq req = {wbLineAddr, PUTX, selfId, state, cycle, locks.lineLock(lineId), *state, srcId, 0 /*no flags*/, 0 /*no pc*/};
                 respCycle = parents[getParentId(wbLineAddr)]->access(req);
             }
             break;
@@ -84,25 +106,25 @@ uint64_t MESIBottomCC::processEviction(Address wbLineAddr, uint32_t lineId, bool
     return respCycle;
 }
 
-uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags) {
+uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags, Address pc) {
     uint64_t respCycle = cycle;
     MESIState* state = &array[lineId];
 
     if(bypass){
         uint32_t parentId = getParentId(lineAddr);
-        MemReq req = {lineAddr, type, selfId, state , cycle, &ccLock, *state, srcId, flags};
+        MemReq req = {lineAddr, type, selfId, state , cycle, locks.lineLock(lineId), *state, srcId, flags, pc};
         return parents[parentId]->access(req); // We send the request to the next level
     }
 
     if(*state == S){
-      sharedRequests.inc();
+      count(sharedRequests);
     }
 
     switch (type) {
         // A PUTS/PUTX does nothing w.r.t. higher coherence levels --- it dies here
         case PUTS: //Clean writeback, nothing to do (except profiling)
             assert(*state != I);
-            profPUTS.inc();
+            count(profPUTS);
             break;
         case PUTX: //Dirty writeback
             assert(*state == M || *state == E);
@@ -110,34 +132,34 @@ uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessTy
                 //Silent transition, record that block was written to
                 *state = M;
             }
-            profPUTX.inc();
+            count(profPUTX);
             break;
         case GETS:
             if (*state == I) {
                 uint32_t parentId = getParentId(lineAddr);
-                MemReq req = {lineAddr, GETS, selfId, state, cycle, &ccLock, *state, srcId, flags};
+                MemReq req = {lineAddr, GETS, selfId, state, cycle, locks.lineLock(lineId), *state, srcId, flags, pc};
                 uint32_t nextLevelLat = parents[parentId]->access(req) - cycle;
                 uint32_t netLat = (network)? network->getRTT(cycle, nextLevelLat, name.c_str(), parents[parentId]->getName()) : 0;
-                profGETNextLevelLat.inc(nextLevelLat);
-                profGETNetLat.inc(netLat);
+                count(profGETNextLevelLat, nextLevelLat);
+                count(profGETNetLat, netLat);
                 respCycle += nextLevelLat + netLat;
-                profGETSMiss.inc();
+                count(profGETSMiss);
                 assert(*state == S || *state == E);
             } else {
-                profGETSHit.inc();
+                count(profGETSHit);
             }
             break;
         case GETX:
             if (*state == I || *state == S) {
                 //Profile before access, state changes
-                if (*state == I) profGETXMissIM.inc();
-                else profGETXMissSM.inc();
+                if (*state == I) count(profGETXMissIM);
+                else count(profGETXMissSM);
                 uint32_t parentId = getParentId(lineAddr);
-                MemReq req = {lineAddr, GETX, selfId, state, cycle, &ccLock, *state, srcId, flags};
+                MemReq req = {lineAddr, GETX, selfId, state, cycle, locks.lineLock(lineId), *state, srcId, flags, pc};
                 uint32_t nextLevelLat = parents[parentId]->access(req) - cycle;
                 uint32_t netLat = (network)? network->getRTT(cycle, nextLevelLat, name.c_str(), parents[parentId]->getName()) : 0;
-                profGETNextLevelLat.inc(nextLevelLat);
-                profGETNetLat.inc(netLat);
+                count(profGETNextLevelLat, nextLevelLat);
+                count(profGETNetLat, netLat);
                 respCycle += nextLevelLat + netLat;
             } else {
                 if (*state == E) {
@@ -150,7 +172,7 @@ uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessTy
                      */
                     *state = M;
                 }
-                profGETXHit.inc();
+                count(profGETXHit);
             }
             assert_msg(*state == M, "Wrong final state on GETX, lineId %d numLines %d, finalState %s", lineId, numLines, MESIStateName(*state));
             break;
@@ -179,17 +201,17 @@ void MESIBottomCC::processInval(Address lineAddr, uint32_t lineId, InvType type,
             assert_msg(*state == E || *state == M, "Invalid state %s", MESIStateName(*state));
             if (*state == M) *reqWriteback = true;
             *state = S;
-            profINVX.inc();
+            count(profINVX);
             break;
         case INV: //invalidate
             assert(*state != I);
             if (*state == M) *reqWriteback = true;
             *state = I;
-            profINV.inc();
+            count(profINV);
             break;
         case FWD: //forward
             assert_msg(*state == S, "Invalid state %s on FWD", MESIStateName(*state));
-            profFWD.inc();
+            count(profFWD);
             break;
         default: panic("!?");
     }
@@ -201,7 +223,7 @@ uint64_t MESIBottomCC::processNonInclusiveWriteback(Address lineAddr, AccessType
     if (!nonInclusiveHack) panic("Non-inclusive %s on line 0x%lx, this cache should be inclusive", AccessTypeName(type), lineAddr);
 
     //info("Non-inclusive wback, forwarding");
-    MemReq req = {lineAddr, type, selfId, state, cycle, &ccLock, *state, srcId, flags | MemReq::NONINCLWB};
+    MemReq req = {lineAddr, type, selfId, state, cycle, locks.lineLock(0) /*never striped*/, *state, srcId, flags | MemReq::NONINCLWB, 0 /*no pc*/};
     uint64_t respCycle = parents[getParentId(lineAddr)]->access(req);
     return respCycle;
 }
@@ -219,9 +241,79 @@ void MESITopCC::init(const g_vector<BaseCache*>& _children, Network* network, co
     for (uint32_t c = 0; c < children.size(); c++) {
         children[c] = _children[c];
     }
+    wideSharers = children.size() > 64;
+    overflowWords = (children.size() + 63) / 64;
+    if (wideSharers && locks.isStriped()) overflowPool.resize(numLines*overflowWords, 0);
+}
+
+void MESITopCC::addSharer(Entry* e, uint32_t childId) {
+    assert(!isSharer(e, childId));
+    if (!wideSharers) {
+        e->mask |= 1ul << childId;
+    } else if (e->numSharers < INLINE_SHARERS) {
+        e->ids[e->numSharers] = childId;
+    } else {
+        if (e->numSharers == INLINE_SHARERS) {
+            // Spill the inline ids to a bit vector
+            uint32_t idx;
+            if (locks.isStriped()) {
+                idx = e - array;  // fixed per-line vector
+            } else if (freeOverflows.empty()) {
+                idx = overflowPool.size() / overflowWords;
+                overflowPool.resize(overflowPool.size() + overflowWords, 0);
+            } else {
+                idx = freeOverflows.back();
+                freeOverflows.pop_back();
+            }
+            uint16_t ids[INLINE_SHARERS];
+            for (uint32_t i = 0; i < INLINE_SHARERS; i++) ids[i] = e->ids[i];
+            e->overflowIdx = idx;
+            uint64_t* bits = overflowBits(e);
+            for (uint32_t i = 0; i < INLINE_SHARERS; i++) bits[ids[i] / 64] |= 1ul << (ids[i] % 64);
+        }
+        overflowBits(e)[childId / 64] |= 1ul << (childId % 64);
+    }
+    e->numSharers++;
+}
+
+void MESITopCC::removeSharer(Entry* e, uint32_t childId) {
+    assert(isSharer(e, childId));
+    if (!wideSharers) {
+        e->mask &= ~(1ul << childId);
+    } else if (e->numSharers <= INLINE_SHARERS) {
+        uint32_t i = 0;
+        while (e->ids[i] != childId) i++;
+        e->ids[i] = e->ids[e->numSharers - 1];
+    } else {
+        uint64_t* bits = overflowBits(e);
+        bits[childId / 64] &= ~(1ul << (childId % 64));
+        if (e->numSharers - 1 == INLINE_SHARERS) {
+            // Back to inline ids; the bit vector is left zeroed for reuse
+            uint32_t idx = e->overflowIdx;
+            uint32_t n = 0;
+            for (uint32_t w = 0; w < overflowWords; w++) {
+                for (uint64_t b = bits[w]; b; b &= b - 1) e->ids[n++] = w*64 + __builtin_ctzl(b);
+                bits[w] = 0;
+            }
+            assert(n == INLINE_SHARERS);
+            if (!locks.isStriped()) freeOverflows.push_back(idx);
+        }
+    }
+    e->numSharers--;
+}
+
+void MESITopCC::clearSharers(Entry* e) {
+    if (wideSharers && e->numSharers > INLINE_SHARERS) {
+        uint64_t* bits = overflowBits(e);
+        for (uint32_t w = 0; w < overflowWords; w++) bits[w] = 0;
+        if (!locks.isStriped()) freeOverflows.push_back(e->overflowIdx);
+    }
+    e->numSharers = 0;
+    e->mask = 0;
 }
 
 uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId) {
+    SelfProfScope sp(SelfProfiler::SP_COHERENCE, srcId);
     //Send down downgrades/invalidates
     Entry* e = &array[lineId];
 
@@ -232,22 +324,18 @@ uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType t
 
     uint64_t maxCycle = cycle; //keep maximum cycle only, we assume all invals are sent in parallel
     if (!e->isEmpty()) {
-        uint32_t numChildren = children.size();
         uint32_t sentInvs = 0;
-        for (uint32_t c = 0; c < numChildren; c++) {
-            if (e->sharers[c]) {
-                InvReq req = {lineAddr, type, reqWriteback, cycle, srcId};
-                uint64_t respCycle = children[c]->invalidate(req);
-                int32_t latency = MAX((int64_t)respCycle - (int64_t)cycle, 0);
-                respCycle += (network)? network->getRTT(cycle, latency, name.c_str(), children[c]->getName()) : 0;
-                maxCycle = MAX(respCycle, maxCycle);
-                if (type == INV) e->sharers[c] = false;
-                sentInvs++;
-            }
-        }
+        forEachSharer(e, [&](uint32_t c) {
+            InvReq req = {lineAddr, type, reqWriteback, cycle, srcId};
+            uint64_t respCycle = children[c]->invalidate(req);
+            int32_t latency = MAX((int64_t)respCycle - (int64_t)cycle, 0);
+            respCycle += (network)? network->getRTT(cycle, latency, name.c_str(), children[c]->getName()) : 0;
+            maxCycle = MAX(respCycle, maxCycle);
+            sentInvs++;
+        });
         assert(sentInvs == e->numSharers);
         if (type == INV) {
-            e->numSharers = 0;
+            clearSharers(e);
         } else {
             //TODO: This is kludgy -- once the sharers format is more sophisticated, handle downgrades with a different codepath
             assert(e->exclusive);
@@ -260,9 +348,11 @@ uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType t
 
 
 uint64_t MESITopCC::processEviction(Address wbLineAddr, uint32_t lineId, bool* reqWriteback, uint64_t cycle, uint32_t srcId) {
+    if (profiler) profiler->evict(lineId);
     if (nonInclusiveHack) {
         // Don't invalidate anything, just clear our entry
-        array[lineId].clear();
+        array[lineId].exclusive = false;
+        clearSharers(&array[lineId]);
         return cycle;
     } else {
         //Send down invalidates
@@ -278,38 +368,42 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
         case PUTX:
             assert(e->isExclusive());
             if (flags & MemReq::PUTX_KEEPEXCL) {
-                assert(e->sharers[childId]);
+                assert(isSharer(e, childId));
                 assert(*childState == M);
                 *childState = E; //they don't hold dirty data anymore
                 break; //don't remove from sharer set. It'll keep exclusive perms.
             }
             //note NO break in general
         case PUTS:
-            assert(e->sharers[childId]);
-            e->sharers[childId] = false;
-            e->numSharers--;
+            removeSharer(e, childId);
             *childState = I;
             break;
         case GETS:
             if (e->isEmpty() && haveExclusive && !(flags & MemReq::NOEXCL)) {
                 //Give in E state
                 e->exclusive = true;
-                e->sharers[childId] = true;
-                e->numSharers = 1;
+                addSharer(e, childId);
                 *childState = E;
             } else {
                 //Give in S state
-                assert(e->sharers[childId] == false);
+                assert(!isSharer(e, childId));
 
                 if (e->isExclusive()) {
                     //Downgrade the exclusive sharer
+                    uint32_t owner = 0;
+                    if (profiler) forEachSharer(e, [&](uint32_t c) { owner = c; });
+                    bool wasWriteback = *inducedWriteback;
                     respCycle = sendInvalidates(lineAddr, lineId, INVX, inducedWriteback, cycle, srcId);
+                    if (profiler) {
+                        bool writeback = *inducedWriteback && !wasWriteback;
+                        if (writeback) profiler->ownerWrite(lineAddr, lineId, owner);
+                        profiler->coherenceMsgs(INVX, 1, writeback);
+                    }
                 }
 
                 assert_msg(!e->isExclusive(), "Can't have exclusivity here. isExcl=%d excl=%d numSharers=%d", e->isExclusive(), e->exclusive, e->numSharers);
 
-                e->sharers[childId] = true;
-                e->numSharers++;
+                addSharer(e, childId);
                 e->exclusive = false; //dsm: Must set, we're explicitly non-exclusive
                 *childState = S;
             }
@@ -318,18 +412,28 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
             assert(haveExclusive); //the current cache better have exclusive access to this line
 
             // If child is in sharers list (this is an upgrade miss), take it out
-            if (e->sharers[childId]) {
+            if (isSharer(e, childId)) {
                 assert_msg(!e->isExclusive(), "Spurious GETX, childId=%d numSharers=%d isExcl=%d excl=%d", childId, e->numSharers, e->isExclusive(), e->exclusive);
-                e->sharers[childId] = false;
-                e->numSharers--;
+                removeSharer(e, childId);
             }
 
             // Invalidate all other copies
-            respCycle = sendInvalidates(lineAddr, lineId, INV, inducedWriteback, cycle, srcId);
+            if (profiler && !e->isEmpty()) {
+                uint32_t invs = e->numSharers;
+                uint32_t owner = 0;
+                bool exclusive = e->isExclusive();
+                if (exclusive) forEachSharer(e, [&](uint32_t c) { owner = c; });
+                bool wasWriteback = *inducedWriteback;
+                respCycle = sendInvalidates(lineAddr, lineId, INV, inducedWriteback, cycle, srcId);
+                bool writeback = *inducedWriteback && !wasWriteback;
+                if (writeback && exclusive) profiler->ownerWrite(lineAddr, lineId, owner);
+                profiler->coherenceMsgs(INV, invs, writeback);
+            } else {
+                respCycle = sendInvalidates(lineAddr, lineId, INV, inducedWriteback, cycle, srcId);
+            }
 
             // Set current sharer, mark exclusive
-            e->sharers[childId] = true;
-            e->numSharers++;
+            addSharer(e, childId);
             e->exclusive = true;
 
             assert(e->numSharers == 1);
@@ -340,6 +444,7 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
         default: panic("!?");
     }
 
+    if (profiler) profiler->access(lineAddr, lineId, type, childId);
     return respCycle;
 }
 
@@ -26,14 +26,18 @@
 #ifndef COHERENCE_CTRLS_H_
 #define COHERENCE_CTRLS_H_
 
-#include <bitset>
 #include <string>
+#include "bithacks.h"
+#include "cache_arrays.h"
 #include "constants.h"
 #include "g_std/g_string.h"
 #include "g_std/g_vector.h"
 #include "locks.h"
 #include "memory_hierarchy.h"
 #include "pad.h"
+#include "rdtsc.h"
+#include "self_profiler.h"
+#include "sharing_profiler.h"
 #include "stats.h"
 #include "network.h"
 
@@ -55,7 +59,7 @@ class CC : public GlobAlloc {
         virtual void endAccess(const MemReq& req) = 0;
 
         //Inv methods
-        virtual void startInv() = 0;
+        virtual void startInv(Address lineAddr) = 0;
         virtual uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) = 0;
 
         //Repl policy interface
@@ -78,6 +82,72 @@ class CC : public GlobAlloc {
 class Cache;
 class Network;
 
+/* A controller's locks. By default, a single lock serializes all the accesses and invalidations of a cache
+ * bank. Shared caches can instead split their sets into lock stripes (see MESICC::setLockStripes), so that
+ * accesses to lines in different stripes proceed in parallel. A line's stripe is its set modulo the number
+ * of stripes, so an access and its victim always share one. Each lock sits on its own line, along with its
+ * contention counters, which are only updated with the lock held.
+ */
+class CCLocks {
+    private:
+        struct Stripe {
+            lock_t lock;
+            uint64_t acquires;
+            uint64_t contended;   // acquires that found the lock taken
+            uint64_t waitCycles;  // host (rdtsc) cycles spent in contended acquires
+        } ATTR_LINE_ALIGNED;
+
+        Stripe* stripes;
+        uint32_t numStripes;
+        uint32_t setWays;  // lineId / setWays = set
+
+    public:
+        CCLocks(uint32_t _numStripes, uint32_t _setWays) : numStripes(_numStripes), setWays(_setWays) {
+            assert(isPow2(numStripes));
+            stripes = gm_memalign<Stripe>(CACHE_LINE_BYTES, numStripes);
+            for (uint32_t i = 0; i < numStripes; i++) {
+                futex_init(&stripes[i].lock);
+                stripes[i].acquires = stripes[i].contended = stripes[i].waitCycles = 0;
+            }
+        }
+
+        void initStats(AggregateStat* parentStat, const char* name, const char* desc);
+
+        inline bool isStriped() const {
+            return numStripes > 1;
+        }
+
+        inline void lock(uint32_t stripe) {
+            Stripe& s = stripes[stripe];
+            if (unlikely(!futex_trylock(&s.lock))) {
+                uint64_t start = rdtsc();
+                futex_lock(&s.lock);
+                s.contended++;
+                uint64_t wait = rdtsc() - start;
+                s.waitCycles += wait;
+                if (zinfo->selfProf) zinfo->selfProf->lockWait(wait);
+            }
+            s.acquires++;
+        }
+
+        inline void unlock(uint32_t stripe) {
+            futex_unlock(&stripes[stripe].lock);
+        }
+
+        // Lock of lineId's stripe, which upward accesses pass as their childLock
+        inline lock_t* lineLock(uint32_t lineId) {
+            uint32_t stripe = isStriped()? (lineId / setWays) & (numStripes - 1) : 0;
+            return &stripes[stripe].lock;
+        }
+
+    private:
+        uint64_t total(uint64_t Stripe::* counter) const {
+            uint64_t res = 0;
+            for (uint32_t i = 0; i < numStripes; i++) res += stripes[i].*counter;
+            return res;
+        }
+};
+
 /* NOTE: To avoid virtual function overheads, there is no BottomCC interface, since we only have a MESI controller for now */
 
 class MESIBottomCC : public GlobAlloc {
@@ -102,17 +172,16 @@ class MESIBottomCC : public GlobAlloc {
         bool bypass;
 
         PAD();
-        lock_t ccLock;
+        CCLocks locks;
         PAD();
 
     public:
-        MESIBottomCC(uint32_t _numLines, uint32_t _selfId, bool _nonInclusiveHack, bool _bypass) :
-            numLines(_numLines), selfId(_selfId), nonInclusiveHack(_nonInclusiveHack), bypass(_bypass) {
+        MESIBottomCC(uint32_t _numLines, uint32_t _selfId, bool _nonInclusiveHack, bool _bypass, uint32_t lockStripes, uint32_t setWays) :
+            numLines(_numLines), selfId(_selfId), nonInclusiveHack(_nonInclusiveHack), bypass(_bypass), locks(lockStripes, setWays) {
             array = gm_calloc<MESIState>(numLines);
             for (uint32_t i = 0; i < numLines; i++) {
                 array[i] = I;
             }
-            futex_init(&ccLock);
         }
 
         void init(const g_vector<MemObject*>& _parents, Network* network, const char* name);
@@ -152,9 +221,13 @@ class MESIBottomCC : public GlobAlloc {
             parentStat->append(&sharedRequests);
         }
 
+        void initLockStats(AggregateStat* parentStat) {
+            locks.initStats(parentStat, "bottomLocks", "Bottom lock contention profile (accesses and invalidations)");
+        }
+
         uint64_t processEviction(Address wbLineAddr, uint32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId);
 
-        uint64_t processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags);
+        uint64_t processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags, Address pc = 0);
 
         void processWritebackOnAccess(Address lineAddr, uint32_t lineId, AccessType type);
 
@@ -162,12 +235,12 @@ class MESIBottomCC : public GlobAlloc {
 
         uint64_t processNonInclusiveWriteback(Address lineAddr, AccessType type, uint64_t cycle, MESIState* state, uint32_t srcId, uint32_t flags);
 
-        inline void lock() {
-            futex_lock(&ccLock);
+        inline void lock(uint32_t stripe) {
+            locks.lock(stripe);
         }
 
-        inline void unlock() {
-            futex_unlock(&ccLock);
+        inline void unlock(uint32_t stripe) {
+            locks.unlock(stripe);
         }
 
         /* Replacement policy query interface */
@@ -179,22 +252,34 @@ class MESIBottomCC : public GlobAlloc {
 
     private:
         uint32_t getParentId(Address lineAddr);
+
+        // Accesses to different stripes update the counters concurrently
+        inline void count(Counter& c, uint64_t delta = 1) {
+            if (locks.isStriped()) c.atomicInc(delta);
+            else c.inc(delta);
+        }
 };
 
 
 //Implements the "top" part: Keeps directory information, handles downgrades and invalidates
+/* Sharer sets are sized to the actual number of children. With up to 64 children, each entry holds a
+ * bitmask. Otherwise, it holds up to INLINE_SHARERS child ids, and overflows to a full bit vector taken
+ * from a per-controller pool (and goes back inline when enough sharers leave). Sharer counts stay exact.
+ * All sharer state is modified with the bcc lock held, which also protects the pool. With striped locks,
+ * the pool has a fixed bit vector per line instead, so stripes never share (or resize) it.
+ */
 class MESITopCC : public GlobAlloc {
     private:
+        static const uint32_t INLINE_SHARERS = 4;
+
         struct Entry {
             uint32_t numSharers;
-            std::bitset<MAX_CACHE_CHILDREN> sharers;
             bool exclusive;
-
-            void clear() {
-                exclusive = false;
-                numSharers = 0;
-                sharers.reset();
-            }
+            union {
+                uint64_t mask;                      // <= 64 children
+                uint16_t ids[INLINE_SHARERS];       // numSharers <= INLINE_SHARERS
+                uint32_t overflowIdx;               // numSharers > INLINE_SHARERS, bit vector in overflowPool
+            };
 
             bool isEmpty() {
                 return numSharers == 0;
@@ -214,22 +299,34 @@ class MESITopCC : public GlobAlloc {
         bool nonInclusiveHack;
         bool bypass;
 
+        bool wideSharers;  // > 64 children
+        uint32_t overflowWords;
+        g_vector<uint64_t> overflowPool;
+        g_vector<uint32_t> freeOverflows;
+
+        SharingProfiler* profiler;  // nullptr unless profiling sharing
+
         PAD();
-        lock_t ccLock;
+        CCLocks locks;
         PAD();
 
     public:
-        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack, bool _bypass) : numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), bypass(_bypass) {
-            array = gm_calloc<Entry>(numLines);
-            for (uint32_t i = 0; i < numLines; i++) {
-                array[i].clear();
-            }
-
-            futex_init(&ccLock);
+        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack, bool _bypass, uint32_t lockStripes, uint32_t setWays) : numLines(_numLines),
+            nonInclusiveHack(_nonInclusiveHack), bypass(_bypass), wideSharers(false), overflowWords(0), profiler(nullptr), locks(lockStripes, setWays) {
+            array = gm_calloc<Entry>(numLines);  // zeroed, i.e., all entries empty
         }
 
         void init(const g_vector<BaseCache*>& _children, Network* network, const char* name);
 
+        void profileSharing(uint32_t samplingRate) {
+            profiler = new SharingProfiler(numLines, children.size(), samplingRate, g_string(name.c_str()));
+        }
+
+        void initStats(AggregateStat* parentStat) {
+            locks.initStats(parentStat, "topLocks", "Top lock contention profile (accesses)");
+            if (profiler) profiler->initStats(parentStat);
+        }
+
         uint64_t processEviction(Address wbLineAddr, uint32_t lineId, bool* reqWriteback, uint64_t cycle, uint32_t srcId);
 
         uint64_t processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint32_t childId, bool haveExclusive,
@@ -237,12 +334,12 @@ class MESITopCC : public GlobAlloc {
 
         uint64_t processInval(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId);
 
-        inline void lock() {
-            futex_lock(&ccLock);
+        inline void lock(uint32_t stripe) {
+            locks.lock(stripe);
         }
 
-        inline void unlock() {
-            futex_unlock(&ccLock);
+        inline void unlock(uint32_t stripe) {
+            locks.unlock(stripe);
         }
 
         /* Replacement policy query interface */
@@ -252,6 +349,39 @@ class MESITopCC : public GlobAlloc {
 
     private:
         uint64_t sendInvalidates(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId);
+
+        /* Sharer set operations */
+        inline uint64_t* overflowBits(const Entry* e) {
+            return &overflowPool[e->overflowIdx * overflowWords];
+        }
+
+        bool isSharer(Entry* e, uint32_t childId) {
+            if (!wideSharers) return (e->mask >> childId) & 1;
+            if (e->numSharers > INLINE_SHARERS) return (overflowBits(e)[childId / 64] >> (childId % 64)) & 1;
+            for (uint32_t i = 0; i < e->numSharers; i++) {
+                if (e->ids[i] == childId) return true;
+            }
+            return false;
+        }
+
+        void addSharer(Entry* e, uint32_t childId);
+        void removeSharer(Entry* e, uint32_t childId);
+        void clearSharers(Entry* e);
+
+        // Calls f(childId) for each sharer, in ascending childId order except for inline ids
+        template <typename F> inline void forEachSharer(Entry* e, F f) {
+            if (!wideSharers || e->numSharers > INLINE_SHARERS) {
+                const uint64_t* bits = wideSharers? overflowBits(e) : &e->mask;
+                uint32_t words = wideSharers? overflowWords : 1;
+                for (uint32_t w = 0; w < words; w++) {
+                    for (uint64_t b = bits[w]; b; b &= b - 1) {
+                        f(w*64 + __builtin_ctzl(b));
+                    }
+                }
+            } else {
+                for (uint32_t i = 0; i < e->numSharers; i++) f(e->ids[i]);
+            }
+        }
 };
 
 static inline bool CheckForMESIRace(AccessType& type, MESIState* state, MESIState initialState) {
@@ -283,8 +413,8 @@ static inline bool CheckForMESIRace(AccessType& type, MESIState* state, MESIStat
     return skipAccess;
 }
 
-// Non-terminal CC; accepts GETS/X and PUTS/X accesses
-class MESICC : public CC {
+// Non-terminal CC; accepts GETS/X and PUTS/X accesses. Final so StaticCache can call it directly
+class MESICC final : public CC {
     private:
         MESITopCC* tcc;
         MESIBottomCC* bcc;
@@ -292,25 +422,47 @@ class MESICC : public CC {
         bool nonInclusiveHack;
         g_string name;
         bool bypass;
+        uint32_t sharingSamplingRate;  // 0 -> no sharing profile
+        uint32_t lockStripes;
+        SetAssocArray* stripeArray;  // maps lines to sets if lockStripes > 1
 
     public:
         //Initialization
        MESICC(uint32_t _numLines, bool _nonInclusiveHack, bool _bypass, g_string& _name) : tcc(nullptr), bcc(nullptr),
-             numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), name(_name), bypass(_bypass) {}
+             numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), name(_name), bypass(_bypass), sharingSamplingRate(0),
+             lockStripes(1), stripeArray(nullptr) {}
+
+        void setSharingProfile(uint32_t samplingRate) {
+            sharingSamplingRate = samplingRate;
+        }
+
+        /* Split the controller's locks in stripes of the array's sets (see CCLocks). Must be called before
+         * setParents/setChildren. Besides the array, the replacement policy must only touch the set being
+         * accessed: LRU's shared timestamp counter races benignly, the other policies keep per-access state.
+         */
+        void setLockStripes(uint32_t stripes, SetAssocArray* array) {
+            assert(!tcc && !bcc);
+            if (!isPow2(stripes)) panic("[%s] Lock stripes (%d) must be a power of 2", name.c_str(), stripes);
+            if (nonInclusiveHack && stripes > 1) panic("[%s] Non-inclusive caches can't have striped locks", name.c_str());
+            lockStripes = stripes;
+            stripeArray = array;
+        }
 
         void setParents(uint32_t childId, const g_vector<MemObject*>& parents, Network* network) {
-            bcc = new MESIBottomCC(numLines, childId, nonInclusiveHack, bypass);
+            bcc = new MESIBottomCC(numLines, childId, nonInclusiveHack, bypass, lockStripes, stripeWays());
             bcc->init(parents, network, name.c_str());
         }
 
         void setChildren(const g_vector<BaseCache*>& children, Network* network) {
-            tcc = new MESITopCC(numLines, nonInclusiveHack, bypass);
+            tcc = new MESITopCC(numLines, nonInclusiveHack, bypass, lockStripes, stripeWays());
             tcc->init(children, network, name.c_str());
+            if (sharingSamplingRate) tcc->profileSharing(sharingSamplingRate);
         }
 
         void initStats(AggregateStat* cacheStat) {
-            //no tcc stats
             bcc->initStats(cacheStat);
+            bcc->initLockStats(cacheStat);
+            tcc->initStats(cacheStat);  // lock and sharing profiles
         }
 
         //Access methods
@@ -325,8 +477,9 @@ class MESICC : public CC {
                 futex_unlock(req.childLock);
             }
 
-            tcc->lock(); //must lock tcc FIRST
-            bcc->lock();
+            uint32_t stripe = stripeOf(req.lineAddr);
+            tcc->lock(stripe); //must lock tcc FIRST
+            bcc->lock(stripe);
 
             /* The situation is now stable, true race-wise. No one can touch the child state, because we hold
              * both parent's locks. So, we first handle races, which may cause us to skip the access.
@@ -373,7 +526,7 @@ class MESICC : public CC {
                 uint32_t flags = req.flags & ~MemReq::PREFETCH; //always clear PREFETCH, this flag cannot propagate up
 
                 //if needed, fetch line or upgrade miss from upper level
-                respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, flags);
+                respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, flags, req.pc);
                 if (getDoneCycle) *getDoneCycle = respCycle;
                 if (!isPrefetch) { //prefetches only touch bcc; the demand request from the core will pull the line to lower level
                     //At this point, the line is in a good state w.r.t. upper levels
@@ -396,26 +549,36 @@ class MESICC : public CC {
                 futex_lock(req.childLock);
             }
 
-            bcc->unlock();
-            tcc->unlock();
+            uint32_t stripe = stripeOf(req.lineAddr);
+            bcc->unlock(stripe);
+            tcc->unlock(stripe);
         }
 
         //Inv methods
-        void startInv() {
-            bcc->lock(); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
+        void startInv(Address lineAddr) {
+            bcc->lock(stripeOf(lineAddr)); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
         }
 
         uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) {
             uint64_t respCycle = tcc->processInval(req.lineAddr, lineId, req.type, req.writeback, startCycle, req.srcId); //send invalidates or downgrades to children
             bcc->processInval(req.lineAddr, lineId, req.type, req.writeback); //adjust our own state
 
-            bcc->unlock();
+            bcc->unlock(stripeOf(req.lineAddr));
             return respCycle;
         }
 
         //Repl policy interface
         uint32_t numSharers(uint32_t lineId) {return tcc->numSharers(lineId);}
         bool isValid(uint32_t lineId) {return bcc->isValid(lineId);}
+
+    private:
+        inline uint32_t stripeOf(Address lineAddr) {
+            return (lockStripes > 1)? stripeArray->getSet(lineAddr) & (lockStripes - 1) : 0;
+        }
+
+        inline uint32_t stripeWays() const {
+            return stripeArray? stripeArray->getAssoc() : 1;
+        }
 };
 
 // Terminal CC, i.e., without children --- accepts GETS/X, but not PUTS/X
@@ -430,7 +593,7 @@ class MESITerminalCC : public CC {
         //Initialization
         MESITerminalCC(uint32_t _numLines, bool _bypass, const g_string& _name) : bcc(nullptr), numLines(_numLines), name(_name), bypass(_bypass) {}
         void setParents(uint32_t childId, const g_vector<MemObject*>& parents, Network* network) {
-            bcc = new MESIBottomCC(numLines, childId, false /*inclusive*/, bypass);
+            bcc = new MESIBottomCC(numLines, childId, false /*inclusive*/, bypass, 1 /*single lock*/, 1);
             bcc->init(parents, network, name.c_str());
         }
 
@@ -454,7 +617,7 @@ class MESITerminalCC : public CC {
                 futex_unlock(req.childLock);
             }
 
-            bcc->lock();
+            bcc->lock(0);
 
             /* The situation is now stable, true race-wise. No one can touch the child state, because we hold
              * both parent's locks. So, we first handle races, which may cause us to skip the access.
@@ -477,7 +640,7 @@ class MESITerminalCC : public CC {
             assert(lineId != -1);
             assert(!getDoneCycle);
             //if needed, fetch line or upgrade miss from upper level
-            uint64_t respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, req.flags);
+            uint64_t respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, req.flags, req.pc);
             //at this point, the line is in a good state w.r.t. upper levels
             return respCycle;
         }
@@ -487,17 +650,17 @@ class MESITerminalCC : public CC {
             if (req.childLock) {
                 futex_lock(req.childLock);
             }
-            bcc->unlock();
+            bcc->unlock(0);
         }
 
         //Inv methods
-        void startInv() {
-            bcc->lock();
+        void startInv(Address lineAddr) {
+            bcc->lock(0);
         }
 
         uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) {
             bcc->processInval(req.lineAddr, lineId, req.type, req.writeback); //adjust our own state
-            bcc->unlock();
+            bcc->unlock(0);
             return startCycle; //no extra delay in terminal caches
         }
 
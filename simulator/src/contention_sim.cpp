@@ -33,6 +33,8 @@
 #include <vector>
 #include "log.h"
 #include "ooo_core.h"
+#include "rdtsc.h"
+#include "synthetic_core.h"
 #include "timing_core.h"
 #include "accelerator_core.h"
 #include "timing_event.h"
@@ -59,10 +61,12 @@ void ContentionSim::SimThreadTrampoline(void* arg) {
     csim->simThreadLoop(thid);
 }
 
-ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads) {
+ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads, bool _stealing) {
     numDomains = _numDomains;
     numSimThreads = _numSimThreads;
+    stealing = _stealing && numDomains > numSimThreads; //with a domain per thread, there's nothing to steal
     threadsDone = 0;
+    domainsLeft = 0;
     limit = 0;
     lastLimit = 0;
     inCSim = false;
@@ -76,9 +80,11 @@ ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads) {
         futex_init(&domains[i].pqLock);
     }
 
-    if ((numDomains % numSimThreads) != 0) panic("numDomains(%d) must be a multiple of numSimThreads(%d) for now", numDomains, numSimThreads);
+    if (!stealing && (numDomains % numSimThreads) != 0) panic("numDomains(%d) must be a multiple of numSimThreads(%d) without stealing", numDomains, numSimThreads);
 
     for (uint32_t i = 0; i < numSimThreads; i++) {
+        new (&simThreads[i]) SimThreadData();
+        futex_init(&simThreads[i].queueLock);
         futex_init(&simThreads[i].wakeLock);
         futex_lock(&simThreads[i].wakeLock); //starts locked, so first actual call to lock blocks
         simThreads[i].firstDomain = i*numDomains/numSimThreads;
@@ -118,6 +124,11 @@ void ContentionSim::postInit() {
             skipContention = false;
             return;
         }
+        SyntheticCore* score = dynamic_cast<SyntheticCore*>(zinfo->cores[i]);
+        if (score) {
+            skipContention = false;
+            return;
+        }
     }
     skipContention = true;
 }
@@ -144,6 +155,21 @@ void ContentionSim::initStats(AggregateStat* parentStat) {
         new (&domains[i].profTime) ClockStat();
         domains[i].profTime.init("time", "Weave simulation time");
         domStat->append(&domains[i].profTime);
+        new (&domains[i].profEvents) Counter();
+        new (&domains[i].profStalls) Counter();
+        new (&domains[i].profSteals) Counter();
+        new (&domains[i].profHostCycles) Counter();
+        new (&domains[i].profCrossings) Counter();
+        domains[i].profEvents.init("events", "Events simulated");
+        domains[i].profStalls.init("stalls", "Crossings requeued because their source domain was behind");
+        domains[i].profSteals.init("steals", "Times another simulation thread took this domain");
+        domains[i].profHostCycles.init("hostCycles", "Host cycles (rdtsc) spent simulating this domain");
+        domains[i].profCrossings.init("crossings", "Crossings from other domains into this one");
+        domStat->append(&domains[i].profEvents);
+        domStat->append(&domains[i].profStalls);
+        domStat->append(&domains[i].profSteals);
+        domStat->append(&domains[i].profHostCycles);
+        domStat->append(&domains[i].profCrossings);
         objStat->append(domStat);
     }
     parentStat->append(objStat);
@@ -163,6 +189,23 @@ void ContentionSim::simulatePhase(uint64_t limit) {
         if (ocore) ocore->cSimStart();
         AcceleratorCore* acore = dynamic_cast<AcceleratorCore*>(zinfo->cores[i]);
         if (acore) acore->cSimStart();
+        SyntheticCore* score = dynamic_cast<SyntheticCore*>(zinfo->cores[i]);
+        if (score) score->cSimStart();
+    }
+
+    if (stealing) {
+        //Threads start each phase with their static share of domains, and steal from each other when they run out
+        for (uint32_t i = 0; i < numSimThreads; i++) {
+            SimThreadData& th = simThreads[i];
+            th.readyDomains.clear();
+            th.stalledDomains.clear();
+            for (uint32_t d = th.firstDomain; d < th.supDomain; d++) {
+                domains[d].queuePrio = domains[d].curCycle;
+                th.readyDomains.push_back(&domains[d]);
+            }
+            std::make_heap(th.readyDomains.begin(), th.readyDomains.end(), CompareDomains());
+        }
+        domainsLeft = numDomains;
     }
 
     inCSim = true;
@@ -186,6 +229,8 @@ void ContentionSim::simulatePhase(uint64_t limit) {
         if (ocore) ocore->cSimEnd();
         AcceleratorCore* acore = dynamic_cast<AcceleratorCore*>(zinfo->cores[i]);
         if (acore) acore->cSimEnd();
+        SyntheticCore* score = dynamic_cast<SyntheticCore*>(zinfo->cores[i]);
+        if (score) score->cSimEnd();
     }
 
     lastLimit = limit;
@@ -197,7 +242,7 @@ void ContentionSim::enqueue(TimingEvent* ev, uint64_t cycle) {
     assert(ev);
     assert_msg(cycle >= lastLimit, "Enqueued event before last limit! cycle %ld min %ld", cycle, lastLimit);
     //Hacky, but helpful to chase events scheduled too far ahead due to bugs (e.g., cycle -1). We should probably formalize this a bit more
-    assert_msg(cycle < lastLimit+10*zinfo->phaseLength+1000000, "Queued event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
+    assert_msg(cycle < lastLimit+10*zinfo->maxPhaseLength+1000000, "Queued event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
 
     assert_msg(cycle >= domains[ev->domain].curCycle, "Queued event goes back in time, cycle %ld curCycle %ld", cycle, domains[ev->domain].curCycle);
     ev->privCycle = cycle;
@@ -218,7 +263,7 @@ void ContentionSim::enqueueSynced(TimingEvent* ev, uint64_t cycle) {
 
     assert_msg(cycle >= lastLimit, "Enqueued (synced) event before last limit! cycle %ld min %ld", cycle, lastLimit);
     //Hacky, but helpful to chase events scheduled too far ahead due to bugs (e.g., cycle -1). We should probably formalize this a bit more
-    assert_msg(cycle < lastLimit+10*zinfo->phaseLength+10000, "Queued  (synced) event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
+    assert_msg(cycle < lastLimit+10*zinfo->maxPhaseLength+10000, "Queued  (synced) event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
     ev->privCycle = cycle;
     assert(ev->numParents == 0);
     domains[ev->domain].pq.enqueue(ev, cycle);
@@ -227,6 +272,7 @@ void ContentionSim::enqueueSynced(TimingEvent* ev, uint64_t cycle) {
 }
 
 void ContentionSim::enqueueCrossing(CrossingEvent* ev, uint64_t cycle, uint32_t srcId, uint32_t srcDomain, uint32_t dstDomain, EventRecorder* evRec) {
+    domains[dstDomain].profCrossings.atomicInc();
     CrossingStack& cs = evRec->getCrossingStack();
     bool isFirst = cs.empty();
     bool isResp = false;
@@ -286,7 +332,8 @@ void ContentionSim::simThreadLoop(uint32_t thid) {
         }
 
         //info("%d --- phase start", domain);
-        simulatePhaseThread(thid);
+        if (stealing) simulatePhaseStealing(thid);
+        else simulatePhaseThread(thid);
         //info("%d --- phase end", domain);
 
         uint32_t val = __sync_add_and_fetch(&threadsDone, 1);
@@ -305,6 +352,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
     if (thDomains == 1) {
         DomainData& domain = domains[simThreads[thid].firstDomain];
         domain.profTime.start();
+        uint64_t startTsc = rdtsc();
         PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain.pq;
         while (pq.size() && pq.firstCycle() < limit) {
             uint64_t domCycle = domain.curCycle;
@@ -316,6 +364,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
                 domain.curCycle = cycle;
             }
             te->run(cycle);
+            domain.profEvents.inc();
             uint64_t newCycle = pq.size()? pq.firstCycle() : limit;
             assert(newCycle >= domCycle);
             if (newCycle != domCycle) domain.curCycle = newCycle;
@@ -324,6 +373,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
 #endif
         }
         domain.curCycle = limit;
+        domain.profHostCycles.inc(rdtsc() - startTsc);
         domain.profTime.end();
 
 #if POST_MORTEM
@@ -369,6 +419,18 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
         std::vector<DomainData*>& stalledQueue = sq1;
         std::vector<DomainData*>& nextStalledQueue = sq2;
 
+        // Host cycles are charged per domain visit (consecutive events of one domain), not per event, so
+        // the common case of a domain running several events in a row reads the TSC once
+        DomainData* visitDomain = nullptr;
+        uint64_t visitTsc = 0;
+        auto visit = [&](DomainData* domain) {
+            if (domain == visitDomain) return;
+            uint64_t tsc = rdtsc();
+            if (visitDomain) visitDomain->profHostCycles.inc(tsc - visitTsc);
+            visitDomain = domain;
+            visitTsc = tsc;
+        };
+
         while (numFinished < thDomains) {
             while (domPq.size()) {
                 DomainData* domain = domPq.top();
@@ -379,11 +441,13 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
                     domain->curCycle = limit;
                 } else {
                     //info("YYY %d %ld %ld %d", numFinished, domPq.size(), domain->curCycle, domain->prio);
+                    visit(domain);
                     uint64_t cycle;
                     TimingEvent* te = pq.dequeue(cycle);
                     //uint64_t nextCycle = pq.size()? pq.firstCycle() : cycle;
                     if (cycle != domain->curCycle) domain->curCycle = cycle;
                     te->run(cycle);
+                    domain->profEvents.inc();
                     domain->curCycle = pq.size()? pq.firstCycle() : limit;
                     domain->queuePrio = domain->curCycle;
                     if (domain->prio == 0) domPq.push(domain);
@@ -400,6 +464,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
                     domain->curCycle = limit;
                 } else {
                     //info("SSS %d %ld %ld", numFinished, stalledQueue.size(), domain->curCycle);
+                    visit(domain);
                     uint64_t cycle;
                     TimingEvent* te = pq.dequeue(cycle);
                     if (cycle != domain->curCycle) domain->curCycle = cycle;
@@ -414,12 +479,131 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
             }
             if (!stalledQueue.size()) std::swap(stalledQueue, nextStalledQueue);
         }
+        visit(nullptr);  // charge the last visit
     }
 
     //info("Phase done");
     __sync_synchronize();
 }
 
+/* Like the multi-domain case of simulatePhaseThread, but threads keep their domains in shared queues and
+ * steal domains from each other when they run out of their own, so that one thread with a busy domain
+ * (e.g., a memory controller's) doesn't hold up the phase. A thread runs a domain as long as it stays ahead
+ * of the thread's other ready domains, and polls domains stalled on crossings only if it has no ready ones.
+ */
+void ContentionSim::simulatePhaseStealing(uint32_t thid) {
+    SimThreadData& th = simThreads[thid];
+    while (domainsLeft) {
+        DomainData* domain = nullptr;
+        bool stalled = false;
+        uint64_t bound = limit; //run until the domain falls behind the next ready one
+
+        futex_lock(&th.queueLock);
+        if (th.readyDomains.size()) {
+            std::pop_heap(th.readyDomains.begin(), th.readyDomains.end(), CompareDomains());
+            domain = th.readyDomains.back();
+            th.readyDomains.pop_back();
+            if (th.readyDomains.size()) bound = th.readyDomains.front()->queuePrio;
+        } else if (th.stalledDomains.size()) {
+            domain = th.stalledDomains.front();
+            th.stalledDomains.erase(th.stalledDomains.begin());
+            stalled = true;
+        }
+        futex_unlock(&th.queueLock);
+
+        if (!domain) {
+            domain = stealDomain(thid, stalled);
+            if (!domain) {
+                _mm_pause();
+                continue;
+            }
+        }
+
+        PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain->pq;
+        if (pq.size() && pq.firstCycle() <= limit) {
+            uint64_t startTsc = rdtsc();
+            if (stalled) {
+                uint64_t cycle;
+                TimingEvent* te = pq.dequeue(cycle);
+                if (cycle != domain->curCycle) domain->curCycle = cycle;
+                te->state = EV_RUNNING;
+                te->simulate(cycle);
+                domain->curCycle = pq.size()? pq.firstCycle() : limit;
+            } else {
+                do {
+                    uint64_t cycle;
+                    TimingEvent* te = pq.dequeue(cycle);
+                    if (cycle != domain->curCycle) domain->curCycle = cycle;
+                    te->run(cycle);
+                    domain->profEvents.inc();
+                    domain->curCycle = pq.size()? pq.firstCycle() : limit;
+                } while (domain->prio == 0 && pq.size() && pq.firstCycle() <= MIN(bound, limit));
+            }
+            domain->profHostCycles.inc(rdtsc() - startTsc);
+        }
+
+        if (!pq.size() || pq.firstCycle() > limit) {
+            domain->curCycle = limit;
+            __sync_fetch_and_sub(&domainsLeft, 1);
+        } else {
+            domain->queuePrio = domain->curCycle;
+            futex_lock(&th.queueLock);
+            if (domain->prio == 0) {
+                th.readyDomains.push_back(domain);
+                std::push_heap(th.readyDomains.begin(), th.readyDomains.end(), CompareDomains());
+            } else {
+                th.stalledDomains.push_back(domain);
+            }
+            futex_unlock(&th.queueLock);
+        }
+    }
+    __sync_synchronize();
+}
+
+//Takes a ready domain from another thread if there is any, else a stalled one
+ContentionSim::DomainData* ContentionSim::stealDomain(uint32_t thid, bool& stalled) {
+    for (uint32_t i = 1; i < numSimThreads; i++) {
+        SimThreadData& victim = simThreads[(thid + i) % numSimThreads];
+        if (victim.readyDomains.empty() && victim.stalledDomains.empty()) continue; //racy peek, skips idle threads without locking them
+        DomainData* domain = nullptr;
+        futex_lock(&victim.queueLock);
+        if (victim.readyDomains.size()) {
+            //The last element of a heap is a leaf, so taking it keeps the heap (and it's one of the furthest ahead)
+            domain = victim.readyDomains.back();
+            victim.readyDomains.pop_back();
+            stalled = false;
+        } else if (victim.stalledDomains.size()) {
+            domain = victim.stalledDomains.back();
+            victim.stalledDomains.pop_back();
+            stalled = true;
+        }
+        futex_unlock(&victim.queueLock);
+        if (domain) {
+            domain->profSteals.inc();
+            return domain;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t ContentionSim::getCrossings() const {
+    uint64_t crossings = 0;
+    for (uint32_t i = 0; i < numDomains; i++) crossings += domains[i].profCrossings.get();
+    return crossings;
+}
+
+uint64_t ContentionSim::getStalls() const {
+    uint64_t stalls = 0;
+    for (uint32_t i = 0; i < numDomains; i++) stalls += domains[i].profStalls.get();
+    return stalls;
+}
+
+uint64_t ContentionSim::getQueuedEvents() const {
+    uint64_t queued = 0;
+    for (uint32_t i = 0; i < numDomains; i++) queued += domains[i].pq.size();
+    return queued;
+}
+
 void ContentionSim::finish() {
     assert(!terminate);
     terminate = true;
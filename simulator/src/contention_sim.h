@@ -77,6 +77,8 @@ class ContentionSim : public GlobAlloc {
             PAD();
 
             ClockStat profTime;
+            Counter profEvents, profStalls, profSteals, profHostCycles;
+            Counter profCrossings; //incremented in the bound phase, so atomically
 
 #if PROFILE_CROSSINGS
             VectorCounter profIncomingCrossingSims;
@@ -95,6 +97,16 @@ class ContentionSim : public GlobAlloc {
             uint32_t supDomain; //supreme, ie first not included
 
             std::vector<std::pair<uint64_t, TimingEvent*> > logVec;
+
+            /* Domains this thread will simulate in the current phase (with stealing), in queuePrio order
+             * (a heap, so thieves can take its last element) or stalled on a crossing. Thieves take them
+             * under queueLock too, so a domain is only simulated by one thread at a time.
+             */
+            PAD();
+            lock_t queueLock;
+            g_vector<DomainData*> readyDomains;
+            g_vector<DomainData*> stalledDomains;
+            PAD();
         };
 
         //RO
@@ -106,6 +118,7 @@ class ContentionSim : public GlobAlloc {
         uint32_t numDomains;
         uint32_t numSimThreads;
         bool skipContention;
+        bool stealing; //threads steal domains when they run out, see simulatePhaseStealing()
 
         PAD();
 
@@ -116,6 +129,7 @@ class ContentionSim : public GlobAlloc {
         volatile bool terminate;
 
         volatile uint32_t threadsDone;
+        volatile uint32_t domainsLeft; //unfinished domains in this phase (with stealing)
         volatile uint32_t threadTicket; //used only at init
 
         volatile bool inCSim; //true when inside contention simulation
@@ -126,7 +140,7 @@ class ContentionSim : public GlobAlloc {
         lock_t postMortemLock;
 
     public:
-        ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads);
+        ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads, bool _stealing);
 
         void initStats(AggregateStat* parentStat);
 
@@ -150,6 +164,12 @@ class ContentionSim : public GlobAlloc {
         }
 
         void setPrio(uint32_t domain, uint32_t prio) {domains[domain].prio = prio;}
+        void countStall(uint32_t domain) {domains[domain].profStalls.inc();}  // a crossing was requeued; only domain's thread calls this
+
+        //Weave-phase activity over all domains, for PhaseController. Call between phases.
+        uint64_t getCrossings() const; //cumulative
+        uint64_t getStalls() const; //cumulative
+        uint64_t getQueuedEvents() const; //queued for future phases
 
 #if PROFILE_CROSSINGS
         void profileCrossing(uint32_t srcDomain, uint32_t dstDomain, uint32_t count) {
@@ -162,6 +182,8 @@ class ContentionSim : public GlobAlloc {
     private:
         void simThreadLoop(uint32_t thid);
         void simulatePhaseThread(uint32_t thid);
+        void simulatePhaseStealing(uint32_t thid);
+        DomainData* stealDomain(uint32_t thid, bool& stalled);
 
         static void SimThreadTrampoline(void* arg);
 };
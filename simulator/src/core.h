@@ -49,6 +49,18 @@ struct BblInfo {
     DynBbl oooBbl[0]; //0 bytes, but will be 1-sized when we have an element (and that element has variable size as well)
 };
 
+/* A memory access buffered by the instrumentation (sim.bufferedMemInstr).
+ * Each basic block's accesses are handed to the core in program order, right
+ * before the next basic block.
+ */
+struct BufferedAccess {
+    ADDRINT addr;
+    UINT32 size;
+    UINT32 isStore;
+};
+
+#define MAX_BUFFERED_ACCESSES (64)  // basic blocks with more accesses use per-access calls
+
 /* Analysis function pointer struct
  * As an artifact of having a shared code cache, we need these to be the same for different core types.
  */
@@ -66,7 +78,8 @@ struct InstrFuncPtrs {  // NOLINT(whitespace)
     void (*OffloadBegin)(THREADID); 
     void (*OffloadEnd)(THREADID); 
     uint64_t type;
-    uint64_t pad[1];
+    // Optional; if NULL, buffered accesses are replayed through loadPtr/storePtr
+    void (*memBatchPtr)(THREADID, const BufferedAccess*, UINT32);
     //NOTE: By having the struct be a power of 2 bytes, indirect calls are simpler (w/ gcc 4.4 -O3, 6->5 instructions, and those instructions are simpler)
 };
 
@@ -176,6 +176,7 @@ DDRMemory::DDRMemory(uint32_t _lineSize, uint32_t _colSize, uint32_t _ranksPerCh
 
     info("%s: domain %d, %d ranks/ch %d banks/rank, tech %s, boundLat %d rd / %d wr",
             name.c_str(), domain, ranksPerChannel, banksPerRank, tech, minRdLatency, minWrLatency);
+    if (banksPerRank % bankGroups) panic("%s: %d banks/rank, but tech %s has %d bank groups", name.c_str(), banksPerRank, tech, bankGroups);
 
     minRespCycle = tCL + tBL + 1; // We subtract tCL + tBL from this on some checks; this avoids overflows
 
@@ -183,10 +184,17 @@ DDRMemory::DDRMemory(uint32_t _lineSize, uint32_t _colSize, uint32_t _ranksPerCh
     for (uint32_t i = 0; i < ranksPerChannel; i++) banks[i].resize(banksPerRank);
 
     rankActWindows.resize(ranksPerChannel);
-    for (uint32_t i = 0; i < ranksPerChannel; i++) rankActWindows[i].init(4);  // we only model FAW; for TAW (other technologies) change this to 2
+    for (uint32_t i = 0; i < ranksPerChannel; i++) rankActWindows[i].init(actWindowActs);
 
-    // We get line addresses, and for a 64-byte line, there are _colSize/(JEDEC_BUS_WIDTH/8) lines/page
-    uint32_t colBits = ilog2(_colSize/(JEDEC_BUS_WIDTH/8)*64/lineSize);
+    groupActCycles.resize(ranksPerChannel);
+    groupCmdCycles.resize(ranksPerChannel);
+    for (uint32_t i = 0; i < ranksPerChannel; i++) {
+        groupActCycles[i].resize(bankGroups);
+        groupCmdCycles[i].resize(bankGroups);
+    }
+
+    // We get line addresses, and for a 64-byte line, there are _colSize/(busWidth/8) lines/page
+    uint32_t colBits = ilog2(_colSize/(busWidth/8)*64/lineSize);
     uint32_t bankBits = ilog2(banksPerRank);
     uint32_t rankBits = ilog2(ranksPerChannel);
 
@@ -286,6 +294,7 @@ DDRMemory::AddrLoc DDRMemory::mapLineAddr(Address lineAddr) {
     l.rank = (lineAddr >> rankShift) & rankMask;
     l.bank = (lineAddr >> bankShift) & bankMask;
     l.row  = lineAddr >> rowShift;
+    l.group = l.bank % bankGroups;  // consecutive banks alternate groups
 
     //info("0x%lx r%ld:c%d b%d:r%d", lineAddr, l.row, l.col, l.bank, l.rank);
     assert(l.rank < ranksPerChannel);
@@ -484,8 +493,10 @@ uint64_t DDRMemory::findMinCmdCycle(const Request& r) const {
         }
         uint64_t actCycle = std::max(r.arrivalCycle, std::max(preCycle + tRP, bank.lastActCycle + tRRD));
         actCycle = std::max(actCycle, rankActWindows[r.loc.rank].minActCycle() + tFAW);
+        if (bankGroups > 1) actCycle = std::max(actCycle, minGroupCycle(groupActCycles[r.loc.rank], r.loc.group, tRRDL, tRRDS));
         minCmdCycle = actCycle + tRCD;
     }
+    if (bankGroups > 1) minCmdCycle = std::max(minCmdCycle, minGroupCycle(groupCmdCycles[r.loc.rank], r.loc.group, tCCDL, tCCDS));
     return minCmdCycle;
 }
 
@@ -568,6 +579,7 @@ uint64_t DDRMemory::trySchedule(uint64_t curCycle, uint64_t sysCycle) {
 
         uint64_t actCycle = std::max(r->arrivalCycle, std::max(preCycle + tRP, bank.lastActCycle + tRRD));
         actCycle = std::max(actCycle, rankActWindows[r->loc.rank].minActCycle() + tFAW);
+        if (bankGroups > 1) actCycle = std::max(actCycle, minGroupCycle(groupActCycles[r->loc.rank], r->loc.group, tRRDL, tRRDS));
 
         // Record ACT
         bank.open = true;
@@ -575,14 +587,19 @@ uint64_t DDRMemory::trySchedule(uint64_t curCycle, uint64_t sysCycle) {
         if (preIssued) bank.minPreCycle = preCycle + tRAS;
         rankActWindows[r->loc.rank].addActivation(actCycle);
         bank.lastActCycle = actCycle;
+        uint64_t& groupActCycle = groupActCycles[r->loc.rank][r->loc.group];
+        groupActCycle = std::max(groupActCycle, actCycle);  // ACTs may be recorded somewhat out of order
 
         minCmdCycle = std::max(minCmdCycle, actCycle + tRCD);
     }
 
+    if (bankGroups > 1) minCmdCycle = std::max(minCmdCycle, minGroupCycle(groupCmdCycles[r->loc.rank], r->loc.group, tCCDL, tCCDS));
+
     // Figure out data bus constraints, find actual time at which command is issued
     uint64_t cmdCycle = std::max(minCmdCycle, minRespCycle - tCL);
     minRespCycle = cmdCycle + tCL + tBL;
     lastCmdWasWrite = r->write;
+    groupCmdCycles[r->loc.rank][r->loc.group] = cmdCycle;
 
     // Record PRE
     // if closed-page, close (auto-precharge) if no more row buffer hits
@@ -663,10 +680,42 @@ void DDRMemory::initTech(const char* techName) {
     std::string tech(techName);
     double tCK;
 
-    // tBL's below are for 64-byte lines; we adjust as needed
+    // tBL's and tCCD's below are for 64-byte lines; we adjust as needed
+    // Unless set, there are no bank groups, and we model tFAW on a 64-bit bus
+    busWidth = JEDEC_BUS_WIDTH;
+    bankGroups = 1;
+    tRRDS = tRRDL = tCCDS = tCCDL = 0;
+    actWindowActs = 4;
+
+    /* Stacked technologies describe one instance (a vault or pseudo-channel),
+     * so they have a single rank. Use sys.mem.channels for the whole stack.
+     */
 
     // Please keep this orderly; go from faster to slower technologies
-    if (tech == "DDR4-2400-CL17") {
+    if (tech == "HMC-2500") {
+        // One vault, from ramulator's HMC_2500 (tCK 0.8, 32 TSVs, 32B bursts of 4 cycles)
+        // At tCK 0.8, memFreq < sysFreq/2 would need cores above 2.5 GHz, so we run
+        // the vault controller at half the DRAM clock, rounding cycles up
+        tCK = 1.6;
+        busWidth = 32;
+        bankGroups = 4;
+        tBL = 4;    // 2 bursts
+        tCL = 9;    // 17
+        tRCD = 9;   // 17
+        tRTP = 5;   // 9
+        tRP = 9;    // 17
+        tRRD = 4;   // 8 (tRRD_L)
+        tRRDS = 4;  // 7
+        tRRDL = 4;  // 8
+        tRAS = 17;  // 34
+        tFAW = 9;   // 17
+        tWTR = 5;   // 9 (tWTR_L)
+        tWR = 10;   // 19
+        tRFC = 100; // 200
+        tREFI = 4875; // 9750
+        tCCDS = 4;  // 2 bursts of tCCD_S = 4
+        tCCDL = 6;  // 2 bursts of tCCD_L = 6
+    } else if (tech == "DDR4-2400-CL17") {
         // From https://github.com/uart/gem5-mirror/blob/master/src/mem/DRAMCtrl.py
         tCK = 0.833;
         tBL = 4;
@@ -681,8 +730,29 @@ void DDRMemory::initTech(const char* techName) {
         tWR = 18;
         tRFC = 260;
         tREFI = 7800;
-    }
-    else if (tech == "DDR3-1333-CL10") {
+    } else if (tech == "HBM2-2000") {
+        // One 64-bit pseudo-channel (BL4, 32B per column access) of a 2 Gbps HBM2 stack,
+        // JESD235A-class timings for 8Gb dies (as in DRAMsim3's HBM2_8Gb_x128)
+        tCK = 1.0;
+        busWidth = 64;
+        bankGroups = 4;
+        tBL = 4;    // 2 bursts
+        tCL = 14;
+        tRCD = 14;
+        tRTP = 5;
+        tRP = 14;
+        tRRD = 6;
+        tRRDS = 4;
+        tRRDL = 6;
+        tRAS = 34;
+        tFAW = 16;
+        tWTR = 8;
+        tWR = 16;
+        tRFC = 350;
+        tREFI = 3900;
+        tCCDS = 4;  // 2 bursts of tCCD_S = 2
+        tCCDL = 8;  // 2 bursts of tCCD_L = 4
+    } else if (tech == "DDR3-1333-CL10") {
         // from DRAMSim2/ini/DDR3_micron_16M_8B_x4_sg15.ini (Micron)
         tCK = 1.5;  // ns; all other in mem cycles
         tBL = 4;
@@ -728,6 +798,28 @@ void DDRMemory::initTech(const char* techName) {
         tWR = 8;
         tRFC = 59;
         tREFI = 4160;
+    } else if (tech == "HBM-1000") {
+        // One 128-bit legacy-mode channel, from ramulator's HBM_1Gbps (64B bursts)
+        // Ramulator has no tRFC for HBM; 160 ns is the JESD235 value for 4Gb dies
+        tCK = 2.0;
+        busWidth = 128;
+        bankGroups = 4;
+        tBL = 2;
+        tCL = 7;
+        tRCD = 7;
+        tRTP = 7;
+        tRP = 7;
+        tRRD = 5;
+        tRRDS = 4;
+        tRRDL = 5;
+        tRAS = 17;
+        tFAW = 20;
+        tWTR = 4;
+        tWR = 8;
+        tRFC = 80;
+        tREFI = 1950;
+        tCCDS = 2;
+        tCCDL = 3;
     } else {
         panic("Unknown technology %s, you'll need to define it", techName);
     }
@@ -735,11 +827,16 @@ void DDRMemory::initTech(const char* techName) {
     // Check all params were set
     assert(tCK > 0.0);
     assert(tBL && tCL && tRCD && tRTP && tRP && tRRD && tRAS && tFAW && tWTR && tWR && tRFC && tREFI);
+    assert(bankGroups == 1 || (tRRDS && tRRDL && tCCDS && tCCDL));
 
     if (isPow2(lineSize) && lineSize >= 64) {
         tBL = lineSize*tBL/64;
+        tCCDS = lineSize*tCCDS/64;
+        tCCDL = lineSize*tCCDL/64;
     } else if (lineSize == 32) {
         tBL = tBL/2;
+        tCCDS = tCCDS/2;
+        tCCDL = tCCDL/2;
     } else {
         // If we wanted shorter lines, we'd have to start really caring about contention in the command bus;
         // even 32 bytes is pushing it, 32B probably calls for coalescing buffers
@@ -26,6 +26,7 @@
 #ifndef DDR_MEM_H_
 #define DDR_MEM_H_
 
+#include <algorithm>
 #include <deque>
 
 #include "g_std/g_string.h"
@@ -132,7 +133,8 @@ class RequestQueue {
 class DDRMemoryAccEvent;
 class SchedEvent;
 
-// Single-channel controller. For multiple channels, use multiple controllers.
+// Single-channel controller. For multiple channels, use multiple controllers,
+// or sys.mem.channels (e.g., HBM pseudo-channels or HMC vaults) to split one.
 class DDRMemory : public MemObject {
     private:
 
@@ -141,6 +143,7 @@ class DDRMemory : public MemObject {
             uint32_t bank;
             uint32_t rank;
             uint32_t col;
+            uint32_t group;  // bank group, bank % bankGroups
         };
 
         struct Request : InListNode<Request> {
@@ -186,6 +189,7 @@ class DDRMemory : public MemObject {
         bool lastCmdWasWrite;
 
         static const uint32_t JEDEC_BUS_WIDTH = 64;
+        uint32_t busWidth;  // data bus bits; JEDEC_BUS_WIDTH for DIMMs, narrower or wider for stacked DRAM
         const uint32_t lineSize, ranksPerChannel, banksPerRank;
         const uint32_t controllerSysLatency;  // in sysCycles
         const uint32_t queueDepth;
@@ -203,12 +207,19 @@ class DDRMemory : public MemObject {
         uint32_t tRP;    // PRE to ACT
         uint32_t tRRD;   // ACT to ACT
         uint32_t tRAS;   // ACT to PRE
-        uint32_t tFAW;   // No more than 4 ACTs per rank in this window
+        uint32_t tFAW;   // No more than actWindowActs ACTs per rank in this window
         uint32_t tWTR;   // end of WR burst to RD command
         uint32_t tWR;    // end of WR burst to PRE
         uint32_t tRFC;   // Refresh to ACT (refresh leaves rows closed)
         uint32_t tREFI;  // Refresh interval
 
+        // Bank groups (0s and 1 group for technologies without them)
+        // tCCDs are for back-to-back lines, like tBL
+        uint32_t bankGroups;
+        uint32_t tRRDS, tRRDL;  // ACT to ACT, different/same bank group of a rank
+        uint32_t tCCDS, tCCDL;  // RD/WR to RD/WR, different/same bank group of a rank
+        uint32_t actWindowActs; // ACTs per tFAW (4), or per tTAW (2)
+
         // Address mapping information
         uint32_t colShift, colMask;
         uint32_t rankShift, rankMask;
@@ -224,6 +235,7 @@ class DDRMemory : public MemObject {
 
         g_vector< g_vector<Bank> > banks; // indexed by rank, bank
         g_vector<ActWindow> rankActWindows;
+        g_vector< g_vector<uint64_t> > groupActCycles, groupCmdCycles;  // last ACT and RD/WR, indexed by rank, group
 
         // Event scheduling
         SchedEvent* nextSchedEvent;
@@ -285,6 +297,15 @@ class DDRMemory : public MemObject {
         inline uint64_t trySchedule(uint64_t curCycle, uint64_t sysCycle);
         uint64_t findMinCmdCycle(const Request& r) const;
 
+        // Min cycle for a command to group given the last command to each group of the rank
+        inline uint64_t minGroupCycle(const g_vector<uint64_t>& lastCycles, uint32_t group, uint32_t tSame, uint32_t tDiff) const {
+            uint64_t minCycle = 0;
+            for (uint32_t g = 0; g < lastCycles.size(); g++) {
+                minCycle = std::max(minCycle, lastCycles[g] + ((g == group)? tSame : tDiff));
+            }
+            return minCycle;
+        }
+
         void initTech(const char* tech);
 };
 
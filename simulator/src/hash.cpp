@@ -29,7 +29,7 @@
 #include "log.h"
 #include "mtrand.h"
 
-H3HashFamily::H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed) : numFuncs(numFunctions) {
+H3HashFamily::H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed, bool useTables) : numFuncs(numFunctions), hTables(nullptr) {
     MTRand rnd(randSeed);
 
     if (outputBits <= 8) {
@@ -59,10 +59,28 @@ H3HashFamily::H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t
             hMatrix[ii*words + jj] = val;
         }
     }
+
+    if (useTables) {
+        // Table k holds the hashes of every value of input byte k. Since the hash is linear, each entry is
+        // the entry without its lowest set bit XOR'd with the hash of that bit
+        uint64_t* tables = gm_calloc<uint64_t>(numFuncs*8*256);
+        for (uint32_t ii = 0; ii < numFuncs; ii++) {
+            for (uint32_t k = 0; k < 8; k++) {
+                uint64_t* t = &tables[(ii*8 + k)*256];
+                t[0] = 0;
+                for (uint32_t v = 1; v < 256; v++) {
+                    uint32_t low = __builtin_ctz(v);
+                    t[v] = t[v & (v - 1)] ^ hashMatrix(ii, 1ul << (8*k + low));
+                }
+            }
+        }
+        hTables = tables;
+    }
 }
 
 H3HashFamily::~H3HashFamily() {
     gm_free(hMatrix);
+    if (hTables) gm_free(hTables);
 }
 
 /* NOTE: This is fairly well hand-optimized. Go to the commit logs to see the speedup of this function. Main things:
@@ -77,7 +95,7 @@ H3HashFamily::~H3HashFamily() {
  *     res = (res << 1) | (res >> 63);
  * }
  */
-uint64_t H3HashFamily::hash(uint32_t id, uint64_t val) {
+uint64_t H3HashFamily::hashMatrix(uint32_t id, uint64_t val) {
     uint64_t res = 0;
     assert(id >= 0 && id < numFuncs);
 
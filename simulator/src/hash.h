@@ -27,6 +27,7 @@
 #define HASH_H_
 
 #include <stdint.h>
+#include "log.h"
 #include "galloc.h"
 
 class HashFamily : public GlobAlloc {
@@ -37,15 +38,30 @@ class HashFamily : public GlobAlloc {
         virtual uint64_t hash(uint32_t id, uint64_t val) = 0;
 };
 
+/* H3 is linear over GF(2): the hash of val is the XOR of the hashes of its bytes. So by default, hash()
+ * looks up 8 precomputed tables (one per input byte, 16KB per function) instead of going over the
+ * 64-row matrix. Both kernels produce bit-for-bit identical (unmasked) outputs; src/hashbench.cpp
+ * checks and times them.
+ */
 class H3HashFamily : public HashFamily {
     private:
         const uint32_t numFuncs;
         uint32_t resShift;
         uint64_t* hMatrix;
+        uint64_t* hTables;  // nullptr if not using tables
     public:
-        H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed = 123132127);
+        H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed = 123132127, bool useTables = true);
         virtual ~H3HashFamily();
-        uint64_t hash(uint32_t id, uint64_t val);
+
+        uint64_t hash(uint32_t id, uint64_t val) {
+            if (!hTables) return hashMatrix(id, val);
+            assert(id < numFuncs);
+            const uint64_t* t = &hTables[id << 11];
+            return t[val & 0xff] ^ t[256 | ((val >> 8) & 0xff)] ^ t[512 | ((val >> 16) & 0xff)] ^ t[768 | ((val >> 24) & 0xff)] ^
+                t[1024 | ((val >> 32) & 0xff)] ^ t[1280 | ((val >> 40) & 0xff)] ^ t[1536 | ((val >> 48) & 0xff)] ^ t[1792 | (val >> 56)];
+        }
+
+        uint64_t hashMatrix(uint32_t id, uint64_t val);
 };
 
 class SHA1HashFamily : public HashFamily {
@@ -0,0 +1,98 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmark for H3HashFamily: checks that the table-driven and matrix
+ * kernels produce identical outputs and reports ns/hash for each, for the
+ * output widths and function counts used by cache arrays and UMONs.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "galloc.h"
+#include "hash.h"
+#include "log.h"
+#include "mtrand.h"
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+// Hash a dependent chain of values, like consecutive lookups of an address stream
+template <bool tables>
+static double timeKernel(H3HashFamily* hf, uint32_t funcs, const uint64_t* vals, uint32_t numVals, uint32_t reps, uint64_t* sink) {
+    uint64_t acc = 0;
+    double start = now();
+    for (uint32_t r = 0; r < reps; r++) {
+        for (uint32_t i = 0; i < numVals; i++) {
+            uint64_t v = vals[i] ^ (acc & 1);
+            for (uint32_t f = 0; f < funcs; f++) {
+                acc += tables? hf->hash(f, v) : hf->hashMatrix(f, v);
+            }
+        }
+    }
+    double elapsed = now() - start;
+    *sink += acc;
+    return elapsed/((double)reps*numVals*funcs);
+}
+
+int main(int argc, char *argv[]) {
+    InitLog("[B] ");
+    uint32_t reps = (argc > 1)? atoi(argv[1]) : 100;
+    gm_init(64 << 20);
+
+    const uint32_t numVals = 1 << 16;
+    uint64_t* vals = gm_calloc<uint64_t>(numVals);
+    MTRand rnd(42);
+    for (uint32_t i = 0; i < numVals; i++) {
+        // Line addresses: random, with a sequential run every 16 values
+        vals[i] = (i % 16)? (vals[i-1] + 1) : ((((uint64_t)rnd.randInt()) << 32) | rnd.randInt()) >> 6;
+    }
+
+    uint64_t sink = 0;
+    const uint32_t outputBits[] = {8, 16, 32, 64};
+    const uint32_t funcCounts[] = {1, 4};
+    info("%8s %6s %14s %14s %8s", "outBits", "funcs", "matrix ns/hash", "tables ns/hash", "speedup");
+    for (uint32_t bits : outputBits) {
+        for (uint32_t funcs : funcCounts) {
+            H3HashFamily* hf = new H3HashFamily(funcs, bits, 0xCAC7EAFFA1);
+            for (uint32_t i = 0; i < numVals; i++) {
+                for (uint32_t f = 0; f < funcs; f++) {
+                    if (hf->hash(f, vals[i]) != hf->hashMatrix(f, vals[i])) {
+                        panic("Kernel mismatch: %d bits, function %d, value 0x%lx", bits, f, vals[i]);
+                    }
+                }
+            }
+            double matrixNs = timeKernel<false>(hf, funcs, vals, numVals, reps, &sink);
+            double tablesNs = timeKernel<true>(hf, funcs, vals, numVals, reps, &sink);
+            info("%8d %6d %14.2f %14.2f %7.2fx", bits, funcs, matrixNs, tablesNs, matrixNs/tablesNs);
+            delete hf;
+        }
+    }
+    info("Done (checksum 0x%lx)", sink);
+    return 0;
+}
@@ -28,6 +28,7 @@
 #include <vector>
 #include "galloc.h"
 #include "log.h"
+#include "self_profiler.h"
 #include "stats.h"
 #include "zsim.h"
 
@@ -267,6 +268,8 @@ HDF5Backend::HDF5Backend(const char* filename, AggregateStat* rootStat, size_t b
 }
 
 void HDF5Backend::dump(bool buffered) {
+    uint64_t startNs = zinfo->selfProf? getNs() : 0;
     backend->dump(buffered);
+    if (zinfo->selfProf) zinfo->selfProf->statsDump(getNs() - startNs);
 }
 
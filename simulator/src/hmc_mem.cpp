@@ -0,0 +1,284 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hmc_mem.h"
+#include <algorithm>
+#include <math.h>
+#include "bithacks.h"
+#include "zsim.h"
+
+static uint32_t hmcToCpuCycles(double hmcCycles, double tCK, uint32_t cpuFreqMHz) {
+    return (uint32_t)(hmcCycles*tCK*cpuFreqMHz/1000.0 + 0.5);
+}
+
+// M/D/1 mean wait (Pollaczek-Khinchine) for a server with the given utilization and service time
+static double md1Wait(double load, double serviceCycles) {
+    if (load > 0.95) load = 0.95;
+    return 0.5*load/(1.0 - load)*serviceCycles;
+}
+
+HMCModel::HMCModel(const Params& params, uint32_t cpuFreqMHz) : p(params) {
+    if (!isPow2(p.vaults) || !isPow2(p.banksPerVault) || !isPow2(p.blockBytes) || !isPow2(p.rowBytes)) {
+        panic("HMC: vaults (%d), banks (%d), block (%d) and row (%d) sizes must be powers of 2",
+                p.vaults, p.banksPerVault, p.blockBytes, p.rowBytes);
+    }
+    if (p.rowBytes < p.blockBytes) panic("HMC: row size (%d) must be >= block size (%d)", p.rowBytes, p.blockBytes);
+    assert(p.links > 0 && p.linkLanes > 0 && p.laneGbps > 0.0);
+
+    // Same layout as Ramulator's RoCoBaVa: block | vault | bank | row-internal block | row
+    blockBits = ilog2(p.blockBytes);
+    vaultBits = ilog2(p.vaults);
+    bankBits = ilog2(p.banksPerVault);
+    rowShift = blockBits + vaultBits + bankBits + ilog2(p.rowBytes/p.blockBytes);
+
+    cl = hmcToCpuCycles(p.tCL, p.tCK, cpuFreqMHz);
+    rcd = hmcToCpuCycles(p.tRCD, p.tCK, cpuFreqMHz);
+    rp = hmcToCpuCycles(p.tRP, p.tCK, cpuFreqMHz);
+    ras = hmcToCpuCycles(p.tRAS, p.tCK, cpuFreqMHz);
+    refi = hmcToCpuCycles(p.tREFI, p.tCK, cpuFreqMHz);
+    // Host accesses move a whole packet payload through the vault, PIM accesses a single line
+    uint32_t hostColumns = std::max(1u, p.payloadFlits*p.flitBytes/p.columnBytes);
+    uint32_t pimColumns = std::max(1u, p.lineBytes/p.columnBytes);
+    hostBus = std::max(1u, hmcToCpuCycles(hostColumns*p.tBL, p.tCK, cpuFreqMHz));
+    hostBankBusy = hmcToCpuCycles(hostColumns*p.tCCDL, p.tCK, cpuFreqMHz);
+    pimBus = std::max(1u, hmcToCpuCycles(pimColumns*p.tBL, p.tCK, cpuFreqMHz));
+    pimBankBusy = hmcToCpuCycles(pimColumns*p.tCCDL, p.tCK, cpuFreqMHz);
+    uint32_t fixed = hmcToCpuCycles(p.fixedLatency, p.tCK, cpuFreqMHz);
+    fixedReq = fixed/2;
+    fixedResp = fixed - fixedReq;
+    uint32_t pimFixed = hmcToCpuCycles(p.pimFixedLatency, p.tCK, cpuFreqMHz);
+    pimFixedReq = pimFixed/2;
+    pimFixedResp = pimFixed - pimFixedReq;
+    hop = hmcToCpuCycles(p.hopCycles, p.tCK, cpuFreqMHz);
+
+    // Links send whole packets and only start one at an HMC cycle boundary
+    double flitHmcCycles = (p.flitBytes*8.0)/(p.linkLanes*p.laneGbps)/p.tCK;  // Gbps == bits/ns
+    packetCycles.resize(2 + p.payloadFlits);
+    for (uint32_t f = 0; f < packetCycles.size(); f++) {
+        packetCycles[f] = hmcToCpuCycles(ceil(f*flitHmcCycles), p.tCK, cpuFreqMHz);
+    }
+
+    vaults.resize(p.vaults);
+    for (Vault& v : vaults) {
+        v.busFreeCycle = 0;
+        v.lastArrivalCycle = 0;
+        v.busyCycles = 0;
+        v.busyLoad = 0.0;
+        v.banks.resize(p.banksPerVault);
+        for (Bank& b : v.banks) {
+            b.openRow = -1;
+            b.readyCycle = 0;
+            b.actCycle = 0;
+            b.lastCycle = 0;
+        }
+    }
+
+    links.resize(p.links);
+    for (Link& l : links) {
+        for (uint32_t d = 0; d < 2; d++) {
+            l.busyCycles[d] = 0;
+            l.packets[d] = 0;
+            l.queueDelay[d] = 0.0;
+        }
+    }
+}
+
+HMCModel::Result HMCModel::access(Address addr, uint64_t cycle, bool isWrite, int32_t srcVault) {
+    Address block = addr >> blockBits;
+    uint32_t vaultIdx = block & (p.vaults - 1);
+    Vault& vault = vaults[vaultIdx];
+    Bank& bank = vault.banks[(block >> vaultBits) & (p.banksPerVault - 1)];
+    int64_t row = addr >> rowShift;
+
+    Result res;
+    res.vault = vaultIdx;
+    res.linkQueueCycles = 0;
+
+    // Request path: host link (or PIM mesh) to the vault controller
+    uint64_t arrivalCycle;
+    uint32_t respCycles;
+    uint32_t bus = (srcVault < 0)? hostBus : pimBus;
+    uint32_t bankBusy = (srcVault < 0)? hostBankBusy : pimBankBusy;
+    if (srcVault < 0) {
+        uint32_t reqFlits = isWrite? 1 + p.payloadFlits : 1;
+        uint32_t respFlits = isWrite? 1 : 1 + p.payloadFlits;
+        // Links are picked by the low block bits, as Ramulator's source link ID
+        Link& link = links[block % p.links];
+        // The response direction also carries the token return for the request flits
+        __sync_fetch_and_add(&link.busyCycles[0], packetCycles[reqFlits]);
+        __sync_fetch_and_add(&link.busyCycles[1], packetCycles[respFlits] + packetCycles[1]);
+        __sync_fetch_and_add(&link.packets[0], 1);
+        __sync_fetch_and_add(&link.packets[1], 1);
+
+        uint32_t reqQueue = (uint32_t)link.queueDelay[0];
+        uint32_t respQueue = (uint32_t)link.queueDelay[1];
+        res.linkQueueCycles = reqQueue + respQueue;
+        arrivalCycle = cycle + fixedReq + reqQueue + packetCycles[reqFlits];
+        respCycles = respQueue + packetCycles[respFlits] + fixedResp;
+    } else {
+        uint32_t srcX = srcVault / p.meshWidth, srcY = srcVault % p.meshWidth;
+        uint32_t dstX = vaultIdx / p.meshWidth, dstY = vaultIdx % p.meshWidth;
+        uint32_t hops = std::max(srcX, dstX) - std::min(srcX, dstX) + std::max(srcY, dstY) - std::min(srcY, dstY);
+        arrivalCycle = cycle + pimFixedReq + hops*hop;
+        respCycles = pimFixedResp + (isWrite? 0 : hops*hop);
+    }
+
+    // Vault: bank timing from the open row, then the shared data bus
+    res.outOfOrder = arrivalCycle < vault.lastArrivalCycle;
+    uint64_t bankStart = res.outOfOrder? arrivalCycle : std::max(arrivalCycle, bank.readyCycle);
+    if (refi && bank.openRow != -1 && bankStart/refi != bank.lastCycle/refi) bank.openRow = -1;
+    bank.lastCycle = std::max(bank.lastCycle, bankStart);
+    uint32_t arrayCycles;
+    res.rowHit = (bank.openRow == row);
+    res.rowConflict = !res.rowHit && bank.openRow != -1;
+    if (res.rowHit) {
+        arrayCycles = cl;
+    } else if (!res.rowConflict) {
+        arrayCycles = rcd + cl;
+        bank.actCycle = bankStart;
+    } else {
+        // Precharge must wait tRAS since the activation of the open row
+        if (!res.outOfOrder) bankStart = std::max(bankStart, bank.actCycle + ras);
+        arrayCycles = rp + rcd + cl;
+        bank.actCycle = bankStart + rp;
+    }
+    bank.openRow = row;
+    // Column accesses to the same bank (group) are spaced by tCCD_L
+    bank.readyCycle = std::max(bank.readyCycle, bankStart + arrayCycles - cl + bankBusy);
+
+    uint64_t dataCycle = bankStart + arrayCycles;
+    uint64_t busStart = res.outOfOrder? dataCycle + (uint64_t)md1Wait(vault.busyLoad, bus) : std::max(dataCycle, vault.busFreeCycle);
+    // Out-of-order requests still take bus time, so later requests queue behind them
+    vault.busFreeCycle = std::max(vault.busFreeCycle, busStart) + bus;
+    vault.lastArrivalCycle = std::max(vault.lastArrivalCycle, arrivalCycle);
+    vault.busyCycles += bus;
+    res.vaultQueueCycles = (bankStart - arrivalCycle) + (busStart - dataCycle);
+
+    res.respCycle = busStart + bus + respCycles;
+    return res;
+}
+
+void HMCModel::updateWindow(uint64_t windowCycles) {
+    if (!windowCycles) return;
+    for (Vault& v : vaults) {
+        v.busyLoad = 0.5*v.busyLoad + 0.5*((double)v.busyCycles)/windowCycles;
+        v.busyCycles = 0;
+    }
+    for (Link& l : links) {
+        for (uint32_t d = 0; d < 2; d++) {
+            double wait = 0.0;
+            if (l.packets[d]) {
+                double load = ((double)l.busyCycles[d])/windowCycles;
+                wait = md1Wait(load, ((double)l.busyCycles[d])/l.packets[d]);
+            }
+            l.queueDelay[d] = 0.5*l.queueDelay[d] + 0.5*wait;
+            l.busyCycles[d] = 0;
+            l.packets[d] = 0;
+        }
+    }
+}
+
+HMCMemory::HMCMemory(const HMCModel::Params& params, uint32_t cpuFreqMHz, bool _pimMode, g_string& _name)
+    : name(_name), pimMode(_pimMode), lastPhase(0), lastPhaseCycles(0)
+{
+    model = new HMCModel(params, cpuFreqMHz);
+    vaultLocks = gm_calloc<lock_t>(params.vaults);
+    for (uint32_t v = 0; v < params.vaults; v++) futex_init(&vaultLocks[v]);
+    futex_init(&updateLock);
+}
+
+void HMCMemory::initStats(AggregateStat* parentStat) {
+    AggregateStat* memStats = new AggregateStat();
+    memStats->init(name.c_str(), "Memory controller stats");
+    profReads.init("rd", "Read requests"); memStats->append(&profReads);
+    profWrites.init("wr", "Write requests"); memStats->append(&profWrites);
+    profTotalRdLat.init("rdlat", "Total latency experienced by read requests"); memStats->append(&profTotalRdLat);
+    profTotalWrLat.init("wrlat", "Total latency experienced by write requests"); memStats->append(&profTotalWrLat);
+    profRowHits.init("rowHits", "Accesses that hit in the open row"); memStats->append(&profRowHits);
+    profRowConflicts.init("rowConflicts", "Accesses that had to close another open row"); memStats->append(&profRowConflicts);
+    profLinkQueueCycles.init("linkQueueCycles", "Total cycles queued at the host links"); memStats->append(&profLinkQueueCycles);
+    profVaultQueueCycles.init("vaultQueueCycles", "Total cycles queued at banks and vault buses"); memStats->append(&profVaultQueueCycles);
+    profOutOfOrder.init("outOfOrder", "Accesses older than the latest one seen by their vault (M/D/1 queueing estimate)"); memStats->append(&profOutOfOrder);
+    profVaultAccesses.init("vaultAccesses", "Accesses per vault", model->getNumVaults()); memStats->append(&profVaultAccesses);
+    parentStat->append(memStats);
+}
+
+uint64_t HMCMemory::access(MemReq& req) {
+    if (zinfo->numPhases > lastPhase) {
+        futex_lock(&updateLock);
+        //Recheck, someone may have updated already
+        if (zinfo->numPhases > lastPhase) {
+            model->updateWindow(zinfo->globPhaseCycles - lastPhaseCycles);
+            lastPhaseCycles = zinfo->globPhaseCycles;
+            __sync_synchronize();
+            lastPhase = zinfo->numPhases;
+        }
+        futex_unlock(&updateLock);
+    }
+
+    switch (req.type) {
+        case PUTS:
+        case PUTX:
+            *req.state = I;
+            break;
+        case GETS:
+            *req.state = req.is(MemReq::NOEXCL)? S : E;
+            break;
+        case GETX:
+            *req.state = M;
+            break;
+        default: panic("!?");
+    }
+
+    if (req.type == PUTS) return req.cycle; //Not a real access
+
+    bool isWrite = (req.type == PUTX);
+    Address addr = req.lineAddr << lineBits;
+    uint32_t vault = model->getVault(addr);
+    // PIM cores sit on the logic layer, one per vault
+    int32_t srcVault = pimMode? (int32_t)(req.srcId % model->getNumVaults()) : -1;
+
+    futex_lock(&vaultLocks[vault]);
+    HMCModel::Result res = model->access(addr, req.cycle, isWrite, srcVault);
+    futex_unlock(&vaultLocks[vault]);
+
+    uint64_t latency = res.respCycle - req.cycle;
+    if (isWrite) {
+        profWrites.atomicInc();
+        profTotalWrLat.atomicInc(latency);
+    } else {
+        profReads.atomicInc();
+        profTotalRdLat.atomicInc(latency);
+    }
+    if (res.rowHit) profRowHits.atomicInc();
+    if (res.rowConflict) profRowConflicts.atomicInc();
+    if (res.outOfOrder) profOutOfOrder.atomicInc();
+    profLinkQueueCycles.atomicInc(res.linkQueueCycles);
+    profVaultQueueCycles.atomicInc(res.vaultQueueCycles);
+    profVaultAccesses.atomicInc(vault);
+
+    zinfo->num_dram_requests += 1;
+    return res.respCycle;
+}
@@ -0,0 +1,177 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HMC_MEM_H_
+#define HMC_MEM_H_
+
+#include "g_std/g_string.h"
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "locks.h"
+#include "memory_hierarchy.h"
+#include "pad.h"
+#include "stats.h"
+
+/* Analytical model of a single HMC cube, meant as a fast stand-in for the
+ * cycle-level Ramulator HMC model (see README.hmc for its calibration).
+ *
+ * Nothing is ticked. Each access computes its latency in one pass:
+ *  - Link serialization (flits / lane rate) in each direction, plus an M/D/1
+ *    queueing delay from each link's measured utilization over the last window.
+ *    Each request also returns one flow-control token flit on the response link.
+ *  - Per-vault and per-bank event timestamps: bank ready time, open row (so
+ *    row hits, misses and conflicts fall out of the access stream; refreshes
+ *    close it), and the time the vault's TSV data bus frees up.
+ *  - A fixed logic-layer/SerDes latency.
+ *
+ * Bound-phase accesses reach memory out of global time order. Requests that
+ * arrive earlier than the latest one a vault has seen don't see the vault
+ * timestamps (they would queue behind the future); they get the vault's M/D/1
+ * estimate instead, but still occupy the vault so later requests queue behind
+ * them.
+ *
+ * All times are in CPU cycles; DRAM timings are converted from HMC cycles
+ * using the HMC clock period and the core frequency.
+ */
+class HMCModel : public GlobAlloc {
+    public:
+        struct Params {
+            uint32_t vaults;
+            uint32_t banksPerVault;
+            uint32_t blockBytes;    // max block: consecutive bytes mapped to one vault
+            uint32_t rowBytes;      // row buffer size per bank
+            double tCK;             // HMC clock period, in ns
+            uint32_t tCL, tRCD, tRP, tRAS;  // in HMC cycles
+            uint32_t tREFI;         // refresh interval, in HMC cycles (0 disables); refreshes close all rows
+            uint32_t tBL;           // data bus cycles per column access
+            uint32_t tCCDL;         // min cycles between column accesses to the same bank group
+            uint32_t columnBytes;   // bytes moved per column access
+            uint32_t fixedLatency;          // logic layer + SerDes round trip, in HMC cycles
+            uint32_t links;
+            uint32_t linkLanes;
+            double laneGbps;
+            uint32_t flitBytes;
+            uint32_t payloadFlits;  // data flits carried by read responses and write requests
+            uint32_t lineBytes;     // PIM mode: bytes moved per access (no packets)
+            uint32_t meshWidth;     // PIM mode: vaults form a meshWidth-wide 2D mesh
+            uint32_t hopCycles;     // PIM mode: HMC cycles per mesh hop (0 disables)
+            uint32_t pimFixedLatency;       // PIM mode: vault controller round trip, in HMC cycles
+        };
+
+        struct Result {
+            uint64_t respCycle;
+            uint32_t vault;
+            uint32_t linkQueueCycles;
+            uint32_t vaultQueueCycles;
+            bool rowHit;
+            bool rowConflict;
+            bool outOfOrder;
+        };
+
+    private:
+        struct Bank {
+            int64_t openRow;    // -1 if precharged
+            uint64_t readyCycle;
+            uint64_t actCycle;
+            uint64_t lastCycle;  // last access, to detect intervening refreshes
+        };
+
+        struct Vault {
+            uint64_t busFreeCycle;
+            uint64_t lastArrivalCycle;
+            uint64_t busyCycles;  // bus occupancy in the current window
+            double busyLoad;      // bus utilization over the last window
+
+            g_vector<Bank> banks;
+        };
+
+        struct Link {
+            uint64_t busyCycles[2];  // request, response link occupancy in the current window
+            uint64_t packets[2];
+            double queueDelay[2];
+        };
+
+        const Params p;
+        uint32_t blockBits, vaultBits, bankBits, rowShift;
+
+        // Converted to CPU cycles
+        uint32_t cl, rcd, rp, ras, refi, fixedReq, fixedResp, pimFixedReq, pimFixedResp, hop;
+        uint32_t hostBus, hostBankBusy, pimBus, pimBankBusy;  // per access
+        g_vector<uint32_t> packetCycles;  // link occupancy of a packet of N flits
+
+        g_vector<Vault> vaults;
+        g_vector<Link> links;
+
+    public:
+        HMCModel(const Params& params, uint32_t cpuFreqMHz);
+
+        uint32_t getVault(Address addr) const {
+            return (addr >> blockBits) & (p.vaults - 1);
+        }
+
+        uint32_t getNumVaults() const {return p.vaults;}
+
+        // srcVault >= 0 issues from a PIM core sitting on that vault (no links)
+        // Caller must serialize accesses to the same vault
+        Result access(Address addr, uint64_t cycle, bool isWrite, int32_t srcVault);
+
+        // Refresh the queueing estimates with the traffic seen over the last windowCycles
+        void updateWindow(uint64_t windowCycles);
+};
+
+class HMCMemory : public MemObject {
+    private:
+        HMCModel* model;
+        g_string name;
+        const bool pimMode;
+        uint64_t lastPhase;
+        uint64_t lastPhaseCycles; //globPhaseCycles at lastPhase
+
+        PAD();
+
+        Counter profReads;
+        Counter profWrites;
+        Counter profTotalRdLat;
+        Counter profTotalWrLat;
+        Counter profRowHits;
+        Counter profRowConflicts;
+        Counter profLinkQueueCycles;
+        Counter profVaultQueueCycles;
+        Counter profOutOfOrder;
+        VectorCounter profVaultAccesses;
+
+        lock_t* vaultLocks;
+        lock_t updateLock;
+        PAD();
+
+    public:
+        HMCMemory(const HMCModel::Params& params, uint32_t cpuFreqMHz, bool _pimMode, g_string& _name);
+
+        void initStats(AggregateStat* parentStat);
+        uint64_t access(MemReq& req);
+        const char* getName() {return name.c_str();}
+};
+
+#endif  // HMC_MEM_H_
@@ -49,6 +49,7 @@
 #include "filter_cache.h"
 #include "galloc.h"
 #include "hash.h"
+#include "hmc_mem.h"
 #include "ideal_arrays.h"
 #include "locks.h"
 #include "log.h"
@@ -59,7 +60,9 @@
 #include "null_core.h"
 #include "ooo_core.h"
 #include "part_repl_policies.h"
+#include "phase_controller.h"
 #include "pin_cmd.h"
+#include "prefetch_engines.h"
 #include "prefetcher.h"
 #include "proc_stats.h"
 #include "process_stats.h"
@@ -67,10 +70,12 @@
 #include "profile_stats.h"
 #include "repl_policies.h"
 #include "scheduler.h"
+#include "self_profiler.h"
 #include "simple_core.h"
 #include "stats.h"
 #include "stats_filter.h"
 #include "str.h"
+#include "synthetic_core.h"
 #include "timing_cache.h"
 #include "timing_core.h"
 #include "timing_event.h"
@@ -88,6 +93,30 @@ extern void EndOfPhaseActions(); //in zsim.cpp
  * follow the layout of zinfo, top-down.
  */
 
+/* Devirtualized SetAssoc arrays and caches (see StaticSetAssocArray, StaticCache, StaticTimingCache). The caller checks that rp
+ * is exactly an LRUReplPolicy and hf an IdHashFamily or H3HashFamily.
+ */
+template <typename R>
+static CacheArray* BuildStaticSetAssocArray(uint32_t numLines, uint32_t ways, R* rp, HashFamily* hf) {
+    if (IdHashFamily* ihf = dynamic_cast<IdHashFamily*>(hf)) return new StaticSetAssocArray<R, IdHashFamily>(numLines, ways, rp, ihf);
+    H3HashFamily* h3hf = dynamic_cast<H3HashFamily*>(hf);
+    assert(h3hf);
+    return new StaticSetAssocArray<R, H3HashFamily>(numLines, ways, rp, h3hf);
+}
+
+template <typename A>
+static Cache* BuildStaticCache(uint32_t numLines, MESICC* cc, CacheArray* array, ReplPolicy* rp, uint32_t accLat, uint32_t invLat, bool bypass, const g_string& name) {
+    A* a = dynamic_cast<A*>(array);
+    return a? new StaticCache<A, MESICC>(numLines, cc, a, rp, accLat, invLat, bypass, name) : nullptr;
+}
+
+template <typename A>
+static Cache* BuildStaticTimingCache(uint32_t numLines, MESICC* cc, CacheArray* array, ReplPolicy* rp, uint32_t accLat, uint32_t invLat,
+        uint32_t mshrs, uint32_t tagLat, uint32_t ways, uint32_t cands, uint32_t domain, bool bypass, const g_string& name) {
+    A* a = dynamic_cast<A*>(array);
+    return a? new StaticTimingCache<A, MESICC>(numLines, cc, a, rp, accLat, invLat, mshrs, tagLat, ways, cands, domain, bypass, name) : nullptr;
+}
+
 BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name, uint32_t bankSize, bool isTerminal, uint32_t domain) {
     string type = config.get<const char*>(prefix + "type", "Simple");
     // Shortcut for TraceDriven type
@@ -235,9 +264,19 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
 
 
     //Alright, build the array
+    // The common SetAssoc configs get arrays with the repl policy and hash inlined (no virtual calls); set
+    // devirtualize = false to use the generic array (e.g., to compare against it)
+    bool devirtualize = config.get<bool>(prefix + "devirtualize", true) && arrayType == "SetAssoc" &&
+        (replType == "LRU" || replType == "LRUNoSh") && (hashType == "None" || hashType == "H3");
     CacheArray* array = nullptr;
     if (arrayType == "SetAssoc") {
-        array = new SetAssocArray(numLines, ways, rp, hf);
+        if (!devirtualize) {
+            array = new SetAssocArray(numLines, ways, rp, hf);
+        } else if (LRUReplPolicy<true>* lrp = dynamic_cast<LRUReplPolicy<true>*>(rp)) {
+            array = BuildStaticSetAssocArray(numLines, ways, lrp, hf);
+        } else {
+            array = BuildStaticSetAssocArray(numLines, ways, dynamic_cast<LRUReplPolicy<false>*>(rp), hf);
+        }
     } else if (arrayType == "Z") {
         array = new ZArray(numLines, ways, candidates, rp, hf);
     } else if (arrayType == "IdealLRU") {
@@ -279,16 +318,49 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
         cc = new MESITerminalCC(numLines, bypass, name);
     } else {
         cc = new MESICC(numLines, nonInclusiveHack, bypass, name);
+        // Sampled inter-thread sharing profile of 1 in N lines (0 = off), see sharing_profiler.h
+        uint32_t profileSharing = config.get<uint32_t>(prefix + "profileSharing", 0);
+        if (profileSharing) static_cast<MESICC*>(cc)->setSharingProfile(profileSharing);
+        // Split the bank's locks in stripes of sets (1 = a single lock), so that accesses from many children to
+        // a shared cache don't all serialize; see CCLocks
+        uint32_t lockStripes = config.get<uint32_t>(prefix + "lockStripes", 1);
+        if (lockStripes > 1) {
+            if ((type != "Simple" && type != "Timing") || arrayType != "SetAssoc" || (replType != "LRU" && replType != "LRUNoSh")) {
+                panic("%s: Striped locks need a Simple or Timing cache with a SetAssoc array and LRU replacement", name.c_str());
+            }
+            if (lockStripes > numSets) panic("%s: More lock stripes (%d) than sets (%d)", name.c_str(), lockStripes, numSets);
+            static_cast<MESICC*>(cc)->setLockStripes(lockStripes, static_cast<SetAssocArray*>(array));
+        }
     }
     rp->setCC(cc);
     if (!isTerminal) {
         if (type == "Simple") {
-            cache = new Cache(numLines, cc, array, rp, accLat, invLat, bypass, name);
+            cache = nullptr;
+            if (devirtualize) {
+                MESICC* mcc = static_cast<MESICC*>(cc);
+                if (!cache) cache = BuildStaticCache< StaticSetAssocArray<LRUReplPolicy<true>, IdHashFamily> >(numLines, mcc, array, rp, accLat, invLat, bypass, name);
+                if (!cache) cache = BuildStaticCache< StaticSetAssocArray<LRUReplPolicy<true>, H3HashFamily> >(numLines, mcc, array, rp, accLat, invLat, bypass, name);
+                if (!cache) cache = BuildStaticCache< StaticSetAssocArray<LRUReplPolicy<false>, IdHashFamily> >(numLines, mcc, array, rp, accLat, invLat, bypass, name);
+                if (!cache) cache = BuildStaticCache< StaticSetAssocArray<LRUReplPolicy<false>, H3HashFamily> >(numLines, mcc, array, rp, accLat, invLat, bypass, name);
+                assert(cache);
+            } else {
+                cache = new Cache(numLines, cc, array, rp, accLat, invLat, bypass, name);
+            }
         } else if (type == "Timing") {
             uint32_t mshrs = config.get<uint32_t>(prefix + "mshrs", 16);
             uint32_t tagLat = config.get<uint32_t>(prefix + "tagLat", 5);
             uint32_t timingCandidates = config.get<uint32_t>(prefix + "timingCandidates", candidates);
-            cache = new TimingCache(numLines, cc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name);
+            cache = nullptr;
+            if (devirtualize) {
+                MESICC* mcc = static_cast<MESICC*>(cc);
+                if (!cache) cache = BuildStaticTimingCache< StaticSetAssocArray<LRUReplPolicy<true>, IdHashFamily> >(numLines, mcc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name);
+                if (!cache) cache = BuildStaticTimingCache< StaticSetAssocArray<LRUReplPolicy<true>, H3HashFamily> >(numLines, mcc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name);
+                if (!cache) cache = BuildStaticTimingCache< StaticSetAssocArray<LRUReplPolicy<false>, IdHashFamily> >(numLines, mcc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name);
+                if (!cache) cache = BuildStaticTimingCache< StaticSetAssocArray<LRUReplPolicy<false>, H3HashFamily> >(numLines, mcc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name);
+                assert(cache);
+            } else {
+                cache = new TimingCache(numLines, cc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name);
+            }
         } else if (type == "Tracing") {
             g_string traceFile = config.get<const char*>(prefix + "traceFile","");
             if (traceFile.empty()) traceFile = g_string(zinfo->outputDir) + "/" + name + ".trace";
@@ -313,10 +385,14 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
 
 // NOTE: frequency is SYSTEM frequency; mem freq specified in tech
 DDRMemory* BuildDDRMemory(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string name, const string& prefix) {
-    uint32_t ranksPerChannel = config.get<uint32_t>(prefix + "ranksPerChannel", 4);
-    uint32_t banksPerRank = config.get<uint32_t>(prefix + "banksPerRank", 8);  // DDR3 std is 8
-    uint32_t pageSize = config.get<uint32_t>(prefix + "pageSize", 8*1024);  // 1Kb cols, x4 devices
     const char* tech = config.get<const char*>(prefix + "tech", "DDR3-1333-CL10");  // see cpp file for other techs
+    // Stacked techs (HBM*, HMC*) are one pseudo-channel or vault, with a single rank and smaller pages
+    string techName(tech);
+    bool hbm = techName.compare(0, 3, "HBM") == 0;
+    bool stacked = hbm || techName.compare(0, 3, "HMC") == 0;
+    uint32_t ranksPerChannel = config.get<uint32_t>(prefix + "ranksPerChannel", stacked? 1 : 4);
+    uint32_t banksPerRank = config.get<uint32_t>(prefix + "banksPerRank", hbm? 16 : 8);  // DDR3 std is 8
+    uint32_t pageSize = config.get<uint32_t>(prefix + "pageSize", (techName == "HBM2-2000")? 1024 : stacked? 2048 : 8*1024);  // 1Kb cols, x4 devices
     const char* addrMapping = config.get<const char*>(prefix + "addrMapping", "rank:col:bank");  // address splitter interleaves channels; row always on top
 
     // If set, writes are deferred and bursted out to reduce WTR overheads
@@ -336,6 +412,39 @@ DDRMemory* BuildDDRMemory(Config& config, uint32_t lineSize, uint32_t frequency,
     return mem;
 }
 
+// Defaults match ramulator-configs/HMC-config.cfg (HMC_4GB, HMC_2500, 4 full-width 30 Gbps links); see README.hmc
+MemObject* BuildHMCMemory(Config& config, uint32_t lineSize, uint32_t frequency, g_string& name) {
+    HMCModel::Params params;
+    params.vaults = config.get<uint32_t>("sys.mem.vaults", 32);
+    params.banksPerVault = config.get<uint32_t>("sys.mem.banksPerVault", 8);
+    params.blockBytes = config.get<uint32_t>("sys.mem.blockSize", 256);
+    params.rowBytes = config.get<uint32_t>("sys.mem.rowSize", 2048);
+    params.tCK = config.get<double>("sys.mem.tCK", 0.8);
+    params.tCL = config.get<uint32_t>("sys.mem.tCL", 17);
+    params.tRCD = config.get<uint32_t>("sys.mem.tRCD", 17);
+    params.tRP = config.get<uint32_t>("sys.mem.tRP", 17);
+    params.tRAS = config.get<uint32_t>("sys.mem.tRAS", 34);
+    params.tREFI = config.get<uint32_t>("sys.mem.tREFI", 9750);
+    params.tBL = config.get<uint32_t>("sys.mem.tBL", 4);
+    params.tCCDL = config.get<uint32_t>("sys.mem.tCCDL", 6);
+    params.columnBytes = config.get<uint32_t>("sys.mem.columnSize", 32);
+    params.fixedLatency = config.get<uint32_t>("sys.mem.fixedLatency", 14);
+    params.links = config.get<uint32_t>("sys.mem.links", 4);
+    params.linkLanes = config.get<uint32_t>("sys.mem.linkLanes", 16);
+    params.laneGbps = config.get<double>("sys.mem.laneGbps", 30.0);
+    params.flitBytes = config.get<uint32_t>("sys.mem.flitSize", 16);
+    params.payloadFlits = config.get<uint32_t>("sys.mem.payloadFlits", 16);
+    params.lineBytes = lineSize;
+    params.meshWidth = config.get<uint32_t>("sys.mem.meshWidth", 6);
+    // Like Ramulator, PIM requests only pay for mesh hops with sim.networkOverhead
+    bool networkOverhead = config.get<bool>("sim.networkOverhead", false);
+    params.hopCycles = networkOverhead? config.get<uint32_t>("sys.mem.hopCycles", 1) : 0;
+    params.pimFixedLatency = config.get<uint32_t>("sys.mem.pimFixedLatency", 4);
+
+    bool pimMode = config.get<bool>("sim.pimMode", false);
+    return new HMCMemory(params, frequency, pimMode, name);
+}
+
 MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string& name) {
     //Type
     string type = config.get<const char*>("sys.mem.type", "Simple");
@@ -363,7 +472,19 @@ MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t fre
         uint32_t boundLatency = config.get<uint32_t>("sys.mem.boundLatency", 100);
         mem = new WeaveSimpleMemory(latency, boundLatency, domain, name);
     } else if (type == "DDR") {
-        mem = BuildDDRMemory(config, lineSize, frequency, domain, name, "sys.mem.");
+        // A stacked device's pseudo-channels or vaults are split line-interleaved, like controllers
+        uint32_t channels = config.get<uint32_t>("sys.mem.channels", 1);
+        if (channels == 1) {
+            mem = BuildDDRMemory(config, lineSize, frequency, domain, name, "sys.mem.");
+        } else {
+            g_vector<MemObject*> chMems;
+            for (uint32_t c = 0; c < channels; c++) {
+                stringstream ss;
+                ss << name << "-ch" << c;
+                chMems.push_back(BuildDDRMemory(config, lineSize, frequency, domain, g_string(ss.str().c_str()), "sys.mem."));
+            }
+            mem = new SplitAddrMemory(chMems, name.c_str());
+        }
     } else if (type == "DRAMSim") {
         uint64_t cpuFreqHz = 1000000 * frequency;
         uint32_t capacity = config.get<uint32_t>("sys.mem.capacityMB", 16384);
@@ -379,8 +500,21 @@ MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t fre
         bool record_memory_trace = config.get<bool>("sim.recordMemoryTrace", false);
         string application = config.get<const char*>("sim.stats");
         mem = new Ramulator(ramulatorConfig, zinfo->numCores, lineSize, latency, domain, name, pimMode, application, frequency, record_memory_trace,networkOverhead);
+        // Merge a core's misses to adjacent lines into up to coalesceBytes-sized packets
+        uint32_t coalesceWindow = config.get<uint32_t>("sys.mem.coalesceWindow", 0);
+        uint32_t coalesceBytes = config.get<uint32_t>("sys.mem.coalesceBytes", 256);
+        static_cast<Ramulator*>(mem)->setCoalescing(coalesceWindow, coalesceBytes);
+        // Arbitration between cores: policy, per-core bandwidth shares ("4 1 1 1", default 1 each),
+        // latency-critical cores, and a per-core limit on lines in flight in the memory (0 = none)
+        string qosPolicy = config.get<const char*>("sys.mem.qos.policy", "FIFO");
+        vector<uint32_t> qosShares = ParseList<uint32_t>(config.get<const char*>("sys.mem.qos.shares", ""), zinfo->numCores, 1);
+        vector<uint32_t> qosPriorityCores = ParseList<uint32_t>(config.get<const char*>("sys.mem.qos.priorityCores", ""));
+        uint32_t qosMaxOutstanding = config.get<uint32_t>("sys.mem.qos.maxOutstanding", 0);
+        static_cast<Ramulator*>(mem)->setQos(qosPolicy, qosShares, qosPriorityCores, qosMaxOutstanding);
         zinfo ->  ramulator_memory = true;
         zinfo -> ramulator = static_cast<Ramulator*>(mem);
+    } else if (type == "AnalyticHMC") {
+        mem = BuildHMCMemory(config, lineSize, frequency, name);
     } else if (type == "Detailed") {
         // FIXME(dsm): Don't use a separate config file... see DDRMemory
         g_string mcfg = config.get<const char*>("sys.mem.paramFile", "");
@@ -414,7 +548,8 @@ CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal)
     bool isPrefetcher = config.get<bool>(prefix + "isPrefetcher", false);
     if (isPrefetcher) { //build a prefetcher group
         uint32_t prefetchers = config.get<uint32_t>(prefix + "prefetchers", 1);
-        uint32_t entrySize = config.get<uint32_t>(prefix + "entries", 16);
+        string pfType = config.get<const char*>(prefix + "type", "Stream");
+        uint32_t entrySize = config.get<uint32_t>(prefix + "entries", (pfType == "Stream")? 16 : (pfType == "SMS")? 64 : 256);
         assert(entrySize > 0);
 
         cg.resize(prefetchers);
@@ -423,7 +558,33 @@ CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal)
             stringstream ss;
             ss << name << "-" << i;
             g_string pfName(ss.str().c_str());
-            cg[i][0] = new StreamPrefetcher(pfName,bankSize/zinfo->lineSize, entrySize);
+            if (pfType == "Stream") {
+                cg[i][0] = new StreamPrefetcher(pfName,bankSize/zinfo->lineSize, entrySize);
+                continue;
+            }
+
+            // Generic prefetcher; see prefetch_engines.h
+            uint32_t degree = config.get<uint32_t>(prefix + "degree", (pfType == "SMS" || pfType == "IMP")? 16 : 2);
+            uint32_t distance = config.get<uint32_t>(prefix + "distance", (pfType == "IMP")? 4 : 1);
+            PrefetchEngine* engine = nullptr;
+            if (pfType == "Stride") {
+                engine = new StridePrefetchEngine(entrySize, degree, distance);
+            } else if (pfType == "SMS") {
+                uint32_t regionLines = config.get<uint32_t>(prefix + "regionLines", 32);
+                uint32_t phtEntries = config.get<uint32_t>(prefix + "phtEntries", 2048);
+                engine = new SMSPrefetchEngine(regionLines, entrySize, phtEntries, degree);
+            } else if (pfType == "IMP") {
+                engine = new IMPPrefetchEngine(entrySize, degree, distance);
+            } else if (pfType == "BestOffset") {
+                engine = new BestOffsetPrefetchEngine(entrySize, degree);
+            } else {
+                panic("%s: Invalid prefetcher type %s", name.c_str(), pfType.c_str());
+            }
+
+            uint32_t tableEntries = config.get<uint32_t>(prefix + "trackedLines", 256);
+            bool buffer = config.get<bool>(prefix + "buffer", false);
+            uint32_t bufferLatency = config.get<uint32_t>(prefix + "bufferLatency", 5);
+            cg[i][0] = new Prefetcher(pfName, engine, tableEntries, degree, buffer, bufferLatency);
         }
         return cgp;
     }
@@ -671,6 +832,7 @@ static void InitSystem(Config& config) {
                 OOOCore* oooCores;
                 NullCore* nullCores;
                 AcceleratorCore* acceleratorCores;
+                SyntheticCore* syntheticCores;
             };
             if (type == "Simple") {
                 simpleCores = gm_memalign<SimpleCore>(CACHE_LINE_BYTES, cores);
@@ -684,11 +846,54 @@ static void InitSystem(Config& config) {
                 zinfo->oooDecode = true; //enable uop decoding, this is false by default, must be true if even one OOO cpu is in the system
             } else if (type == "Null") {
                 nullCores = gm_memalign<NullCore>(CACHE_LINE_BYTES, cores);
+            } else if (type == "Synthetic") {
+                syntheticCores = gm_memalign<SyntheticCore>(CACHE_LINE_BYTES, cores);
             } else {
                 panic("%s: Invalid core type %s", group, type.c_str());
             }
 
-            if (type != "Null") {
+            if (type == "Synthetic") {
+                // Data accesses only, so no icache
+                string dcache = config.get<const char*>(prefix + "dcache");
+                if (!assignedCaches.count(dcache)) panic("%s: Invalid dcache parameter %s", group, dcache.c_str());
+
+                SyntheticCore::Pattern pattern = SyntheticCore::parsePattern(config.get<const char*>(prefix + "pattern", "Sequential"));
+                uint64_t footprint = config.get<uint64_t>(prefix + "footprint", 64*1024*1024);
+                uint64_t stride = config.get<uint64_t>(prefix + "stride", zinfo->lineSize);
+                double writeRatio = config.get<double>(prefix + "writeRatio", 0.0);
+                uint32_t mlp = config.get<uint32_t>(prefix + "mlp", 1);
+                uint32_t issueCycles = config.get<uint32_t>(prefix + "issueCycles", 1);
+                uint64_t accesses = config.get<uint64_t>(prefix + "accesses", 0);
+                bool shared = config.get<bool>(prefix + "shared", false);
+                uint64_t seed = config.get<uint64_t>(prefix + "seed", 42);
+
+                // Each core (or the whole group, if shared) gets a disjoint region, which fits the Gather index array too
+                uint64_t regionBytes = 2*footprint;
+                uint32_t firstCoreIdx = coreIdx;
+                for (uint32_t j = 0; j < cores; j++) {
+                    stringstream ss;
+                    ss << group << "-" << j;
+                    g_string name(ss.str().c_str());
+
+                    CacheGroup& dgroup = *cMap[dcache];
+                    if (assignedCaches[dcache] >= dgroup.size()) {
+                        panic("%s: dcache group %s (%ld caches) is fully used, can't connect more cores to it", name.c_str(), dcache.c_str(), dgroup.size());
+                    }
+                    FilterCache* dc = dynamic_cast<FilterCache*>(dgroup[assignedCaches[dcache]][0]);
+                    assert(dc);
+                    dc->setSourceId(coreIdx);
+                    assignedCaches[dcache]++;
+
+                    uint32_t domain = j*zinfo->numDomains/cores;
+                    Address base = (shared? firstCoreIdx : coreIdx)*regionBytes;
+                    SyntheticCore* score = new (&syntheticCores[j]) SyntheticCore(dc, domain, pattern, base, footprint, stride,
+                            writeRatio, mlp, issueCycles, accesses, seed + j, name);
+                    zinfo->eventRecorders[coreIdx] = score->getEventRecorder();
+                    zinfo->eventRecorders[coreIdx]->setSourceId(coreIdx);
+                    coreMap[group].push_back(score);
+                    coreIdx++;
+                }
+            } else if (type != "Null") {
                 string icache = config.get<const char*>(prefix + "icache");
                 string dcache = config.get<const char*>(prefix + "dcache");
 
@@ -844,8 +1049,50 @@ static void PostInitStats(bool perProcessDir, Config& config) {
     const char* cmpStatsFile = gm_strdup((pathStr + application + ".zsim-cmp.h5").c_str());
     const char* statsFile = gm_strdup((pathStr + application + ".zsim.out").c_str());
 
-    if (zinfo->statsPhaseInterval) {
-        zinfo->periodicStatsBackend = nullptr;
+    // Periodic stats are opt-in (sim.periodicStats): dumping the full hierarchy every statsPhaseInterval
+    // phases is expensive. Restrict them with sim.periodicStatsFilter, e.g. "mem-.*" for the
+    // per-phase memory bandwidth/MLP profile of Ramulator controllers
+    zinfo->periodicStatsBackend = nullptr;
+    if (zinfo->statsPhaseInterval && config.get<bool>("sim.periodicStats", false)) {
+        const char* periodicStatsFilter = config.get<const char*>("sim.periodicStatsFilter", "");
+        AggregateStat* prStat = (!strlen(periodicStatsFilter))? zinfo->rootStat : FilterStats(zinfo->rootStat, periodicStatsFilter);
+        if (!prStat) panic("No stats match sim.periodicStatsFilter regex (%s)! Disable sim.periodicStats to avoid periodic stats", periodicStatsFilter);
+        zinfo->periodicStatsBackend = new HDF5Backend(pStatsFile, prStat, (1 << 20) /* 1MB chunks */, zinfo->skipStatsVectors, zinfo->compactPeriodicStats);
+        zinfo->periodicStatsBackend->dump(true); //must have a first sample
+
+        class PeriodicStatsDumpEvent : public Event {
+            public:
+                explicit PeriodicStatsDumpEvent(uint32_t period) : Event(period) {}
+                void callback() {
+                    zinfo->trigger = 10000;
+                    zinfo->periodicStatsBackend->dump(true /*buffered*/);
+                }
+        };
+
+        // With adaptive phases, dump every statsPhaseInterval phases of sim.phaseLength cycles, on the phase
+        // that ends there (PhaseController clips phases so one does)
+        class CyclePeriodicStatsDumpEvent : public Event {
+            private:
+                uint64_t interval, nextDump;
+            public:
+                explicit CyclePeriodicStatsDumpEvent(uint64_t _interval) : Event(1), interval(_interval), nextDump(_interval) {}
+                void callback() {
+                    if (zinfo->globPhaseCycles + zinfo->phaseLength >= nextDump) {
+                        zinfo->trigger = 10000;
+                        zinfo->periodicStatsBackend->dump(true /*buffered*/);
+                        nextDump += interval;
+                    }
+                }
+        };
+
+        if (zinfo->phaseController) {
+            uint64_t interval = ((uint64_t)zinfo->statsPhaseInterval)*zinfo->phaseLength;
+            zinfo->phaseController->alignTo(interval);
+            zinfo->eventQueue->insert(new CyclePeriodicStatsDumpEvent(interval));
+        } else {
+            zinfo->eventQueue->insert(new PeriodicStatsDumpEvent(zinfo->statsPhaseInterval));
+        }
+        zinfo->statsBackends->push_back(zinfo->periodicStatsBackend);
     }
 
     // xuani: to dump the stats to a hdf file (convinient for post processing)
@@ -862,7 +1109,7 @@ static void PostInitStats(bool perProcessDir, Config& config) {
                 zinfo->trigger = i;
                 zinfo->eventualStatsBackend->dump(true /*buffered*/);
             };
-            zinfo->eventQueue->insert(makeAdaptiveEvent(getInstrs, dumpStats, 0, zinfo->maxMinInstrs, MAX_IPC*zinfo->phaseLength));
+            zinfo->eventQueue->insert(makeAdaptiveEvent(getInstrs, dumpStats, 0, zinfo->maxMinInstrs, MAX_IPC*zinfo->maxPhaseLength));
         }
     }
 
@@ -915,21 +1162,26 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
         // Get the number of cores
         // TODO: There is some duplication with the core creation code. This should be fixed eventually.
         uint32_t numCores = 0;
+        uint32_t syntheticCores = 0;
         vector<const char*> groups;
         config.subgroups("sys.cores", groups);
         for (const char* group : groups) {
             uint32_t cores = config.get<uint32_t>(string("sys.cores.") + group + ".cores", 1);
             numCores += cores;
+            if (string(config.get<const char*>(string("sys.cores.") + group + ".type", "Simple")) == "Synthetic") syntheticCores += cores;
         }
 
         if (numCores == 0) panic("Config must define some core classes in sys.cores; sys.numCores is deprecated");
+        if (syntheticCores && syntheticCores != numCores) panic("Synthetic cores can't be mixed with other core types");
         zinfo->numCores = numCores;
+        zinfo->syntheticDriven = (syntheticCores > 0);
         assert(numCores <= MAX_THREADS); //TODO: Is there any reason for this limit?
     }
 
     zinfo->numDomains = config.get<uint32_t>("sim.domains", 1);
     uint32_t numSimThreads = config.get<uint32_t>("sim.contentionThreads", MAX((uint32_t)1, zinfo->numDomains/2)); //gives a bit of parallelism, TODO tune
-    zinfo->contentionSim = new ContentionSim(zinfo->numDomains, numSimThreads);
+    bool contentionStealing = config.get<bool>("sim.contentionStealing", true); //threads steal domains from each other in the weave phase
+    zinfo->contentionSim = new ContentionSim(zinfo->numDomains, numSimThreads, contentionStealing);
     zinfo->contentionSim->initStats(zinfo->rootStat);
     zinfo->eventRecorders = gm_calloc<EventRecorder*>(zinfo->numCores);
 
@@ -939,9 +1191,26 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo->numPhases = 0;
 
     zinfo->phaseLength = config.get<uint32_t>("sim.phaseLength", 10000);
+    zinfo->nextPhaseLength = zinfo->phaseLength;
+    zinfo->maxPhaseLength = zinfo->phaseLength;
+    zinfo->phaseController = nullptr;
+    if (config.get<bool>("sim.adaptivePhases", false)) {
+        uint32_t minPhaseLength = config.get<uint32_t>("sim.minPhaseLength", zinfo->phaseLength/4);
+        zinfo->maxPhaseLength = config.get<uint32_t>("sim.maxPhaseLength", 4*zinfo->phaseLength);
+        // Thresholds on weave activity, see phase_controller.h
+        double highCrossings = config.get<double>("sim.phaseHighCrossings", 8.0); //per 1000 cycles
+        double highQueued = config.get<double>("sim.phaseHighQueued", 16.0); //per 1000 cycles
+        double maxStallRatio = config.get<double>("sim.phaseMaxStallRatio", 0.5); //per crossing
+        zinfo->phaseController = new PhaseController(minPhaseLength, zinfo->maxPhaseLength, highCrossings, highQueued, maxStallRatio);
+        zinfo->phaseController->initStats(zinfo->rootStat);
+    }
     zinfo->statsPhaseInterval = config.get<uint32_t>("sim.statsPhaseInterval", 100);
     zinfo->freqMHz = config.get<uint32_t>("sys.frequency", 2000);
 
+    uint32_t selfProfRate = config.get<uint32_t>("sim.selfProfile", 0); //time 1 in this many entries of hot components, 0 disables
+    zinfo->selfProf = selfProfRate? new SelfProfiler(selfProfRate, zinfo->numCores) : nullptr;
+    if (zinfo->selfProf) zinfo->selfProf->initStats(zinfo->rootStat);
+
     //Maxima/termination conditions
     zinfo->maxPhases = config.get<uint64_t>("sim.maxPhases", 0);
     zinfo->maxMinInstrs = config.get<uint64_t>("sim.maxMinInstrs", 0);
@@ -964,6 +1233,15 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     //Fast-forwarding and magic ops
     zinfo->ignoreHooks = config.get<bool>("sim.ignoreHooks", false);
     zinfo->ffReinstrument = config.get<bool>("sim.ffReinstrument", false);
+    zinfo->bufferedMemInstr = config.get<bool>("sim.bufferedMemInstr", false);
+    string traceCapture = config.get<const char*>("sim.traceCapture", "");
+    string traceReplay = config.get<const char*>("sim.traceReplay", "");
+    zinfo->traceCapture = traceCapture.empty()? nullptr : gm_strdup(traceCapture.c_str());
+    zinfo->traceReplay = traceReplay.empty()? nullptr : gm_strdup(traceReplay.c_str());
+    if (zinfo->traceCapture && zinfo->bufferedMemInstr) {
+        warn("sim.traceCapture records every access, ignoring sim.bufferedMemInstr");
+        zinfo->bufferedMemInstr = false;
+    }
     if (zinfo->ffReinstrument) warn("sim.ffReinstrument = true, switching fast-forwarding on a multi-threaded process may be unstable");
 
     zinfo->registerThreads = config.get<bool>("sim.registerThreads", false);
@@ -100,6 +100,10 @@ struct MemReq {
     };
     uint32_t flags;
 
+    //Static id of the instruction that caused the access, 0 if unknown. Set by the cores that provide it and
+    //propagated to upper levels by MESIBottomCC (but not to evictions), for PC-indexed prefetchers
+    Address pc;
+
     inline void set(Flag f) {flags |= f;}
     inline bool is (Flag f) const {return flags & f;}
 };
@@ -73,6 +73,7 @@ OOOCore::OOOCore(FilterCache* _l1i, FilterCache* _l1d, g_string& _name) : Core(_
         regScoreboard[i] = 0;
     }
     prevBbl = nullptr;
+    prevBblAddr = 0;
 
     lastStoreCommitCycle = 0;
     lastStoreAddrCommitCycle = 0;
@@ -164,7 +165,7 @@ void OOOCore::initStats(AggregateStat* parentStat) {
 
 uint64_t OOOCore::getOffloadInstrs() const {return offload_instrs;}
 uint64_t OOOCore::getInstrs() const {return instrs;}
-uint64_t OOOCore::getPhaseCycles() const {return curCycle % zinfo->phaseLength;}
+uint64_t OOOCore::getPhaseCycles() const {return curCycle - zinfo->globPhaseCycles;}
 
 void OOOCore::contextSwitch(int32_t gid) {
     if (gid == -1) {
@@ -179,7 +180,7 @@ void OOOCore::contextSwitch(int32_t gid) {
 
 
 InstrFuncPtrs OOOCore::GetFuncPtrs() {
-    return {LoadFunc, StoreFunc, BblFunc, BranchFunc, PredLoadFunc, PredStoreFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, {0} };
+    return {LoadFunc, StoreFunc, BblFunc, BranchFunc, PredLoadFunc, PredStoreFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, nullptr};
 }
 
 void OOOCore::OffloadBegin(THREADID tid) {
@@ -221,6 +222,7 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
     if (!prevBbl) {
         // This is the 1st BBL since scheduled, nothing to simulate
         prevBbl = bblInfo;
+        prevBblAddr = bblAddr;
         // Kill lingering ops from previous BBL
         loads = stores = 0;
         return;
@@ -230,6 +232,9 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
     uint32_t bblInstrs = prevBbl->instrs;
     DynBbl* bbl = &(prevBbl->oooBbl[0]);
     prevBbl = bblInfo;
+    // We don't instrument per-instruction PCs; (BBL address, load/store, index) identifies the static access
+    Address simBblAddr = prevBblAddr;
+    prevBblAddr = bblAddr;
 
     uint32_t loadIdx = 0;
     uint32_t storeIdx = 0;
@@ -358,7 +363,7 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
 
                     uint64_t reqSatisfiedCycle = dispatchCycle;
                     if (addr != ((Address)-1L)) {
-                        reqSatisfiedCycle = l1d->load(addr, dispatchCycle) + L1D_LAT;
+                        reqSatisfiedCycle = l1d->load(addr, dispatchCycle, (simBblAddr << 9) | (loadIdx - 1)) + L1D_LAT;
                         cRec.record(curCycle, dispatchCycle, reqSatisfiedCycle);
                         if(zinfo->numCores == 1){
                             locality_monitor.push_address(addr,size);
@@ -406,7 +411,7 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
                         locality_monitor.push_address(addr, size);
                     }
 
-                    uint64_t reqSatisfiedCycle = l1d->store(addr, dispatchCycle) + L1D_LAT;
+                    uint64_t reqSatisfiedCycle = l1d->store(addr, dispatchCycle, (simBblAddr << 9) | 256 | (storeIdx - 1)) + L1D_LAT;
                     cRec.record(curCycle, dispatchCycle, reqSatisfiedCycle);
 
                     // Fill the forwarding table
@@ -634,7 +639,7 @@ void OOOCore::BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
     core->bbl(bblAddr, bblInfo);
 
     while (core->curCycle > core->phaseEndCycle) {
-        core->phaseEndCycle += zinfo->phaseLength;
+        core->phaseEndCycle += zinfo->nextPhaseLength;
 
         uint32_t cid = getCid(tid);
         // NOTE: TakeBarrier may take ownership of the core, and so it will be used by some other thread. If TakeBarrier context-switches us,
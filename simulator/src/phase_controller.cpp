@@ -0,0 +1,89 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "phase_controller.h"
+#include "contention_sim.h"
+#include "log.h"
+#include "zsim.h"
+
+PhaseController::PhaseController(uint32_t _minLength, uint32_t _maxLength, double _highCrossings, double _highQueued, double _maxStallRatio)
+    : minLength(_minLength), maxLength(_maxLength), highCrossings(_highCrossings), highQueued(_highQueued),
+      maxStallRatio(_maxStallRatio), target(zinfo->phaseLength), statsInterval(0), lastCrossings(0), lastStalls(0)
+{
+    if (!minLength || minLength > zinfo->phaseLength || maxLength < zinfo->phaseLength) {
+        panic("Adaptive phases need 0 < minPhaseLength (%d) <= phaseLength (%d) <= maxPhaseLength (%d)", minLength, zinfo->phaseLength, maxLength);
+    }
+    info("Adaptive phases: %d-%d cycles", minLength, maxLength);
+}
+
+void PhaseController::initStats(AggregateStat* parentStat) {
+    AggregateStat* pcStats = new AggregateStat();
+    pcStats->init("phases", "Adaptive phase length stats");
+    profGrows.init("grows", "Phase length increases"); pcStats->append(&profGrows);
+    profShrinks.init("shrinks", "Phase length decreases"); pcStats->append(&profShrinks);
+    profClips.init("clips", "Phases cut short to end on a periodic stats boundary"); pcStats->append(&profClips);
+    auto lenStat = makeLambdaStat([]() { return zinfo->phaseLength; });
+    lenStat->init("length", "Current phase length");
+    pcStats->append(lenStat);
+    parentStat->append(pcStats);
+}
+
+void PhaseController::endPhase() {
+    // Weave-phase activity in the phase that just ended
+    ContentionSim* cs = zinfo->contentionSim;
+    uint64_t crossings = cs->getCrossings();
+    uint64_t stalls = cs->getStalls();
+    double kcycles = zinfo->phaseLength/1000.0;
+    double crossingRate = (crossings - lastCrossings)/kcycles;
+    double queuedRate = cs->getQueuedEvents()/kcycles;
+    double stallRatio = (crossings > lastCrossings)? ((double)(stalls - lastStalls))/(crossings - lastCrossings) : 0.0;
+    lastCrossings = crossings;
+    lastStalls = stalls;
+
+    zinfo->phaseLength = zinfo->nextPhaseLength;
+
+    if (crossingRate > highCrossings || queuedRate > highQueued || stallRatio > maxStallRatio) {
+        if (target > minLength) {
+            target = MAX(minLength, target/2);
+            profShrinks.inc();
+        }
+    } else if (crossingRate < highCrossings/4 && queuedRate < highQueued/4 && stallRatio < maxStallRatio/4) {
+        if (target < maxLength) {
+            target = MIN(maxLength, 2*target);
+            profGrows.inc();
+        }
+    }
+
+    uint32_t next = target;
+    if (statsInterval) {
+        uint64_t nextStart = zinfo->globPhaseCycles + zinfo->phaseLength;
+        uint64_t boundary = (nextStart/statsInterval + 1)*statsInterval;
+        if (nextStart + next > boundary) {
+            next = boundary - nextStart;
+            profClips.inc();
+        }
+    }
+    zinfo->nextPhaseLength = next;
+}
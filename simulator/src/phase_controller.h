@@ -0,0 +1,70 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PHASE_CONTROLLER_H_
+#define PHASE_CONTROLLER_H_
+
+#include "galloc.h"
+#include "stats.h"
+
+/* Adaptive phase length (sim.adaptivePhases).
+ *
+ * Short phases keep the bound phase from running far ahead of the contention
+ * the weave phase finds, but every phase costs a barrier. At the end of each
+ * phase, this looks at how much the weave phase had to do per cycle: crossings
+ * between domains, events left queued for later phases, and stalls per crossing
+ * (i.e., how skewed domains were). If any of them is above its threshold, the
+ * phase length halves, down to sim.minPhaseLength; if all of them are below a
+ * quarter of it, the length doubles, up to sim.maxPhaseLength.
+ *
+ * Cores set their phase end at the barrier, before the end of phase actions
+ * run, so lengths are decided one phase ahead (zinfo->nextPhaseLength).
+ * Phases are clipped so that periodic stats are dumped on cycle boundaries,
+ * every statsPhaseInterval phases of sim.phaseLength cycles.
+ */
+class PhaseController : public GlobAlloc {
+    private:
+        const uint32_t minLength, maxLength;
+        const double highCrossings, highQueued;  // per kcycle
+        const double maxStallRatio;  // per crossing
+        uint32_t target;  // next phase length before clipping
+        uint64_t statsInterval;  // cycles, 0 if not aligning
+        uint64_t lastCrossings, lastStalls;
+
+        Counter profGrows, profShrinks, profClips;
+
+    public:
+        PhaseController(uint32_t _minLength, uint32_t _maxLength, double _highCrossings, double _highQueued, double _maxStallRatio);
+
+        void initStats(AggregateStat* parentStat);
+
+        // End phases on multiples of this many cycles
+        void alignTo(uint64_t cycles) {statsInterval = cycles;}
+
+        // Called after zinfo->globPhaseCycles has moved to the start of the next phase
+        void endPhase();
+};
+
+#endif  // PHASE_CONTROLLER_H_
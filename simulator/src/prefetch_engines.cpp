@@ -0,0 +1,346 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prefetch_engines.h"
+#include <algorithm>
+#include "bithacks.h"
+#include "pin.H"
+#include "zsim.h"
+
+// Table index of a PC or address (multiplicative hash; PCs from the cores are BBL address << 9 | index)
+static inline uint32_t tableIdx(uint64_t key, uint32_t entries) {
+    return ((key*0x9E3779B97F4A7C15ul) >> 32) % entries;
+}
+
+// Stride and IMP tables key accesses without a PC by their 4KB region (tagged so that they can't alias PCs)
+static inline Address streamKey(const MemReq& req) {
+    return req.pc? req.pc : ~(req.lineAddr >> (12 - lineBits));
+}
+
+/* Stride */
+
+StridePrefetchEngine::StridePrefetchEngine(uint32_t _entries, uint32_t _degree, uint32_t _distance)
+    : entries(_entries), degree(_degree), distance(_distance)
+{
+    assert(entries && degree && distance);
+    table = gm_calloc<Entry>(entries);
+}
+
+void StridePrefetchEngine::initStats(AggregateStat* parentStat) {
+    profTrainHits.init("trainHits", "Accesses that hit a stride table entry");
+    parentStat->append(&profTrainHits);
+    profStrideChanges.init("strideChanges", "Predicted stride changes");
+    parentStat->append(&profStrideChanges);
+}
+
+void StridePrefetchEngine::train(const MemReq& req, bool pfHit, g_vector<Address>& cands) {
+    Address key = streamKey(req);
+    Entry& e = table[tableIdx(key, entries)];
+    if (e.tag != key) {
+        e.tag = key;
+        e.lastLine = req.lineAddr;
+        e.stride = 0;
+        e.conf.reset();
+        return;
+    }
+    profTrainHits.inc();
+
+    int64_t stride = req.lineAddr - e.lastLine;
+    if (stride == 0) return;  // another access to the same line
+    if (stride == e.stride) {
+        e.conf.inc();
+    } else {
+        e.conf.dec();
+        if (!e.conf.pred()) {
+            e.stride = stride;
+            profStrideChanges.inc();
+        }
+    }
+    e.lastLine = req.lineAddr;
+
+    if (e.conf.pred()) {
+        for (uint32_t i = 0; i < degree; i++) cands.push_back(req.lineAddr + e.stride*(distance + i));
+    }
+}
+
+/* SMS/Bingo */
+
+SMSPrefetchEngine::SMSPrefetchEngine(uint32_t regionLines, uint32_t _agtEntries, uint32_t _phtEntries, uint32_t _degree)
+    : regionBits(ilog2(regionLines)), agtEntries(_agtEntries), phtEntries(_phtEntries), degree(_degree), timestamp(1)
+{
+    if (!isPow2(regionLines) || regionLines > 64) panic("SMS region must be a power of 2 of at most 64 lines, %d specified", regionLines);
+    if (!isPow2(phtEntries)) panic("SMS pattern history table entries must be a power of 2, %d specified", phtEntries);
+    assert(agtEntries && degree);
+    agt = gm_calloc<Generation>(agtEntries);
+    pht = gm_calloc<Pattern>(phtEntries);
+}
+
+void SMSPrefetchEngine::initStats(AggregateStat* parentStat) {
+    profTriggers.init("triggers", "Trigger accesses (first access to an inactive region)");
+    parentStat->append(&profTriggers);
+    profLongMatches.init("longMatches", "Triggers predicted by their (PC, line) event");
+    parentStat->append(&profLongMatches);
+    profShortMatches.init("shortMatches", "Triggers predicted by their (PC, offset) event");
+    parentStat->append(&profShortMatches);
+}
+
+void SMSPrefetchEngine::commit(const Generation& g) {
+    if (!(g.footprint & (g.footprint - 1))) return;  // a single line has nothing to prefetch
+    pht[g.longKey & (phtEntries - 1)] = {g.longKey, g.footprint};
+    pht[g.shortKey & (phtEntries - 1)] = {g.shortKey, g.footprint};
+}
+
+uint64_t SMSPrefetchEngine::lookup(uint64_t key) const {
+    const Pattern& p = pht[key & (phtEntries - 1)];
+    return (p.key == key)? p.footprint : 0;
+}
+
+void SMSPrefetchEngine::train(const MemReq& req, bool pfHit, g_vector<Address>& cands) {
+    Address region = req.lineAddr >> regionBits;
+    uint32_t offset = req.lineAddr & ((1 << regionBits) - 1);
+
+    uint32_t victim = 0;
+    for (uint32_t i = 0; i < agtEntries; i++) {
+        Generation& g = agt[i];
+        if (g.footprint && g.region == region) {
+            g.footprint |= 1ul << offset;
+            g.ts = timestamp++;
+            return;
+        }
+        if (g.ts < agt[victim].ts) victim = i;  // empty entries have ts 0
+    }
+
+    // Trigger access: predict from the long event, then the short one
+    profTriggers.inc();
+    uint64_t longKey = (req.pc ^ (req.lineAddr << 16))*0x9E3779B97F4A7C15ul;
+    uint64_t shortKey = ((req.pc << 6) ^ offset)*0xC2B2AE3D27D4EB4Ful;
+    uint64_t footprint = lookup(longKey);
+    if (footprint) {
+        profLongMatches.inc();
+    } else {
+        footprint = lookup(shortKey);
+        if (footprint) profShortMatches.inc();
+    }
+
+    // Closest lines to the trigger first
+    uint32_t regionLines = 1 << regionBits;
+    uint32_t issued = 0;
+    for (uint32_t d = 1; d < regionLines && issued < degree; d++) {
+        uint32_t off = (offset + d) & (regionLines - 1);
+        if (footprint & (1ul << off)) {
+            cands.push_back((region << regionBits) | off);
+            issued++;
+        }
+    }
+
+    if (agt[victim].footprint) commit(agt[victim]);
+    agt[victim] = {region, longKey, shortKey, 1ul << offset, timestamp++};
+}
+
+/* IMP */
+
+IMPPrefetchEngine::IMPPrefetchEngine(uint32_t _entries, uint32_t _degree, uint32_t _distance)
+    : entries(_entries), degree(_degree), distance(_distance), lastStream(-1)
+{
+    assert(entries && degree && distance);
+    table = gm_calloc<Stream>(entries);
+}
+
+void IMPPrefetchEngine::initStats(AggregateStat* parentStat) {
+    profIndexReads.init("indexReads", "Index lines read from simulated memory");
+    parentStat->append(&profIndexReads);
+    profPatterns.init("patterns", "Indirect patterns confirmed");
+    parentStat->append(&profPatterns);
+    profIndirect.init("indirect", "Index line accesses that issued indirect prefetches");
+    parentStat->append(&profIndirect);
+}
+
+bool IMPPrefetchEngine::readIndices(Address lineAddr, int32_t* values, uint32_t n) {
+    // Lines are procMask | vLineAddr (see FilterCache); only our own process's memory is mapped here
+    if (zinfo->traceDriven || (lineAddr >> (64 - lineBits)) != procIdx) return false;
+    assert(n*sizeof(int32_t) <= zinfo->lineSize);
+    size_t bytes = n*sizeof(int32_t);
+    profIndexReads.inc();
+    return PIN_SafeCopy(values, (void*)(lineAddr << lineBits), bytes) == bytes;
+}
+
+void IMPPrefetchEngine::learn(Stream& s, Address lineAddr) {
+    // The first miss after an index line is likely the target of its first index; later ones, of the next few.
+    // A miss to line M with index v means base is in [M*lineSize - (v << shift), +lineSize), so each match
+    // narrows the candidate down (we keep the largest lower bound)
+    if (!s.numValues) return;
+    Address missAddr = lineAddr << lineBits;
+    for (uint32_t i = 0; i < MAX_SHIFTS; i++) {
+        uint32_t shift = 2 + i;
+        bool match = false;
+        for (uint32_t v = 0; v < s.numValues && !match; v++) {
+            Address lb = missAddr - ((int64_t)s.values[v] << shift);
+            match = (lb + zinfo->lineSize > s.cand[i]) && (lb < s.cand[i] + zinfo->lineSize);
+            if (match) s.cand[i] = MAX(s.cand[i], lb);
+        }
+
+        if (match) {
+            s.candConf[i].inc();
+            if (s.candConf[i].pred()) {
+                if (!s.indirect || s.shift != shift) profPatterns.inc();
+                s.indirect = true;
+                s.shift = shift;
+                s.base = s.cand[i];
+            }
+        } else {
+            s.candConf[i].dec();
+            if (!s.candConf[i].pred()) s.cand[i] = missAddr - ((int64_t)s.values[0] << shift);
+        }
+    }
+    s.numValues = 0;  // learn once per index line
+}
+
+void IMPPrefetchEngine::train(const MemReq& req, bool pfHit, g_vector<Address>& cands) {
+    Address key = streamKey(req);
+    uint32_t idx = tableIdx(key, entries);
+    Stream& s = table[idx];
+
+    // Accesses other than the index stream's own may be targets of its indices
+    if (lastStream >= 0 && table[lastStream].tag != key) learn(table[lastStream], req.lineAddr);
+
+    if (s.tag != key) {
+        if (lastStream == (int32_t)idx) lastStream = -1;
+        s = Stream();
+        s.tag = key;
+        s.lastLine = req.lineAddr;
+        return;
+    }
+
+    int64_t stride = req.lineAddr - s.lastLine;
+    if (stride == 0) return;
+    if (stride == s.stride) {
+        s.conf.inc();
+    } else {
+        s.conf.dec();
+        if (!s.conf.pred()) s.stride = stride;
+    }
+    s.lastLine = req.lineAddr;
+    if (!s.conf.pred()) return;
+
+    // Streaming: this may be an index array. Keep its first values to learn from the misses that follow
+    lastStream = idx;
+    s.numValues = readIndices(req.lineAddr, s.values, LEARN_VALUES)? LEARN_VALUES : 0;
+
+    Address ahead = req.lineAddr + s.stride*distance;
+    cands.push_back(ahead);
+    if (s.indirect) {
+        int32_t values[16];
+        uint32_t n = MIN(16u, zinfo->lineSize/(uint32_t)sizeof(int32_t));
+        if (readIndices(ahead, values, n)) {
+            profIndirect.inc();
+            for (uint32_t i = 0; i < n && i + 1 < degree; i++) {
+                cands.push_back((s.base + ((int64_t)values[i] << s.shift)) >> lineBits);
+            }
+        }
+    }
+}
+
+/* Best-offset */
+
+BestOffsetPrefetchEngine::BestOffsetPrefetchEngine(uint32_t _rrEntries, uint32_t _degree)
+    : rrEntries(_rrEntries), degree(_degree), pendingHead(0), numPending(0), testIdx(0), round(0), bestOffset(1), enabled(true)
+{
+    if (!isPow2(rrEntries)) panic("Best-offset RR table entries must be a power of 2, %d specified", rrEntries);
+    assert(degree);
+    // Offsets with no prime factors above 5, as in the original proposal (positive ones only)
+    for (int32_t d = 1; d <= 64; d++) {
+        int32_t r = d;
+        for (int32_t f : {2, 3, 5}) while (r % f == 0) r /= f;
+        if (r == 1) offsets.push_back(d);
+    }
+    scores.resize(offsets.size(), 0);
+    rrTable = gm_calloc<Address>(rrEntries);
+}
+
+void BestOffsetPrefetchEngine::initStats(AggregateStat* parentStat) {
+    profPhases.init("phases", "Learning phases");
+    parentStat->append(&profPhases);
+    profDisabledPhases.init("offPhases", "Learning phases that turned prefetching off");
+    parentStat->append(&profDisabledPhases);
+    profOffset.init("offset", "Current best offset, in lines");
+    profOffset.set(bestOffset);
+    parentStat->append(&profOffset);
+}
+
+void BestOffsetPrefetchEngine::rrInsert(Address lineAddr) {
+    rrTable[(lineAddr ^ (lineAddr >> 8)) & (rrEntries - 1)] = lineAddr;
+}
+
+bool BestOffsetPrefetchEngine::rrHit(Address lineAddr) const {
+    return rrTable[(lineAddr ^ (lineAddr >> 8)) & (rrEntries - 1)] == lineAddr;
+}
+
+void BestOffsetPrefetchEngine::endPhase() {
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < offsets.size(); i++) {
+        if (scores[i] > scores[best]) best = i;
+    }
+    bestOffset = offsets[best];
+    enabled = scores[best] > BAD_SCORE;
+    profPhases.inc();
+    if (!enabled) profDisabledPhases.inc();
+    profOffset.set(bestOffset);
+
+    std::fill(scores.begin(), scores.end(), 0);
+    testIdx = 0;
+    round = 0;
+}
+
+void BestOffsetPrefetchEngine::train(const MemReq& req, bool pfHit, g_vector<Address>& cands) {
+    // Fills that have completed by now
+    while (numPending && pending[pendingHead].respCycle <= req.cycle) {
+        rrInsert(pending[pendingHead].base);
+        pendingHead = (pendingHead + 1) % MAX_PENDING;
+        numPending--;
+    }
+
+    Address x = req.lineAddr;
+    if (rrHit(x - offsets[testIdx]) && ++scores[testIdx] >= SCORE_MAX) {
+        endPhase();
+    } else if (++testIdx == offsets.size()) {
+        testIdx = 0;
+        if (++round == ROUND_MAX) endPhase();
+    }
+
+    if (enabled) {
+        for (uint32_t i = 1; i <= degree; i++) cands.push_back(x + (Address)bestOffset*i);
+    } else {
+        rrInsert(x);
+    }
+}
+
+void BestOffsetPrefetchEngine::issued(Address lineAddr, uint64_t respCycle) {
+    if (numPending == MAX_PENDING) {  // drop the oldest
+        pendingHead = (pendingHead + 1) % MAX_PENDING;
+        numPending--;
+    }
+    pending[(pendingHead + numPending) % MAX_PENDING] = {lineAddr - bestOffset, respCycle};
+    numPending++;
+}
@@ -0,0 +1,212 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREFETCH_ENGINES_H_
+#define PREFETCH_ENGINES_H_
+
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "memory_hierarchy.h"
+#include "prefetcher.h"
+#include "stats.h"
+
+/* Prediction logic for the Prefetcher interposer (see prefetcher.h). An engine sees the demand accesses that
+ * reach the prefetcher (i.e., misses of the level below) and proposes lines to prefetch; the Prefetcher
+ * filters duplicates, issues them and keeps the accuracy/coverage/lateness stats. Engines are called with the
+ * prefetcher's lock held.
+ */
+class PrefetchEngine : public GlobAlloc {
+    public:
+        virtual ~PrefetchEngine() {}
+        virtual void initStats(AggregateStat* parentStat) {}
+
+        // pfHit: the line was prefetched and not yet used. Appends candidate line addresses to cands
+        virtual void train(const MemReq& req, bool pfHit, g_vector<Address>& cands) = 0;
+
+        // A candidate was issued, and will be filled at respCycle
+        virtual void issued(Address lineAddr, uint64_t respCycle) {}
+};
+
+/* PC-indexed stride prefetcher (Chen & Baer's reference prediction table). Accesses without a PC (see
+ * MemReq::pc) are tracked per 4KB region instead, which makes it a per-page stream/stride prefetcher.
+ */
+class StridePrefetchEngine : public PrefetchEngine {
+    private:
+        struct Entry {
+            Address tag;
+            Address lastLine;
+            int64_t stride;
+            SatCounter<3, 2, 0> conf;
+        };
+
+        Entry* table;
+        const uint32_t entries;
+        const uint32_t degree;
+        const uint32_t distance;  // first prefetch is distance strides ahead
+
+        Counter profTrainHits, profStrideChanges;
+
+    public:
+        StridePrefetchEngine(uint32_t _entries, uint32_t _degree, uint32_t _distance);
+        void initStats(AggregateStat* parentStat);
+        void train(const MemReq& req, bool pfHit, g_vector<Address>& cands);
+};
+
+/* Spatial prefetcher in the style of SMS and Bingo. While a region is active, the accumulation table
+ * records which of its lines are touched. When the region is evicted from that table, its footprint is
+ * stored in the pattern history table twice: under the trigger's (PC, line) event and under its
+ * (PC, offset) event. A trigger access (the first one to an inactive region) looks up the long event
+ * first and falls back to the short one, like Bingo, and prefetches the footprint.
+ */
+class SMSPrefetchEngine : public PrefetchEngine {
+    private:
+        struct Generation {
+            Address region;
+            uint64_t longKey, shortKey;
+            uint64_t footprint;
+            uint64_t ts;
+        };
+
+        struct Pattern {
+            uint64_t key;
+            uint64_t footprint;
+        };
+
+        const uint32_t regionBits;  // log2(lines per region), <= 6 (footprints are 64-bit masks)
+        const uint32_t agtEntries;
+        const uint32_t phtEntries;  // power of 2
+        const uint32_t degree;
+
+        Generation* agt;
+        Pattern* pht;
+        uint64_t timestamp;
+
+        Counter profTriggers, profLongMatches, profShortMatches;
+
+        void commit(const Generation& g);
+        uint64_t lookup(uint64_t key) const;
+
+    public:
+        SMSPrefetchEngine(uint32_t regionLines, uint32_t _agtEntries, uint32_t _phtEntries, uint32_t _degree);
+        void initStats(AggregateStat* parentStat);
+        void train(const MemReq& req, bool pfHit, g_vector<Address>& cands);
+};
+
+/* Indirect memory prefetcher (IMP, Yu et al., MICRO 2015), for A[B[i]] accesses. It finds streaming index
+ * arrays (B) with a per-PC stride table, reads the index values from the simulated process's memory, and
+ * learns (shift, base) pairs such that later misses fall on base + (B[i] << shift), from misses that follow
+ * an index line. Once a pair is confirmed, each index line access prefetches the targets of the index
+ * line distance lines ahead (and that index line).
+ *
+ * We only see line addresses, so each miss only bounds the base to a line-sized range; matches narrow it
+ * down. Indices are taken to be 32-bit.
+ * Index values can only be read for lines of the process this thread simulates.
+ */
+class IMPPrefetchEngine : public PrefetchEngine {
+    private:
+        static const uint32_t MAX_SHIFTS = 3;  // target element sizes of 4, 8 and 16 bytes
+        static const uint32_t LEARN_VALUES = 4;  // index values of the last index line used to learn bases
+
+        struct Stream {
+            Address tag;
+            Address lastLine;
+            int64_t stride;
+            SatCounter<3, 2, 0> conf;
+
+            // Learning: index values seen last, and candidate bases per shift
+            int32_t values[LEARN_VALUES];
+            uint32_t numValues;
+            Address cand[MAX_SHIFTS];
+            SatCounter<3, 2, 0> candConf[MAX_SHIFTS];
+
+            // Confirmed indirect pattern
+            bool indirect;
+            uint32_t shift;
+            Address base;
+        };
+
+        Stream* table;
+        const uint32_t entries;
+        const uint32_t degree;
+        const uint32_t distance;
+        int32_t lastStream;  // stream whose index line was accessed last, -1 if none
+
+        Counter profIndexReads, profPatterns, profIndirect;
+
+        bool readIndices(Address lineAddr, int32_t* values, uint32_t n);
+        void learn(Stream& s, Address lineAddr);
+
+    public:
+        IMPPrefetchEngine(uint32_t _entries, uint32_t _degree, uint32_t _distance);
+        void initStats(AggregateStat* parentStat);
+        void train(const MemReq& req, bool pfHit, g_vector<Address>& cands);
+};
+
+/* Best-offset prefetcher (Michaud, HPCA 2016). Learning rounds test each offset d of a fixed list on every
+ * access X: d scores if X - d is in the recent-requests table, i.e., prefetching with offset d would have
+ * been timely. The best offset is adopted at the end of each learning phase, and prefetching turns off if
+ * its score is too low. The RR table gets Y - D when a prefetch of Y completes, or X itself when off.
+ */
+class BestOffsetPrefetchEngine : public PrefetchEngine {
+    private:
+        static const uint32_t SCORE_MAX = 31;
+        static const uint32_t ROUND_MAX = 100;
+        static const uint32_t BAD_SCORE = 1;
+        static const uint32_t MAX_PENDING = 32;
+
+        // Issued prefetches, inserted into the RR table (as line - offset) once they are filled
+        struct Pending {
+            Address base;
+            uint64_t respCycle;
+        };
+
+        g_vector<int32_t> offsets;
+        g_vector<uint32_t> scores;
+        Address* rrTable;
+        const uint32_t rrEntries;  // power of 2
+        const uint32_t degree;
+
+        Pending pending[MAX_PENDING];
+        uint32_t pendingHead, numPending;
+
+        uint32_t testIdx;
+        uint32_t round;
+        int32_t bestOffset;
+        bool enabled;
+
+        Counter profPhases, profDisabledPhases, profOffset;
+
+        void rrInsert(Address lineAddr);
+        bool rrHit(Address lineAddr) const;
+        void endPhase();
+
+    public:
+        BestOffsetPrefetchEngine(uint32_t _rrEntries, uint32_t _degree);
+        void initStats(AggregateStat* parentStat);
+        void train(const MemReq& req, bool pfHit, g_vector<Address>& cands);
+        void issued(Address lineAddr, uint64_t respCycle);
+};
+
+#endif  // PREFETCH_ENGINES_H_
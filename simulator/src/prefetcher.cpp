@@ -25,7 +25,9 @@
 
 #include "bithacks.h"
 #include "event_recorder.h"
+#include "prefetch_engines.h"
 #include "prefetcher.h"
+#include "self_profiler.h"
 #include "timing_event.h"
 #include "zsim.h"
 
@@ -100,26 +102,27 @@ uint64_t StreamPrefetcher::access(MemReq & req)
     wbAcc.clear();
 
     longerCycle = pfRespCycle = respCycle = parent->access(req);
+    SelfProfScope sp(SelfProfiler::SP_PREFETCH, req.srcId);
 
     if (likely(evRec && evRec->hasRecord()))
         wbAcc = evRec->popRecord();
 
     Address pageAddr = req.lineAddr >> 6;
     uint32_t pos = req.lineAddr & (64-1);
-    uint32_t idx = 16;
+    uint32_t idx = pfEntries;
 
 
     // This loop gets unrolled and there are no control dependences. Way faster than a break (but should watch for the avoidable loop-carried dep)
-    for (uint32_t i = 0; i < 16; i++) {
+    for (uint32_t i = 0; i < pfEntries; i++) {
         bool match = (pageAddr == tag[i]);
         idx = match?  i : idx;  // ccmov, no branch
     }
 
-    if (idx == 16) {  // entry miss
-        uint32_t cand = 16;
+    if (idx == pfEntries) {  // entry miss
+        uint32_t cand = pfEntries;
         uint64_t candScore = -1;
         //uint64_t candScore = 0;
-        for (uint32_t i = 0; i < 16; i++) {
+        for (uint32_t i = 0; i < pfEntries; i++) {
             if (array[i].lastCycle > reqCycle + 500) continue;  // warm prefetches, not even a candidate
             if (array[i].ts < candScore) {  // just LRU
                 cand = i;
@@ -127,7 +130,7 @@ uint64_t StreamPrefetcher::access(MemReq & req)
             }
         }
 
-        if (cand < 16) {
+        if (cand < pfEntries) {
             idx = cand;
             array[idx].alloc(reqCycle);
             array[idx].lastPos = pos;
@@ -167,7 +170,7 @@ uint64_t StreamPrefetcher::access(MemReq & req)
                     MESIState state = I;
                     MemReq pfReq =
                        { req.lineAddr + prefetchPos - pos, GETS, req.childId, &state, reqCycle, req.childLock,
-                            state, req.srcId, MemReq::PREFETCH
+                            state, req.srcId, MemReq::PREFETCH, req.pc
                     };
                     pfRespCycle = parent->access(pfReq);
                     longerCycle = (wbAcc.reqCycle > pfRespCycle) ? wbAcc.reqCycle : pfRespCycle;
@@ -248,3 +251,196 @@ uint64_t StreamPrefetcher::access(MemReq & req)
 uint64_t StreamPrefetcher::invalidate(const InvReq& req) {
     return child->invalidate(req);
 }
+
+/* Generic prefetcher */
+
+Prefetcher::Prefetcher(const g_string& _name, PrefetchEngine* _engine, uint32_t _tableEntries, uint32_t _degree, bool _buffer, uint32_t _bufferLatency)
+    : engine(_engine), tableEntries(_tableEntries), degree(_degree), buffer(_buffer), bufferLatency(_bufferLatency), name(_name)
+{
+    assert_msg(isPow2(tableEntries), "[%s] table entries must be a power of 2, %d specified", name.c_str(), tableEntries);
+    assert_msg(degree >= 1 && degree <= MAX_DEGREE, "[%s] degree must be 1-%d, %d specified", name.c_str(), MAX_DEGREE, degree);
+    table = gm_calloc<Entry>(tableEntries);
+    futex_init(&pfLock);
+}
+
+void Prefetcher::setParents(uint32_t _childId, const g_vector<MemObject*>& _parents, Network* network) {
+    // With a network, children account for the network latency to us; we don't add any to our parents
+    childId = _childId;
+    parents = _parents;
+    if (buffer) {
+        for (MemObject* p : parents) {
+            if (dynamic_cast<BaseCache*>(p)) panic("[%s] buffer = true needs memory as the parent, but %s is a cache", name.c_str(), p->getName());
+        }
+    }
+}
+
+void Prefetcher::setChildren(const g_vector<BaseCache*>& _children, Network* network) {
+    if (_children.size() < 1) panic("[%s] Must have children", name.c_str());
+    children = _children;
+}
+
+void Prefetcher::initStats(AggregateStat* parentStat) {
+    AggregateStat* s = new AggregateStat();
+    s->init(name.c_str(), "Prefetcher stats");
+    profAccesses.init("acc", "Demand accesses (misses of the level below)");
+    s->append(&profAccesses);
+    profPrefetches.init("pf", "Issued prefetches");
+    s->append(&profPrefetches);
+    profUseful.init("useful", "Prefetched lines hit by a demand access");
+    s->append(&profUseful);
+    profLate.init("late", "Useful prefetches that completed after the demand access would have");
+    s->append(&profLate);
+    profUseless.init("useless", "Prefetched lines evicted from the table without a demand hit");
+    s->append(&profUseless);
+    profDropped.init("dropped", "Candidates not issued because they were already tracked or demanded");
+    s->append(&profDropped);
+
+    // Derived, in 1/10000 (i.e., percentage with 2 decimals)
+    auto ratio = [](uint64_t num, uint64_t den) -> uint64_t { return den? num*10000/den : 0; };
+    auto accStat = makeLambdaStat([this, ratio]() { return ratio(profUseful.get(), profPrefetches.get()); });
+    accStat->init("accuracy", "useful / pf, x10000");
+    s->append(accStat);
+    auto covStat = makeLambdaStat([this, ratio]() { return ratio(profUseful.get(), profAccesses.get()); });
+    covStat->init("coverage", "useful / acc, x10000");
+    s->append(covStat);
+    auto lateStat = makeLambdaStat([this, ratio]() { return ratio(profLate.get(), profUseful.get()); });
+    lateStat->init("lateness", "late / useful, x10000");
+    s->append(lateStat);
+
+    engine->initStats(s);
+    parentStat->append(s);
+}
+
+// Same hash as MESIBottomCC, so a prefetcher spreads lines over its parents like a cache would
+uint32_t Prefetcher::getParentId(Address lineAddr) const {
+    uint32_t res = 0;
+    uint64_t tmp = lineAddr;
+    for (uint32_t i = 0; i < 4; i++) {
+        res ^= (uint32_t) ( ((uint64_t)0xffff) & tmp);
+        tmp = tmp >> 16;
+    }
+    return (res % parents.size());
+}
+
+uint64_t Prefetcher::access(MemReq& req) {
+    uint32_t origChildId = req.childId;
+    req.childId = childId;
+    MemObject* parent = parents[getParentId(req.lineAddr)];
+
+    if (req.type == PUTS || req.type == PUTX) {
+        if (buffer) {  // our copy of a written-back line is stale
+            futex_lock(&pfLock);
+            Entry* e = find(req.lineAddr);
+            if (e) e->valid = false;
+            futex_unlock(&pfLock);
+        }
+        uint64_t respCycle = parent->access(req);
+        req.childId = origChildId;
+        return respCycle;
+    }
+
+    // Train, and get the candidates out before we release the lock
+    Address pfLines[MAX_DEGREE];
+    uint32_t numPfLines = 0;
+    futex_lock(&pfLock);
+    profAccesses.inc();
+    Entry* e = find(req.lineAddr);
+    bool pfHit = e;
+    uint64_t pfRespCycle = pfHit? e->respCycle : 0;
+    if (pfHit) e->valid = false;
+    cands.clear();
+    engine->train(req, pfHit, cands);
+    for (Address lineAddr : cands) {
+        if (numPfLines == degree) break;
+        if (lineAddr == req.lineAddr || find(lineAddr)) {
+            profDropped.inc();
+            continue;
+        }
+        pfLines[numPfLines++] = lineAddr;
+    }
+    futex_unlock(&pfLock);
+
+    EventRecorder* evRec = zinfo->eventRecorders[req.srcId];
+    TimingRecord demandRec;
+    demandRec.clear();
+    uint64_t respCycle;
+    bool late = false;
+    if (pfHit && buffer) {
+        *req.state = (req.type == GETX)? M : (req.is(MemReq::NOEXCL)? S : E);
+        respCycle = req.cycle + bufferLatency;
+        late = pfRespCycle > respCycle;
+    } else {
+        respCycle = parent->access(req);
+        if (evRec && evRec->hasRecord()) demandRec = evRec->popRecord();
+        late = pfHit && pfRespCycle > respCycle;
+    }
+    if (pfHit) {
+        profUseful.atomicInc();
+        if (late) profLate.atomicInc();
+        respCycle = MAX(respCycle, pfRespCycle);
+    }
+
+    SelfProfScope sp(SelfProfiler::SP_PREFETCH, req.srcId);
+    TimingRecord pfRecs[MAX_DEGREE];
+    uint32_t numPfRecs = 0;
+    for (uint32_t i = 0; i < numPfLines; i++) {
+        MESIState state = I;
+        MemReq pfReq = {pfLines[i], GETS, childId, &state, req.cycle, req.childLock, state, req.srcId, MemReq::PREFETCH, req.pc};
+        uint64_t pfResp = parents[getParentId(pfLines[i])]->access(pfReq);  // may be a different bank than the demand's
+        if (evRec && evRec->hasRecord()) pfRecs[numPfRecs++] = evRec->popRecord();
+
+        futex_lock(&pfLock);
+        Entry* pe = &table[pfLines[i] & (tableEntries - 1)];
+        if (pe->valid) profUseless.inc();
+        pe->lineAddr = pfLines[i];
+        pe->respCycle = pfResp;
+        pe->valid = true;
+        profPrefetches.inc();
+        engine->issued(pfLines[i], pfResp);
+        futex_unlock(&pfLock);
+    }
+
+    // Keep a single record per access: prefetches hang off the start of the demand access, off its critical
+    // path (as in Cache::access with writebacks). If the demand access made no record, make one for the
+    // prefetches alone.
+    if (numPfRecs) {
+        DelayEvent* startEv = new (evRec) DelayEvent(0);
+        startEv->setMinStartCycle(req.cycle);
+        for (uint32_t i = 0; i < numPfRecs; i++) {
+            assert(pfRecs[i].reqCycle >= req.cycle);
+            DelayEvent* dEv = new (evRec) DelayEvent(pfRecs[i].reqCycle - req.cycle);
+            dEv->setMinStartCycle(req.cycle);
+            startEv->addChild(dEv, evRec)->addChild(pfRecs[i].startEvent, evRec);
+        }
+        if (demandRec.isValid()) {
+            assert(demandRec.reqCycle >= req.cycle);
+            DelayEvent* dAccEv = new (evRec) DelayEvent(demandRec.reqCycle - req.cycle);
+            dAccEv->setMinStartCycle(req.cycle);
+            startEv->addChild(dAccEv, evRec)->addChild(demandRec.startEvent, evRec);
+            demandRec.reqCycle = req.cycle;
+            demandRec.startEvent = startEv;
+        } else {
+            DelayEvent* endEv = new (evRec) DelayEvent(respCycle - req.cycle);
+            endEv->setMinStartCycle(req.cycle);
+            startEv->addChild(endEv, evRec);
+            demandRec = {req.lineAddr << lineBits, req.cycle, respCycle, req.type, startEv, endEv};
+        }
+    }
+    if (demandRec.isValid()) evRec->pushRecord(demandRec);
+
+    req.childId = origChildId;
+    return respCycle;
+}
+
+uint64_t Prefetcher::invalidate(const InvReq& req) {
+    // InvReqs don't say which child has the line, so we can only forward them with a single child (memory-side
+    // prefetchers never get invalidations)
+    if (children.size() != 1) panic("[%s] Got an invalidation, but has %ld children", name.c_str(), children.size());
+    if (buffer) {
+        futex_lock(&pfLock);
+        Entry* e = find(req.lineAddr);
+        if (e) e->valid = false;
+        futex_unlock(&pfLock);
+    }
+    return children[0]->invalidate(req);
+}
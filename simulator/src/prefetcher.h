@@ -29,6 +29,8 @@
 #include <bitset>
 #include "bithacks.h"
 #include "g_std/g_string.h"
+#include "g_std/g_vector.h"
+#include "locks.h"
 #include "memory_hierarchy.h"
 #include "stats.h"
 #include "timing_event.h"
@@ -222,4 +224,67 @@ class StreamPrefetcher : public BaseCache {
         uint64_t invalidate(const InvReq& req);
 };
 
+class PrefetchEngine;
+
+/* Generic prefetcher: interposes between a cache level and its parents like StreamPrefetcher, and issues
+ * the prefetches a PrefetchEngine (see prefetch_engines.h) proposes. It can sit below any cache, including
+ * between the LLC and memory.
+ *
+ * Prefetched lines are tracked in a small direct-mapped table until a demand access uses them. By default,
+ * prefetches fill the parent cache, and demands still access the parent, but complete no earlier than the
+ * prefetch did. With buffer = true, prefetched lines are held here instead, and demands that hit are served
+ * in bufferLatency cycles (or when the prefetch completes), without accessing the parent. This is only
+ * allowed when the parent is memory, which has nowhere to keep them. Each prefetch goes to the parent bank
+ * of its own line, which need not be the demand's.
+ *
+ * Stats: a useful prefetch is one a demand access hits before it is evicted from the table; it is late if
+ * the demand would have completed before the prefetch did. Since all accesses we see missed below,
+ * accuracy = useful / issued, coverage = useful / demand accesses, lateness = late / useful.
+ */
+class Prefetcher : public BaseCache {
+    private:
+        struct Entry {
+            Address lineAddr;
+            uint64_t respCycle;
+            bool valid;
+        };
+
+        static const uint32_t MAX_DEGREE = 16;
+
+        PrefetchEngine* engine;
+        Entry* table;
+        const uint32_t tableEntries;  // power of 2
+        const uint32_t degree;  // max prefetches issued per access
+        const bool buffer;
+        const uint32_t bufferLatency;
+
+        g_vector<Address> cands;  // engine output, protected by pfLock
+
+        g_vector<MemObject*> parents;
+        g_vector<BaseCache*> children;
+        uint32_t childId;
+        g_string name;
+
+        lock_t pfLock;
+
+        Counter profAccesses, profPrefetches, profUseful, profLate, profUseless, profDropped;
+
+        uint32_t getParentId(Address lineAddr) const;
+        Entry* find(Address lineAddr) {
+            Entry* e = &table[lineAddr & (tableEntries - 1)];
+            return (e->valid && e->lineAddr == lineAddr)? e : nullptr;
+        }
+
+    public:
+        Prefetcher(const g_string& _name, PrefetchEngine* _engine, uint32_t _tableEntries, uint32_t _degree, bool _buffer, uint32_t _bufferLatency);
+
+        void initStats(AggregateStat* parentStat);
+        const char* getName() { return name.c_str(); }
+        void setParents(uint32_t _childId, const g_vector<MemObject*>& _parents, Network* network);
+        void setChildren(const g_vector<BaseCache*>& _children, Network* network);
+
+        uint64_t access(MemReq& req);
+        uint64_t invalidate(const InvReq& req);
+};
+
 #endif  // PREFETCHER_H_
@@ -24,9 +24,12 @@
  */
 
 #include "ramulator_mem_ctrl.h"
+#include <cmath>
 #include <map>
 #include <string>
+#include "bithacks.h"
 #include "event_recorder.h"
+#include "self_profiler.h"
 #include "tick_event.h"
 #include "timing_event.h"
 #include "zsim.h"
@@ -39,17 +42,30 @@ class RamulatorAccEvent : public TimingEvent {
   private:
     Ramulator* dram;
     bool write;
+    bool exclusive;  // a GETX, which becomes an atomic in atomic ranges
     Address addr;
     uint32_t coreid;
   public:
     uint64_t sCycle;
-    RamulatorAccEvent(Ramulator* _dram, bool _write, Address _addr, int32_t domain, uint32_t _coreid) :
-            TimingEvent(0, 0, domain), dram(_dram), write(_write), addr(_addr), coreid(_coreid) {}
+    uint64_t sendCycle;  // when Ramulator accepted it (later than sCycle if it waited in overflowQueues)
+    uint64_t queueCycle, queueSeq;  // when and in which order it entered overflowQueues
+    int32_t atomicOp;  // set on enqueue, -1 if not an atomic
+    // Packet this event is sent in; only the first event of a coalesced packet is sent
+    RamulatorAccEvent* nextInPacket;
+    Address packetAddr;
+    uint32_t packetBytes;  // 0 = unsized (the memory's default transfer)
+    RamulatorAccEvent(Ramulator* _dram, bool _write, bool _exclusive, Address _addr, int32_t domain, uint32_t _coreid) :
+            TimingEvent(0, 0, domain), dram(_dram), write(_write), exclusive(_exclusive), addr(_addr), coreid(_coreid), atomicOp(-1),
+            nextInPacket(nullptr), packetAddr(_addr), packetBytes(0) {}
 
     bool isWrite() const {
       return write;
     }
 
+    bool isExclusive() const {
+      return exclusive;
+    }
+
     Address getAddr() const {
       return addr;
     }
@@ -75,7 +91,19 @@ Ramulator::Ramulator(std::string config_file, unsigned num_cpus, unsigned cache_
 	req_stall(false)
 {
   minLatency = _minLatency;
+  profSlot = zinfo->selfProf? zinfo->selfProf->allocSlot() : -1;
   m_num_cores=num_cpus;
+  lineSize = cache_line_size;
+  coreOutstanding.resize(num_cpus, 0);
+  coreLastChange.resize(num_cpus, 0);
+  coreMlpCycles.resize(num_cpus, 0);
+  coreMissCycles.resize(num_cpus, 0);
+  overflowQueues.resize(num_cpus);
+  qosShares.resize(num_cpus, 1);
+  qosPriority.resize(num_cpus, false);
+  qosLimit.resize(num_cpus, 0);
+  coreInflight.resize(num_cpus, 0);
+  qosVtime.resize(num_cpus, 0);
   const char* config_path = config_file.c_str();
   string pathStr = zinfo->outputDir;
   cout << pathStr << " " << application << endl;
@@ -84,9 +112,9 @@ Ramulator::Ramulator(std::string config_file, unsigned num_cpus, unsigned cache_
 
   wrapper = new ramulator::RamulatorWrapper(config_path, num_cpus, cache_line_size, pim_mode, _record_memory_trace, app_name, _networkOverhead);
 
-  cpu_tick = int(1000000.0/_cpuFreq);
-  mem_tick = wrapper->get_tCK()*1000;
-  if(pim_mode) cpu_tick = mem_tick;
+  cpu_tick = llround(1e9/_cpuFreq);
+  mem_tick = llround(wrapper->get_tCK()*1e6);
+  if(pim_mode) cpu_tick = mem_tick;  // PIM cores run at the memory clock
 
   tick_gcd = gcd(cpu_tick, mem_tick);
   cpu_tick /= tick_gcd;
@@ -98,9 +126,9 @@ Ramulator::Ramulator(std::string config_file, unsigned num_cpus, unsigned cache_
   memFreq = (1/(tCK /1000000))/1000;
   info ("[RAMULATOR] Mem frequency %f", memFreq);
   this->pim_mode = pim_mode;
+  futex_init(&placementLock);
   if(pim_mode) cpuFreq = memFreq;
-  freqRatio = ceil(cpuFreq/memFreq);
-  info("[RAMILATOR] CPU/Mem frequency ratio %d", freqRatio);
+  info("[RAMULATOR] CPU/Mem clock ratio %lu:%lu", mem_tick, cpu_tick);
 
   Stats_ramulator::statlist.output(pathStr+"/"+application+".ramulator.stats");
   curCycle = 0;
@@ -122,6 +150,46 @@ void Ramulator::initStats(AggregateStat* parentStat) {
   profTotalRdLat.init("rdlat", "Total latency experienced by read requests"); memStats->append(&profTotalRdLat);
   profTotalWrLat.init("wrlat", "Total latency experienced by write requests"); memStats->append(&profTotalWrLat);
   reissuedAccesses.init("reissuedAccesses", "Number of accesses that were reissued due to full queue"); memStats->append(&reissuedAccesses);
+  profAtomics.init("atomics", "Read-for-ownership misses executed as near-memory atomics"); memStats->append(&profAtomics);
+  profTotalAtomicLat.init("atomiclat", "Total latency experienced by atomics"); memStats->append(&profTotalAtomicLat);
+  profElidedWrites.init("elidedWr", "Write-backs of lines fetched as atomics dropped (memory holds the result)"); memStats->append(&profElidedWrites);
+  // Latencies above are in CPU cycles; these convert them to ns
+  auto rdLatNs = makeLambdaStat([this]() { return profTotalRdLat.get()*1000/cpuFreq; });
+  rdLatNs->init("rdlatNs", "Total latency experienced by read requests (ns)"); memStats->append(rdLatNs);
+  auto wrLatNs = makeLambdaStat([this]() { return profTotalWrLat.get()*1000/cpuFreq; });
+  wrLatNs->init("wrlatNs", "Total latency experienced by write requests (ns)"); memStats->append(wrLatNs);
+  auto memCycles = makeLambdaStat([this]() { return memCycle; });
+  memCycles->init("memCycles", "Memory clock cycles simulated"); memStats->append(memCycles);
+  profQosThrottled.init("qosThrottled", "Requests held back by their core's outstanding limit", m_num_cores); memStats->append(&profQosThrottled);
+  profQosWait.init("qosWait", "Cycles requests waited for arbitration, per core", m_num_cores); memStats->append(&profQosWait);
+  // Jain's index of per-core bytes/share over cores with traffic, x1000 (1000 = every core got its share)
+  auto fairness = makeLambdaStat([this]() {
+    double sum = 0, sumSq = 0;
+    uint32_t n = 0;
+    for (uint32_t c = 0; c < m_num_cores; c++) {
+      if (!profCoreBytes.count(c)) continue;
+      double x = (double)profCoreBytes.count(c) / qosShares[c];
+      sum += x;
+      sumSq += x*x;
+      n++;
+    }
+    return n? (uint64_t)(1000*sum*sum/(n*sumSq)) : 1000;
+  });
+  fairness->init("fairness", "Jain's fairness index of per-core bandwidth over share, x1000"); memStats->append(fairness);
+  profCoalescedLines.init("coalescedLines", "Lines sent in multi-line packets"); memStats->append(&profCoalescedLines);
+  profMultiLinePackets.init("multiLinePackets", "Multi-line packets sent"); memStats->append(&profMultiLinePackets);
+
+  // Per phase: bandwidth = d(coreBytes)/d(cycles), MLP = d(coreMlpCycles)/d(coreMissCycles),
+  // queueing share = d(coreQueueLat)/d(coreLat)
+  profCoreBytes.init("coreBytes", "Bytes transferred per core", m_num_cores); memStats->append(&profCoreBytes);
+  profCoreLat.init("coreLat", "Total memory latency per core", m_num_cores); memStats->append(&profCoreLat);
+  profCoreQueueLat.init("coreQueueLat", "Memory latency spent queued (overflow queue + controller queue) per core", m_num_cores); memStats->append(&profCoreQueueLat);
+  auto mlpStat = makeLambdaVectorStat([this](uint32_t c) { return integrateOutstanding(coreMlpCycles, c, false); }, m_num_cores);
+  mlpStat->init("coreMlpCycles", "Outstanding demand LLC misses per core, summed over cycles");
+  memStats->append(mlpStat);
+  auto missStat = makeLambdaVectorStat([this](uint32_t c) { return integrateOutstanding(coreMissCycles, c, true); }, m_num_cores);
+  missStat->init("coreMissCycles", "Cycles with at least one outstanding demand LLC miss per core");
+  memStats->append(missStat);
   parentStat->append(memStats);
 }
 
@@ -149,7 +217,7 @@ uint64_t Ramulator::access(MemReq& req) {
 
     if (zinfo->eventRecorders[req.srcId]) {
       Address addr = req.lineAddr <<lineBits;
-      RamulatorAccEvent* memEv = new (zinfo->eventRecorders[req.srcId]) RamulatorAccEvent(this, isWrite, addr, domain,req.srcId);
+      RamulatorAccEvent* memEv = new (zinfo->eventRecorders[req.srcId]) RamulatorAccEvent(this, isWrite, req.type == GETX, addr, domain,req.srcId);
       memEv->setMinStartCycle(req.cycle);
       TimingRecord tr = {addr, req.cycle, respCycle, req.type, memEv, memEv};
       zinfo->eventRecorders[req.srcId]->pushRecord(tr);
@@ -159,96 +227,298 @@ uint64_t Ramulator::access(MemReq& req) {
 }
 
 uint32_t Ramulator::tick(uint64_t cycle) {
-  // REMOVE comments for clock divider (i.e., memory clock is different from host clock)
-  //if((tickCounter % freqRatio) == 0){
-  wrapper->tick();
-  //}
-  //tickCounter++;
-
-  if(overflowQueue.size() > 0){
-    RamulatorAccEvent *ev = overflowQueue.front();
-    if(ev->isWrite()){
-      ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::WRITE, write_cb_func,ev->getCoreID());
-      long addr_tmp = req._addr;
-
-      if(wrapper->send(req)){
-        overflowQueue.pop_front();
-        inflight_w++;
-
-        inflightRequests.insert(std::pair<uint64_t, RamulatorAccEvent*>((long)ev->getAddr(), ev));
-        ev->hold();
-      }
-    }
-    else {
-      ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::READ, read_cb_func ,ev->getCoreID());
-      long addr_tmp = req._addr;
-
-      if(wrapper->send(req)){
-        overflowQueue.pop_front();
-        inflight_r++;
+  SelfProfScope sp(SelfProfiler::SP_MEMTICK, profSlot);
+  tickAccum += cpu_tick;
+  while (tickAccum >= mem_tick) {
+    wrapper->tick();
+    tickAccum -= mem_tick;
+    memCycle++;
+  }
 
-        inflightRequests.insert(std::pair<uint64_t, RamulatorAccEvent*>((long)ev->getAddr(), ev));
-        ev->hold();
-      }
+  for (auto it = coalesceGroups.begin(); it != coalesceGroups.end();) {
+    if (it->deadline <= curCycle) {
+      flushLines(*it, 0, coalesceLines, curCycle);
+      it = coalesceGroups.erase(it);
+    } else {
+      it++;
     }
   }
 
+  while (queuedPackets) {
+    int32_t c = pickQueue();
+    if (c < 0) break;
+    RamulatorAccEvent* ev = overflowQueues[c].front();
+    if (!send(ev, curCycle)) break;
+    overflowQueues[c].pop_front();
+    queuedPackets--;
+    for (RamulatorAccEvent* e = ev; e; e = e->nextInPacket) profQosWait.inc(c, curCycle - e->queueCycle);
+    if (qosPolicy == QOS_FIFO) break;  // one reissue per cycle
+    qosNext = (c + 1) % m_num_cores;
+  }
+
   curCycle++;
   return 1;
 }
 
-void Ramulator::finish(){
-  wrapper->finish();
-  Stats_ramulator::statlist.printall();
+void Ramulator::addPlacement(const ramulator::Placement& placement) {
+  futex_lock(&placementLock);
+  wrapper->add_placement(placement);
+  futex_unlock(&placementLock);
 }
 
-void Ramulator::enqueue(RamulatorAccEvent* ev, uint64_t cycle) {
-  long addr_tmp;
+bool Ramulator::supportsAtomics() {
+  return wrapper->supports_atomics();
+}
 
-  if(ev->isWrite()){
-    ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::WRITE, write_cb_func,ev->getCoreID());
-    addr_tmp = req._addr;
+void Ramulator::addAtomicRange(uint64_t start, uint64_t size, uint32_t op) {
+  futex_lock(&placementLock);
+  atomicRanges[start] = {size, op};
+  futex_unlock(&placementLock);
+}
 
-    if(!wrapper->send(req)){
-      overflowQueue.push_back(ev);
-      reissuedAccesses.inc();
-      return;
-    }
-      inflight_w++;
+int32_t Ramulator::findAtomicOp(Address addr) {
+  int32_t op = -1;
+  futex_lock(&placementLock);
+  auto it = atomicRanges.upper_bound(addr);
+  if (it != atomicRanges.begin()) {
+    it--;
+    if (addr - it->first < it->second.size) op = it->second.op;
   }
-  else {
-    ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::READ, read_cb_func, ev->getCoreID());
-    long addr_tmp = req._addr;
+  futex_unlock(&placementLock);
+  return op;
+}
+
+void Ramulator::setCoalescing(uint32_t window, uint32_t maxBytes) {
+  uint32_t bytes = MIN(maxBytes, (uint32_t)MAX(wrapper->max_request_bytes(), 0));
+  if (window && bytes < 2*lineSize) {
+    warn("[RAMULATOR] Memory takes at most %d-byte requests, line coalescing disabled", bytes);
+    window = 0;
+  }
+  coalesceWindow = window;
+  coalesceLines = window? MIN(bytes/lineSize, 32u) : 1;
+  if (!isPow2(coalesceLines)) panic("[RAMULATOR] sys.mem.coalesceBytes must be a power-of-2 multiple of the line size");
+  if (window) info("[RAMULATOR] Coalescing up to %d lines, %d-cycle window", coalesceLines, coalesceWindow);
+}
+
+// Sends ev's packet to Ramulator, returns false if its queue is full
+bool Ramulator::send(RamulatorAccEvent* ev, uint64_t cycle) {
+  ramulator::Request::Type type = ev->isWrite()? ramulator::Request::Type::WRITE :
+      (ev->atomicOp >= 0)? ramulator::Request::Type::ATOMIC : ramulator::Request::Type::READ;
+  ramulator::Request req((long)ev->packetAddr, type, ev->isWrite()? write_cb_func : read_cb_func, ev->getCoreID());
+  if (ev->atomicOp >= 0) req.atomic_op = (ramulator::Request::AtomicOp)ev->atomicOp;
+  req.size = ev->packetBytes;
+
+  if(!wrapper->send(req)){
+    return false;
+  }
+
+  inflightRequests.insert(std::pair<uint64_t, RamulatorAccEvent*>((long)ev->packetAddr, ev));
+  uint32_t c = ev->getCoreID();
+  for (RamulatorAccEvent* e = ev; e; e = e->nextInPacket) {
+    if (e->isWrite()) inflight_w++;
+    else inflight_r++;
+    coreInflight[c]++;
+    qosVtime[c] += 1.0/qosShares[c];
+    e->sendCycle = cycle;
+    e->hold();
+  }
+  qosSysVtime = qosVtime[c];
+  return true;
+}
+
+void Ramulator::setQos(const string& policy, const vector<uint32_t>& shares, const vector<uint32_t>& priorityCores, uint32_t maxOutstanding) {
+  if (policy == "FIFO") qosPolicy = QOS_FIFO;
+  else if (policy == "RR") qosPolicy = QOS_RR;
+  else if (policy == "Share") qosPolicy = QOS_SHARE;
+  else if (policy == "Priority") qosPolicy = QOS_PRIORITY;
+  else panic("[RAMULATOR] Invalid QoS policy %s (FIFO, RR, Share, Priority)", policy.c_str());
+
+  assert(shares.size() == m_num_cores);
+  uint64_t totalShares = 0;
+  for (uint32_t c = 0; c < m_num_cores; c++) {
+    if (!shares[c]) panic("[RAMULATOR] QoS share of core %d must be > 0", c);
+    qosShares[c] = shares[c];
+    totalShares += shares[c];
+  }
+  for (uint32_t c : priorityCores) {
+    if (c >= m_num_cores) panic("[RAMULATOR] QoS priority core %d out of range", c);
+    qosPriority[c] = true;
+  }
+  for (uint32_t c = 0; c < m_num_cores; c++) {
+    // With equal shares every core gets maxOutstanding
+    qosLimit[c] = (!maxOutstanding || qosPriority[c])? 0 :
+        MAX(1u, (uint32_t)(maxOutstanding * qosShares[c] * m_num_cores / totalShares));
+  }
+  if (qosPolicy != QOS_FIFO || maxOutstanding) info("[RAMULATOR] QoS policy %s, %d max outstanding lines per core", policy.c_str(), maxOutstanding);
+}
+
+bool Ramulator::canIssue(uint32_t core) const {
+  return !qosLimit[core] || coreInflight[core] < qosLimit[core];
+}
 
-    if(!wrapper->send(req)){
-      overflowQueue.push_back(ev);
-      reissuedAccesses.inc();
-      return;
+int32_t Ramulator::pickQueue() const {
+  int32_t best = -1;
+  for (uint32_t i = 0; i < m_num_cores; i++) {
+    uint32_t c = (qosNext + i) % m_num_cores;
+    if (overflowQueues[c].empty() || !canIssue(c)) continue;
+    if (best < 0) {
+      best = c;
+      if (qosPolicy == QOS_RR) break;
+      continue;
     }
+    switch (qosPolicy) {
+      case QOS_FIFO:
+        if (overflowQueues[c].front()->queueSeq < overflowQueues[best].front()->queueSeq) best = c;
+        break;
+      case QOS_SHARE:
+        if (qosVtime[c] < qosVtime[best]) best = c;
+        break;
+      case QOS_PRIORITY:
+        if (qosPriority[c] && !qosPriority[best]) best = c;
+        break;
+      default:
+        break;
+    }
+  }
+  return best;
+}
+
+void Ramulator::sendOrQueue(RamulatorAccEvent* ev, uint64_t cycle) {
+  uint32_t c = ev->getCoreID();
+  // FIFO keeps letting new requests past the queue, as Ramulator's queue may have drained
+  bool bypass = (qosPolicy == QOS_FIFO || overflowQueues[c].empty()) && canIssue(c);
+  if (bypass && send(ev, cycle)) return;
+
+  if (!bypass) profQosThrottled.inc(c);
+  else reissuedAccesses.inc();
+  // A core that was idle resumes at the current virtual time, without credit for its idle period
+  if (overflowQueues[c].empty()) qosVtime[c] = MAX(qosVtime[c], qosSysVtime);
+  ev->queueSeq = queueSeq++;
+  for (RamulatorAccEvent* e = ev; e; e = e->nextInPacket) e->queueCycle = cycle;
+  overflowQueues[c].push_back(ev);
+  queuedPackets++;
+}
+
+void Ramulator::coalesce(RamulatorAccEvent* ev, uint64_t cycle) {
+  Address block = ev->getAddr() & ~((Address)coalesceLines*lineSize - 1);
+  uint32_t line = (ev->getAddr() - block) / lineSize;
+  ev->packetBytes = lineSize;
+
+  auto it = coalesceGroups.begin();
+  while (it != coalesceGroups.end() && !(it->block == block && it->write == ev->isWrite() && it->coreid == ev->getCoreID())) it++;
+  if (it == coalesceGroups.end()) {
+    coalesceGroups.push_back({block, ev->getCoreID(), ev->isWrite(), curCycle + coalesceWindow, 0, vector<RamulatorAccEvent*>(coalesceLines)});
+    it = --coalesceGroups.end();
+  } else if (it->mask & (1u << line)) {
+    sendOrQueue(ev, cycle);  // same line again (e.g., a write-back after a refetch), don't hold back the first
+    return;
+  }
+
+  it->mask |= 1u << line;
+  it->lines[line] = ev;
+  uint32_t full = (coalesceLines == 32)? ~0u : (1u << coalesceLines) - 1;
+  if (it->mask == full) {
+    flushLines(*it, 0, coalesceLines, cycle);
+    coalesceGroups.erase(it);
+  }
+}
 
-    inflight_r++;
+// Sends lines [lo, lo+n) of g as one packet if all are present, else splits
+// the range in halves. n is a power of 2 and lo a multiple of n, so every
+// packet stays naturally aligned. Reads don't fetch absent lines: a partial
+// block costs a full-size response for few useful lines
+void Ramulator::flushLines(CoalesceGroup& g, uint32_t lo, uint32_t n, uint64_t cycle) {
+  uint32_t m = (g.mask >> lo) & ((n == 32)? ~0u : (1u << n) - 1);
+  if (!m) return;
+  if (n > 1 && m != ((n == 32)? ~0u : (1u << n) - 1)) {
+    flushLines(g, lo, n/2, cycle);
+    flushLines(g, lo + n/2, n/2, cycle);
+    return;
   }
 
-  inflightRequests.insert(std::pair<uint64_t, RamulatorAccEvent*>((long)ev->getAddr(), ev));
-  ev->hold();
+  RamulatorAccEvent* head = g.lines[lo];
+  for (uint32_t i = lo; i < lo + n - 1; i++) g.lines[i]->nextInPacket = g.lines[i+1];
+  head->packetAddr = g.block + lo*lineSize;
+  head->packetBytes = n*lineSize;
+  if (n > 1) {
+    profMultiLinePackets.inc();
+    profCoalescedLines.inc(n);
+  }
+  sendOrQueue(head, cycle);
+}
+
+void Ramulator::finish(){
+  wrapper->finish();
+  Stats_ramulator::statlist.printall();
+}
+
+void Ramulator::enqueue(RamulatorAccEvent* ev, uint64_t cycle) {
+  if (!atomicRanges.empty()) {
+    if (ev->isWrite()) {
+      if (atomicLines.erase(ev->getAddr())) {
+        // The atomics already updated memory
+        profElidedWrites.inc();
+        ev->done(cycle);
+        return;
+      }
+    } else {
+      int32_t op = ev->isExclusive()? findAtomicOp(ev->getAddr()) : -1;
+      ev->atomicOp = op;
+      // A plain read refetches the whole line, so its next write-back is real
+      if (op >= 0) atomicLines.insert(ev->getAddr());
+      else atomicLines.erase(ev->getAddr());
+    }
+  }
+
+  if (!ev->isWrite()) updateOutstanding(ev->getCoreID(), 1, cycle);
+
+  if (coalesceWindow && ev->atomicOp < 0) coalesce(ev, cycle);
+  else sendOrQueue(ev, cycle);
 }
 
 void Ramulator::DRAM_read_return_cb(ramulator::Request& req) {
-  std::multimap<uint64_t, RamulatorAccEvent*>::iterator it = inflightRequests.find(req._addr);
-  if(it == inflightRequests.end()){
-    info("[RAMULATOR] I didn't request address %ld (%ld)", req._addr, req.addr);
+  // Packets of different sizes or directions may share an address (e.g., a line and the coalesced block that
+  // starts at it), so match those too. Among equal ones, the multimap keeps the oldest first
+  bool isWrite = (req.type == ramulator::Request::Type::WRITE);
+  auto range = inflightRequests.equal_range(req._addr);
+  std::multimap<uint64_t, RamulatorAccEvent*>::iterator it = range.first;
+  while (it != range.second && (it->second->packetBytes != (uint32_t)req.size || it->second->isWrite() != isWrite)) it++;
+  if(it == range.second){
+    info("[RAMULATOR] I didn't request address %ld (%ld), size %d", req._addr, req.addr, req.size);
   }
 
-  assert((it != inflightRequests.end()));
+  assert((it != range.second));
   RamulatorAccEvent* ev = it->second;
+  inflightRequests.erase(it);
 
+  // done() frees the event, so read the next line of the packet first
+  while (ev) {
+    RamulatorAccEvent* next = ev->nextInPacket;
+    complete(ev, req.queue_cycles);
+    ev = next;
+  }
+}
+
+void Ramulator::complete(RamulatorAccEvent* ev, uint64_t queueCycles) {
   uint32_t lat = curCycle+1 - ev->sCycle;
+  uint32_t coreid = ev->getCoreID();
+  if (!ev->isWrite()) updateOutstanding(coreid, -1, curCycle+1);
+  coreInflight[coreid]--;
+  profCoreBytes.inc(coreid, (ev->atomicOp >= 0)? 16 : lineSize);  // atomics move a 16-byte operand
+  profCoreLat.inc(coreid, lat);
+  // queueCycles are memory clocks; convert them to CPU cycles like the rest
+  profCoreQueueLat.inc(coreid, ev->sendCycle - ev->sCycle + queueCycles*mem_tick/cpu_tick);
 
   if (ev->isWrite()) {
     profWrites.inc();
     profTotalWrLat.inc(lat);
     inflight_w--;
   }
+  else if (ev->atomicOp >= 0) {
+    profAtomics.inc();
+    profTotalAtomicLat.inc(lat);
+    inflight_r--;
+  }
   else {
     profReads.inc();
     profTotalRdLat.inc(lat);
@@ -257,8 +527,25 @@ void Ramulator::DRAM_read_return_cb(ramulator::Request& req) {
 
   ev->release();
   ev->done(curCycle+1);
+}
 
-  inflightRequests.erase(it);
+void Ramulator::updateOutstanding(uint32_t core, int32_t delta, uint64_t cycle) {
+  assert(core < m_num_cores);
+  // Enqueues run at the event's cycle, which may be slightly ahead of callbacks
+  if (cycle > coreLastChange[core]) {
+    uint64_t elapsed = cycle - coreLastChange[core];
+    coreMlpCycles[core] += coreOutstanding[core] * elapsed;
+    if (coreOutstanding[core]) coreMissCycles[core] += elapsed;
+    coreLastChange[core] = cycle;
+  }
+  coreOutstanding[core] += delta;
+}
+
+uint64_t Ramulator::integrateOutstanding(const vector<uint64_t>& integral, uint32_t core, bool busyOnly) const {
+  // Include the interval since the last change, so periodic dumps are exact
+  uint64_t elapsed = (curCycle > coreLastChange[core])? curCycle - coreLastChange[core] : 0;
+  uint64_t outstanding = busyOnly? (coreOutstanding[core] > 0) : coreOutstanding[core];
+  return integral[core] + outstanding * elapsed;
 }
 
 void Ramulator::DRAM_write_return_cb(ramulator::Request& req) {
@@ -5,7 +5,10 @@
 #include <set>
 #include <string>
 #include <functional>
+#include <unordered_set>
+#include <vector>
 #include "g_std/g_string.h"
+#include "locks.h"
 #include "memory_hierarchy.h"
 #include "pad.h"
 #include <list>
@@ -16,19 +19,20 @@ using namespace std;
 
 namespace ramulator {
   class Request;
+  struct Placement;
   class RamulatorWrapper;
 };
 
 class RamulatorAccEvent;
 class Ramulator : public MemObject { //one Ramulator controller
   private:
-    static int gcd(int u, int v) {
+    static uint64_t gcd(uint64_t u, uint64_t v) {
       if (v > u) {
         swap(u,v);
       }
 
       while (v != 0) {
-        int r = u % v;
+        uint64_t r = u % v;
         u = v;
         v = r;
       }
@@ -44,15 +48,46 @@ class Ramulator : public MemObject { //one Ramulator controller
     uint32_t clockDivider;
     double tCK;
     double memFreq;
-    unsigned freqRatio;
     bool pim_mode;
-    unsigned long long tickCounter = 0;
-    int cpu_tick, mem_tick, tick_gcd;
+    // Clock-domain crossing: every CPU cycle adds cpu_tick to tickAccum, and the
+    // memory ticks once per mem_tick accumulated. Both are clock periods (fs)
+    // divided by their gcd, so fractional ratios don't drift
+    uint64_t cpu_tick, mem_tick, tick_gcd;
+    uint64_t tickAccum = 0;
+    uint64_t memCycle = 0;
+    uint32_t profSlot;  // for ticks, see SelfProfiler
     string application_name;
     ramulator::RamulatorWrapper* wrapper;
-
+    lock_t placementLock;  // also guards atomicRanges
+
+    // Near-memory atomic ranges (magic ops), by start address
+    struct AtomicRange {
+      uint64_t size;
+      uint32_t op;  // ramulator::Request::AtomicOp
+    };
+    std::map<uint64_t, AtomicRange> atomicRanges;
+    // Lines last fetched as atomics. Memory already holds their result, so
+    // their write-backs are dropped; any other line's write-back goes out
+    std::unordered_set<Address> atomicLines;
+
+    // Keyed by packet address; coalesced lines hang off the packet's first event
     std::multimap<uint64_t, RamulatorAccEvent*> inflightRequests;
 
+    // Line coalescing into multi-line packets (sys.mem.coalesceWindow). Misses
+    // from one core to the same aligned block wait up to coalesceWindow cycles
+    // for their neighbors, then go out as the fewest fully-covered aligned packets
+    struct CoalesceGroup {
+      Address block;
+      uint32_t coreid;
+      bool write;
+      uint64_t deadline;
+      uint32_t mask;  // lines present
+      vector<RamulatorAccEvent*> lines;
+    };
+    uint32_t coalesceWindow = 0;  // 0 = off, requests are unsized
+    uint32_t coalesceLines = 1;   // lines per block
+    std::list<CoalesceGroup> coalesceGroups;
+
     uint64_t curCycle; //processor cycle, used in callbacks
 
     // R/W stats
@@ -62,10 +97,35 @@ class Ramulator : public MemObject { //one Ramulator controller
     Counter profTotalRdLat;
     Counter profTotalWrLat;
   	Counter reissuedAccesses;
+    Counter profAtomics;
+    Counter profTotalAtomicLat;
+    Counter profElidedWrites;
+    Counter profCoalescedLines;
+    Counter profMultiLinePackets;
+
+    // Per-core memory profile (bandwidth, MLP, queueing share), meant to be
+    // read per phase from the periodic stats (sim.periodicStats)
+    VectorCounter profCoreBytes;
+    VectorCounter profCoreLat;
+    VectorCounter profCoreQueueLat;
+    VectorCounter profQosThrottled;
+    VectorCounter profQosWait;
     PAD();
     int inflight_r = 0;
     int inflight_w = 0;
 
+    // Demand LLC misses (reads and atomics) in flight per core, including those
+    // waiting in overflowQueues, integrated over time on every change.
+    // Write-backs don't stall the core, so they don't count
+    uint32_t lineSize;
+    vector<uint32_t> coreOutstanding;
+    vector<uint64_t> coreLastChange;
+    vector<uint64_t> coreMlpCycles;   // sum over cycles of coreOutstanding
+    vector<uint64_t> coreMissCycles;  // cycles with at least one miss in flight
+
+    void updateOutstanding(uint32_t core, int32_t delta, uint64_t cycle);
+    uint64_t integrateOutstanding(const vector<uint64_t>& integral, uint32_t core, bool busyOnly) const;
+
   public:
     Ramulator(std::string config_file, unsigned num_cpus, unsigned cache_line_size, uint32_t _minLatency, uint32_t _domain, const g_string& _name, bool pim_mode,  const string& application, unsigned _cpuFreq, bool _record_memory_trace, bool networkOverhead);
     ~Ramulator();
@@ -81,12 +141,30 @@ class Ramulator : public MemObject { //one Ramulator controller
     uint32_t tick(uint64_t cycle);
     void enqueue(RamulatorAccEvent* ev, uint64_t cycle);
 
+    // Software data placement and near-memory atomic ranges (magic ops), called from application threads
+    void addPlacement(const ramulator::Placement& placement);
+    bool supportsAtomics();
+    void addAtomicRange(uint64_t start, uint64_t size, uint32_t op);
+
+    // Enables line coalescing, capped by the largest request the memory takes
+    void setCoalescing(uint32_t window, uint32_t maxBytes);
+    // Arbitration policy (FIFO, RR, Share, Priority) between cores' queued requests,
+    // plus a per-core limit on lines in Ramulator (0 = none), scaled by share
+    void setQos(const string& policy, const vector<uint32_t>& shares, const vector<uint32_t>& priorityCores, uint32_t maxOutstanding);
+
   private:
     std::function<void(ramulator::Request&)> read_cb_func;
 	  std::function<void(ramulator::Request&)> write_cb_func;
 	  bool resp_stall;
 	  bool req_stall;
 
+    int32_t findAtomicOp(Address addr);  // -1 if addr is in no atomic range
+    bool send(RamulatorAccEvent* ev, uint64_t cycle);
+    void sendOrQueue(RamulatorAccEvent* ev, uint64_t cycle);
+    void coalesce(RamulatorAccEvent* ev, uint64_t cycle);
+    void flushLines(CoalesceGroup& g, uint32_t lo, uint32_t n, uint64_t cycle);
+    void complete(RamulatorAccEvent* ev, uint64_t queueCycles);
+
     void DRAM_read_return_cb(ramulator::Request&);
     void DRAM_write_return_cb(ramulator::Request&);
 	  unsigned m_num_cores;
@@ -96,7 +174,25 @@ class Ramulator : public MemObject { //one Ramulator controller
     set<uint64_t> inflightCheck2;
     map<uint64_t, uint64_t> addr_counter;
 
-    std::list<RamulatorAccEvent*> overflowQueue;
+    // Requests Ramulator couldn't take yet, or that their core's outstanding
+    // limit holds back, per core, drained by the QoS policy in tick()
+    vector<std::list<RamulatorAccEvent*>> overflowQueues;
+    uint32_t queuedPackets = 0;
+    uint64_t queueSeq = 0;
+
+    // Arbitration between cores (sys.mem.qos.*)
+    enum QosPolicy {QOS_FIFO, QOS_RR, QOS_SHARE, QOS_PRIORITY};
+    QosPolicy qosPolicy = QOS_FIFO;
+    vector<uint32_t> qosShares;
+    vector<bool> qosPriority;   // latency-critical cores: served first, never throttled
+    vector<uint32_t> qosLimit;  // max lines in Ramulator per core, 0 = unlimited
+    vector<uint32_t> coreInflight;
+    vector<double> qosVtime;    // lines served / share, for QOS_SHARE
+    double qosSysVtime = 0;
+    uint32_t qosNext = 0;       // round-robin pointer
+
+    bool canIssue(uint32_t core) const;
+    int32_t pickQueue() const;  // -1 if no queue can issue
 };
 
 #endif  // RAMULATOR_MEM_CTRL_H_
@@ -39,6 +39,7 @@
 #include "g_std/g_unordered_set.h"
 #include "g_std/g_vector.h"
 #include "intrusive_list.h"
+#include "phase_controller.h"
 #include "proc_stats.h"
 #include "process_stats.h"
 #include "stats.h"
@@ -432,6 +433,7 @@ class Scheduler : public GlobAlloc, public Callee {
             /* End of phase accounting */
             zinfo->numPhases++;
             zinfo->globPhaseCycles += zinfo->phaseLength;
+            if (zinfo->phaseController) zinfo->phaseController->endPhase();
             curPhase++;
 
             assert(curPhase == zinfo->numPhases); //check they don't skew
@@ -0,0 +1,96 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "self_profiler.h"
+#include <string.h>
+#include "core.h"
+#include "log.h"
+
+SelfProfiler::SelfProfiler(uint32_t _rate, uint32_t numCores) : rate(_rate), barrierCycles(0), lockWaitCycles(0), dumpNs(0) {
+    assert(rate);
+    for (uint32_t i = 0; i < numCores; i++) allocSlot();
+    info("Self-profiling 1 in %d entries of hot simulator components", rate);
+}
+
+uint32_t SelfProfiler::allocSlot() {
+    Slot* s = gm_memalign<Slot>(CACHE_LINE_BYTES, 1);
+    memset(s, 0, sizeof(Slot));
+    for (uint32_t c = 0; c < SP_NUM; c++) s->ticker[c] = 1;  // sample the first entry
+    slots.push_back(s);
+    return slots.size() - 1;
+}
+
+uint64_t SelfProfiler::cycles(uint32_t c) const {
+    uint64_t total = 0;
+    for (Slot* s : slots) total += s->cycles[c];
+    return total;
+}
+
+void SelfProfiler::initStats(AggregateStat* parentStat) {
+    AggregateStat* spStats = new AggregateStat();
+    spStats->init("selfProf", "Simulator self-profile (host time)");
+
+    const char* names[] = {"bbl", "loadStore", "l1Miss", "coherence", "prefetch", "memTick"};
+    const char* descs[] = {"Host cycles in basic block analysis calls (sampled)", "Host cycles in load/store analysis calls (sampled)",
+        "Host cycles in L1 misses (sampled)", "Host cycles sending invalidations/downgrades to children (sampled)",
+        "Host cycles training prefetchers and issuing prefetches (sampled)", "Host cycles ticking memory controllers (sampled)"};
+    static_assert(sizeof(names)/sizeof(names[0]) == SP_NUM, "One name per component");
+    for (uint32_t c = 0; c < SP_NUM; c++) {
+        auto cStat = makeLambdaStat([this, c]() { return cycles(c); });
+        cStat->init(names[c], descs[c]);
+        spStats->append(cStat);
+    }
+
+    auto barrierStat = makeLambdaStat([this]() { return barrierCycles; });
+    barrierStat->init("barrier", "Host cycles in end-of-phase barriers, summed over threads");
+    spStats->append(barrierStat);
+    auto lockStat = makeLambdaStat([this]() { return lockWaitCycles; });
+    lockStat->init("cacheLockWait", "Host cycles waiting on contended shared cache locks");
+    spStats->append(lockStat);
+    auto dumpStat = makeLambdaStat([this]() { return dumpNs; });
+    dumpStat->init("statsDumpNs", "Host ns dumping HDF5 stats");
+    spStats->append(dumpStat);
+    profEndOfPhase.init("endOfPhaseNs", "Host ns in end-of-phase actions (weave phase, events)");
+    spStats->append(&profEndOfPhase);
+
+    // Simulation speed: instructions per second of bound + weave time (ns), in thousands
+    auto simNs = []() { return zinfo->profSimTime->count(PROF_BOUND) + zinfo->profSimTime->count(PROF_WEAVE); };
+    auto coreKipsStat = makeLambdaVectorStat([simNs](uint32_t i) {
+        uint64_t ns = simNs();
+        return ns? (uint64_t)(zinfo->cores[i]->getInstrs()*1e6/ns) : 0;
+    }, zinfo->numCores);
+    coreKipsStat->init("coreKips", "Simulated kIPS per core");
+    spStats->append(coreKipsStat);
+    auto kipsStat = makeLambdaStat([simNs]() {
+        uint64_t ns = simNs();
+        uint64_t instrs = 0;
+        for (uint32_t i = 0; i < zinfo->numCores; i++) instrs += zinfo->cores[i]->getInstrs();
+        return ns? (uint64_t)(instrs*1e6/ns) : 0;
+    });
+    kipsStat->init("kips", "Simulated kIPS, all cores");
+    spStats->append(kipsStat);
+
+    parentStat->append(spStats);
+}
@@ -0,0 +1,155 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SELF_PROFILER_H_
+#define SELF_PROFILER_H_
+
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "pad.h"
+#include "profile_stats.h"
+#include "rdtsc.h"
+#include "stats.h"
+#include "zsim.h"
+
+/* Low-overhead profile of where the simulator spends host time
+ * (sim.selfProfile = N, 0 disables it).
+ *
+ * Hot components are timed with rdtsc on 1 in N entries of a SelfProfScope,
+ * and the sample is scaled by N. Times are inclusive (e.g., l1Miss includes
+ * the coherence and prefetching that the miss causes); nested or recursive
+ * entries into the same component count once. Scopes are per slot, and each
+ * slot is only used by one host thread at a time: slots 0..numCores-1 belong
+ * to whatever thread runs that core in the bound phase (scopes there use
+ * the core's cid or the request's srcId), and objects simulated in the weave
+ * phase get their own with allocSlot(). A thread leaving its core at the
+ * barrier drops its open samples, so bbl and loadStore exclude barriers.
+ *
+ * Rare events are timed in full: barrier waits (which, for the thread that
+ * ends the phase, include the end of phase actions), waits on contended
+ * shared cache locks, stats dumps, and the end of phase actions themselves
+ * (a ClockStat, as the rest of zinfo->profSimTime).
+ *
+ * Stats are cumulative; use periodic stats for per-phase breakdowns. They
+ * also include simulated kIPS per core, i.e., instructions simulated per
+ * second of bound and weave phase time.
+ */
+class SelfProfiler : public GlobAlloc {
+    public:
+        enum Component {
+            SP_BBL,        // Pin basic block analysis calls (core models)
+            SP_LOADSTORE,  // Pin load/store analysis calls, incl. L1 (FilterCache) hits
+            SP_L1MISS,     // FilterCache misses, down the whole hierarchy
+            SP_COHERENCE,  // invalidations and downgrades sent to children
+            SP_PREFETCH,   // prefetcher training and issue
+            SP_MEMTICK,    // memory controller ticks in the weave phase (Ramulator)
+            SP_NUM
+        };
+
+    private:
+        struct Slot {
+            uint64_t cycles[SP_NUM];
+            uint64_t start[SP_NUM];  // 0 if this entry is not sampled
+            uint32_t ticker[SP_NUM];  // entries until the next sample
+            uint32_t depth[SP_NUM];
+            uint32_t gen;  // bumped when the slot changes threads
+        } ATTR_LINE_ALIGNED;
+
+        const uint32_t rate;
+        g_vector<Slot*> slots;
+
+        PAD();
+        volatile uint64_t barrierCycles;
+        volatile uint64_t lockWaitCycles;
+        volatile uint64_t dumpNs;
+        PAD();
+
+        ClockStat profEndOfPhase;
+
+    public:
+        SelfProfiler(uint32_t _rate, uint32_t numCores);
+
+        void initStats(AggregateStat* parentStat);
+
+        // For objects that a single thread simulates at a time outside cores' slots. Call at init.
+        uint32_t allocSlot();
+
+        // The thread running core cid leaves it at the barrier; drops open samples
+        void leaveCore(uint32_t cid) {
+            Slot* s = slots[cid];
+            s->gen++;
+            for (uint32_t c = 0; c < SP_NUM; c++) s->depth[c] = s->start[c] = 0;
+        }
+
+        void barrier(uint64_t cycles) {__sync_fetch_and_add(&barrierCycles, cycles);}
+        void lockWait(uint64_t cycles) {__sync_fetch_and_add(&lockWaitCycles, cycles);}
+        void statsDump(uint64_t ns) {__sync_fetch_and_add(&dumpNs, ns);}
+
+        void startEndOfPhase() {profEndOfPhase.start();}
+        void endEndOfPhase() {profEndOfPhase.end();}
+
+    private:
+        uint64_t cycles(uint32_t c) const;
+
+        inline Slot* enter(uint32_t c, uint32_t slot, uint32_t& gen) {
+            if (slot >= slots.size()) return nullptr;  // e.g., INVALID_CID
+            Slot* s = slots[slot];
+            gen = s->gen;
+            if (s->depth[c]++ == 0 && --s->ticker[c] == 0) {
+                s->ticker[c] = rate;
+                s->start[c] = rdtsc();
+            }
+            return s;
+        }
+
+        inline void exit(Slot* s, uint32_t c, uint32_t gen) {
+            if (s->gen != gen) return;  // left the core mid-scope, see leaveCore()
+            if (--s->depth[c] == 0 && s->start[c]) {
+                s->cycles[c] += (rdtsc() - s->start[c])*rate;
+                s->start[c] = 0;
+            }
+        }
+
+        friend class SelfProfScope;
+};
+
+// Times the enclosing block as component c of slot, if self-profiling
+class SelfProfScope {
+    private:
+        SelfProfiler::Slot* s;
+        uint32_t c;
+        uint32_t gen;
+
+    public:
+        SelfProfScope(SelfProfiler::Component _c, uint32_t slot) : s(nullptr), c(_c) {
+            if (zinfo->selfProf) s = zinfo->selfProf->enter(c, slot, gen);
+        }
+
+        ~SelfProfScope() {
+            if (s) zinfo->selfProf->exit(s, c, gen);
+        }
+};
+
+#endif  // SELF_PROFILER_H_
@@ -0,0 +1,146 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "sharing_profiler.h"
+#include "bithacks.h"
+#include "log.h"
+
+SharingProfiler::SharingProfiler(uint32_t _numLines, uint32_t _children, uint32_t _samplingRate, const g_string& _name)
+    : numLines(_numLines), tracked(MIN(_children, MAX_TRACKED)), samplingRate(_samplingRate), name(_name)
+{
+    assert(samplingRate);
+    lines = gm_calloc<LineProfile>(numLines);  // all inactive
+    for (uint32_t c = 0; c < NUM_CLASSES; c++) finishedLines[c] = 0;
+    info("%s: profiling sharing of 1 in %d lines, %d children", name.c_str(), samplingRate, _children);
+}
+
+void SharingProfiler::initStats(AggregateStat* parentStat) {
+    AggregateStat* shStats = new AggregateStat();
+    shStats->init("sharing", "Sampled sharing profile");
+    profSampledLines.init("sampled", "Sampled line lifetimes started"); shStats->append(&profSampledLines);
+
+    const char* classNames[] = {"private", "readShared", "writeShared", "migratory"};
+    const char* classDescs[] = {"Sampled lines touched by a single child", "Sampled lines read by several children, never written",
+        "Sampled lines written, shared by several children", "Sampled lines written by several children in turns"};
+    for (uint32_t c = 0; c < NUM_CLASSES; c++) {
+        auto classStat = makeLambdaStat([this, c]() { return classCount((LineClass)c); });
+        classStat->init(classNames[c], classDescs[c]);
+        shStats->append(classStat);
+    }
+
+    profTransfers.init("xfers", "Producer->consumer transfers of sampled lines, [producer * children + consumer]", tracked*tracked);
+    shStats->append(&profTransfers);
+    profCohInvs.init("cohINV", "Invalidations sent to children to satisfy accesses"); shStats->append(&profCohInvs);
+    profCohDowngrades.init("cohINVX", "Downgrades sent to children to satisfy accesses"); shStats->append(&profCohDowngrades);
+    profCohWritebacks.init("cohWB", "Dirty lines returned by children due to coherence"); shStats->append(&profCohWritebacks);
+    parentStat->append(shStats);
+}
+
+SharingProfiler::LineProfile* SharingProfiler::profile(Address lineAddr, uint32_t lineId) {
+    LineProfile* p = &lines[lineId];
+    if (p->active && p->lineAddr == lineAddr) return p;
+    if (p->active) evict(lineId);  // missed its eviction, e.g., non-inclusive caches
+
+    // Fibonacci hash, so strided addresses don't all (or never) get sampled
+    if (((lineAddr * 0x9E3779B97F4A7C15ul) >> 32) % samplingRate) return nullptr;
+    p->lineAddr = lineAddr;
+    p->children = p->writers = p->consumers = 0;
+    p->lastWriter = p->lastReader = NONE;
+    p->writes = p->migratoryWrites = 0;
+    p->active = true;
+    profSampledLines.atomicInc();
+    return p;
+}
+
+void SharingProfiler::consume(LineProfile* p, uint32_t child) {
+    uint64_t bit = 1ul << child;
+    if (p->lastWriter != NONE && !(p->consumers & bit)) {
+        profTransfers.atomicInc(p->lastWriter*tracked + child);
+        p->consumers |= bit;
+    }
+}
+
+void SharingProfiler::write(LineProfile* p, uint32_t child) {
+    if (p->lastWriter != NONE && p->lastWriter != child && p->lastReader == child) p->migratoryWrites++;
+    p->children |= 1ul << child;
+    p->writers |= 1ul << child;
+    p->writes++;
+    p->lastWriter = child;
+    p->consumers = 1ul << child;
+}
+
+void SharingProfiler::access(Address lineAddr, uint32_t lineId, AccessType type, uint32_t childId) {
+    LineProfile* p = profile(lineAddr, lineId);
+    if (!p) return;
+    uint32_t child = childId % MAX_TRACKED;
+    switch (type) {
+        case GETS:
+            consume(p, child);
+            p->children |= 1ul << child;
+            p->lastReader = child;
+            break;
+        case GETX:
+            if (p->lastWriter != child) consume(p, child);
+            write(p, child);
+            break;
+        case PUTX:
+            // Dirty writeback; the write may have been silent (E->M), so record it unless we already have
+            if (p->lastWriter != child) write(p, child);
+            break;
+        case PUTS:
+            break;
+        default: panic("!?");
+    }
+}
+
+void SharingProfiler::ownerWrite(Address lineAddr, uint32_t lineId, uint32_t ownerId) {
+    LineProfile* p = profile(lineAddr, lineId);
+    uint32_t owner = ownerId % MAX_TRACKED;
+    if (p && p->lastWriter != owner) write(p, owner);
+}
+
+void SharingProfiler::evict(uint32_t lineId) {
+    LineProfile* p = &lines[lineId];
+    if (!p->active) return;
+    __sync_fetch_and_add(&finishedLines[classify(p)], 1);
+    p->active = false;
+}
+
+SharingProfiler::LineClass SharingProfiler::classify(const LineProfile* p) const {
+    if (__builtin_popcountl(p->children) <= 1) return PRIVATE;
+    if (!p->writes) return READ_SHARED;
+    // Migratory if at least half of the writes after the first move the line to its last reader
+    if (__builtin_popcountl(p->writers) > 1 && 2*p->migratoryWrites >= p->writes - 1) return MIGRATORY;
+    return WRITE_SHARED;
+}
+
+uint64_t SharingProfiler::classCount(LineClass c) const {
+    uint64_t count = finishedLines[c];
+    for (uint32_t l = 0; l < numLines; l++) {
+        if (lines[l].active && classify(&lines[l]) == c) count++;
+    }
+    return count;
+}
@@ -0,0 +1,115 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SHARING_PROFILER_H_
+#define SHARING_PROFILER_H_
+
+#include "g_std/g_string.h"
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "memory_hierarchy.h"
+#include "stats.h"
+
+/* Sampled inter-thread sharing profiler for a MESITopCC
+ * (sys.caches.<group>.profileSharing = N, usually on the LLC).
+ *
+ * Follows 1 in N lines (picked by address) through each lifetime in the
+ * cache, from first access to eviction, and classifies the lifetime by the
+ * children (the private caches below, i.e., cores) that touched it:
+ *  - private: a single child
+ *  - read-shared: several children, never written
+ *  - migratory: several writers, most writes upgrades by the child that read
+ *    the line last (e.g., lock-protected data)
+ *  - write-shared: all other written lines
+ * Lines still cached when stats are dumped count as of then. Writes are seen
+ * as GETXs, dirty writebacks, and dirty data returned by downgrades. Children
+ * above 63 alias (mod 64).
+ *
+ * It also counts producer->consumer transfers of sampled lines: a child
+ * getting a line last written by another child, once per write and consumer.
+ * Coherence-induced traffic (invalidations and downgrades caused by accesses,
+ * and the dirty writebacks they force) is counted for all lines. Use periodic
+ * stats (sim.periodicStatsPhase) for per-phase numbers.
+ *
+ * Line state is only touched with the cache's lock for the line held; with
+ * striped locks (see CCLocks), counters are shared across stripes, so they
+ * are updated atomically.
+ */
+class SharingProfiler : public GlobAlloc {
+    private:
+        static const uint32_t MAX_TRACKED = 64;
+        static const uint32_t NONE = -1u;
+
+        struct LineProfile {
+            Address lineAddr;
+            uint64_t children;   // children that accessed the line
+            uint64_t writers;    // children that wrote it
+            uint64_t consumers;  // children that have the last write, incl. its writer
+            uint32_t lastWriter, lastReader;
+            uint32_t writes, migratoryWrites;
+            bool active;
+        };
+
+        enum LineClass {PRIVATE, READ_SHARED, WRITE_SHARED, MIGRATORY, NUM_CLASSES};
+
+        LineProfile* lines;  // indexed by lineId
+        const uint32_t numLines;
+        const uint32_t tracked;  // min(children, MAX_TRACKED)
+        const uint32_t samplingRate;
+        const g_string name;
+
+        uint64_t finishedLines[NUM_CLASSES];
+        Counter profSampledLines;
+        VectorCounter profTransfers;  // producer * tracked + consumer
+        Counter profCohInvs, profCohDowngrades, profCohWritebacks;
+
+    public:
+        SharingProfiler(uint32_t _numLines, uint32_t _children, uint32_t _samplingRate, const g_string& _name);
+
+        void initStats(AggregateStat* parentStat);
+
+        // Access from child, after the sharer set is updated
+        void access(Address lineAddr, uint32_t lineId, AccessType type, uint32_t childId);
+        // The child holding the line exclusively returned dirty data (downgrade/invalidate)
+        void ownerWrite(Address lineAddr, uint32_t lineId, uint32_t ownerId);
+        void evict(uint32_t lineId);
+
+        // Invalidations or downgrades sent to satisfy an access
+        void coherenceMsgs(InvType type, uint32_t msgs, bool writeback) {
+            if (type == INV) profCohInvs.atomicInc(msgs);
+            else profCohDowngrades.atomicInc(msgs);
+            if (writeback) profCohWritebacks.atomicInc();
+        }
+
+    private:
+        LineProfile* profile(Address lineAddr, uint32_t lineId);
+        void write(LineProfile* p, uint32_t child);
+        void consume(LineProfile* p, uint32_t child);
+        LineClass classify(const LineProfile* p) const;
+        uint64_t classCount(LineClass c) const;
+};
+
+#endif  // SHARING_PROFILER_H_
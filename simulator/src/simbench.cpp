@@ -0,0 +1,468 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmarks for the simulator's own hot paths, without Pin. Each kernel
+ * runs on synthetic line address streams (stream, random, strided and
+ * pointer-chase) and reports ns/op and allocations/op, so that performance
+ * changes come with reproducible before/after numbers:
+ *  - array: SetAssoc and Z arrays with each replacement policy. Op = lookup,
+ *    plus a fill on a miss.
+ *  - h3: H3HashFamily. Op = one hash.
+ *  - filter: loads and stores (3:1) from one core, with 32KB FilterCache L1s
+ *    under a 1MB L2 and fixed-latency memory. Op = one load or store.
+ *  - inval: MESITopCC invalidations. Op = loads from N-1 L1s to a line,
+ *    then a store from another L1 that invalidates them.
+ *  - pq: PrioQueue scheduling with 1K events in flight, with short, mixed
+ *    and far (beyond the queue's blocks) delays. Op = dequeue + enqueue.
+ *  - ramulator: RamulatorWrapper send/tick/callback from one CPU. Op = one
+ *    request (3:1 reads:writes), with the ticks it takes to drain.
+ *  - hdf5: buffered HDF5Backend dumps of a 16-core stats tree. Op = one dump.
+ *
+ * Usage: simbench [ops (default 1M)] [kernel (default all)] [ramulator config]
+ * Run ramulator with a config, e.g., ramulator-configs/DDR4-config.cfg.
+ *
+ * Allocations are counted on the gm_* heap and global operator new. This
+ * covers the simulator and Ramulator, but not libhdf5. Here the gm_* heap is
+ * backed by malloc, so the benchmark needs no shared memory segment.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <new>
+#include "cache.h"
+#include "cache_arrays.h"
+#include "coherence_ctrls.h"
+#include "contention_sim.h"
+#include "filter_cache.h"
+#include "galloc.h"
+#include "hash.h"
+#include "log.h"
+#include "mtrand.h"
+#include "prio_queue.h"
+#include "repl_policies.h"
+#include "stats.h"
+#include "zsim.h"
+
+#ifdef _WITH_RAMULATOR_
+#include "RamulatorWrapper.h"
+#include "Request.h"
+#endif
+
+// What the simulator's process-local globals would be
+GlobSimInfo* zinfo;
+uint32_t lineBits = 6;
+uint64_t procMask = 0;
+
+// There are no event recorders, so caches never create weave-phase events
+void ContentionSim::enqueue(TimingEvent* ev, uint64_t cycle) {panic("No weave phase in simbench");}
+void ContentionSim::enqueueSynced(TimingEvent* ev, uint64_t cycle) {panic("No weave phase in simbench");}
+void ContentionSim::enqueueCrossing(CrossingEvent* ev, uint64_t cycle, uint32_t srcId, uint32_t srcDomain, uint32_t dstDomain, EventRecorder* evRec) {
+    panic("No weave phase in simbench");
+}
+
+/* Allocation counting */
+
+static uint64_t allocs = 0;
+
+void* gm_malloc(size_t size) {
+    allocs++;
+    void* ptr = malloc(size);
+    if (!ptr) panic("gm_malloc(): Out of memory");
+    return ptr;
+}
+
+void* __gm_calloc(size_t num, size_t size) {
+    allocs++;
+    void* ptr = calloc(num, size);
+    if (!ptr) panic("gm_calloc(): Out of memory");
+    return ptr;
+}
+
+void* __gm_memalign(size_t blocksize, size_t bytes) {
+    allocs++;
+    void* ptr;
+    if (posix_memalign(&ptr, blocksize, bytes)) panic("gm_memalign(): Out of memory");
+    return ptr;
+}
+
+void gm_free(void* ptr) {free(ptr);}
+
+char* gm_strdup(const char* str) {
+    allocs++;
+    return strdup(str);
+}
+
+void* operator new(size_t size) {
+    allocs++;
+    void* ptr = malloc(size? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {free(ptr);}
+
+/* Address streams */
+
+enum StreamKind {STREAM, RANDOM, STRIDED, CHASE, NUM_STREAMS};
+static const char* streamNames[] = {"stream", "random", "strided", "chase"};
+
+class AddrStream {
+    private:
+        const StreamKind kind;
+        const uint32_t footprint;  // lines
+        MTRand rnd;
+        uint64_t i;
+        uint32_t* chase;  // single-cycle random permutation
+        uint32_t cur;
+
+    public:
+        AddrStream(StreamKind _kind, uint32_t _footprint) : kind(_kind), footprint(_footprint), rnd(42 + _kind), i(0), chase(nullptr), cur(0) {
+            if (kind == CHASE) {
+                // Sattolo's algorithm: visits every line once, in random order, before repeating
+                chase = gm_calloc<uint32_t>(footprint);
+                for (uint32_t l = 0; l < footprint; l++) chase[l] = l;
+                for (uint32_t l = footprint - 1; l > 0; l--) std::swap(chase[l], chase[rnd.randInt(l - 1)]);
+            }
+        }
+
+        ~AddrStream() {if (chase) gm_free(chase);}
+
+        inline Address next() {
+            switch (kind) {
+                case STREAM: return 1 + (i++ % footprint);
+                case RANDOM: return 1 + rnd.randInt(footprint - 1);
+                case STRIDED: return 1 + ((i++ * 67) % footprint);  // 67 lines, ~4KB
+                default: cur = chase[cur]; return 1 + cur;
+            }
+        }
+};
+
+/* Timing */
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+// Runs op(i) ops times after ops/4 warm-up calls, and reports ns/op and allocations/op
+template <typename F>
+static void run(const char* kernel, const char* config, const char* stream, uint64_t ops, F op) {
+    for (uint64_t i = 0; i < ops/4; i++) op(i);
+    uint64_t startAllocs = allocs;
+    double start = now();
+    for (uint64_t i = 0; i < ops; i++) op(i);
+    double ns = (now() - start)/ops;
+    info("%-10s %-18s %-8s %10.2f %10.4f", kernel, config, stream, ns, ((double)(allocs - startAllocs))/ops);
+}
+
+/* Memory hierarchy components */
+
+// Just what replacement policies need from a coherence controller: lines are valid once filled
+class FillCC : public CC {
+    private:
+        bool* valid;
+
+    public:
+        explicit FillCC(uint32_t numLines) {valid = gm_calloc<bool>(numLines);}
+        void fill(uint32_t lineId) {valid[lineId] = true;}
+
+        void setParents(uint32_t childId, const g_vector<MemObject*>& parents, Network* network) {}
+        void setChildren(const g_vector<BaseCache*>& children, Network* network) {}
+        void initStats(AggregateStat* cacheStat) {}
+        bool startAccess(MemReq& req) {return false;}
+        bool shouldAllocate(const MemReq& req) {return true;}
+        uint64_t processEviction(const MemReq& triggerReq, Address wbLineAddr, int32_t lineId, uint64_t startCycle) {return startCycle;}
+        uint64_t processAccess(const MemReq& req, int32_t lineId, uint64_t startCycle, uint64_t* getDoneCycle = nullptr) {return startCycle;}
+        void endAccess(const MemReq& req) {}
+        void startInv(Address lineAddr) {}
+        uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) {return startCycle;}
+        uint32_t numSharers(uint32_t lineId) {return 0;}
+        bool isValid(uint32_t lineId) {return valid[lineId];}
+};
+
+// Fixed-latency memory, as SimpleMemory
+class BenchMemory : public MemObject {
+    private:
+        g_string name;
+        uint32_t latency;
+
+    public:
+        explicit BenchMemory(uint32_t _latency) : name("mem"), latency(_latency) {}
+        const char* getName() {return name.c_str();}
+
+        uint64_t access(MemReq& req) {
+            switch (req.type) {
+                case PUTS:
+                case PUTX:
+                    *req.state = I;
+                    break;
+                case GETS:
+                    *req.state = req.is(MemReq::NOEXCL)? S : E;
+                    break;
+                case GETX:
+                    *req.state = M;
+                    break;
+                default: panic("!?");
+            }
+            return req.cycle + latency;
+        }
+};
+
+// cores 32KB 8-way L1s under a 1MB 16-way L2 (LRU, H3-hashed), under fixed-latency memory
+static g_vector<FilterCache*> buildHierarchy(uint32_t cores) {
+    BenchMemory* mem = new BenchMemory(100);
+    uint32_t l2Lines = (1 << 20)/64;
+    LRUReplPolicy<true>* l2Rp = new LRUReplPolicy<true>(l2Lines);
+    SetAssocArray* l2Array = new SetAssocArray(l2Lines, 16, l2Rp, new H3HashFamily(1, ilog2(l2Lines/16), 0xF000BAAA));
+    g_string l2Name("l2");
+    MESICC* l2Cc = new MESICC(l2Lines, false /*nonInclusiveHack*/, false /*bypass*/, l2Name);
+    l2Rp->setCC(l2Cc);
+    Cache* l2 = new Cache(l2Lines, l2Cc, l2Array, l2Rp, 10, 10, false, l2Name);
+    g_vector<MemObject*> mems = {mem};
+    l2->setParents(0, mems, nullptr);
+
+    g_vector<FilterCache*> l1s;
+    g_vector<BaseCache*> children;
+    g_vector<MemObject*> parents = {l2};
+    uint32_t l1Lines = (32 << 10)/64;
+    for (uint32_t c = 0; c < cores; c++) {
+        g_string name(("l1-" + std::to_string(c)).c_str());
+        LRUReplPolicy<true>* rp = new LRUReplPolicy<true>(l1Lines);
+        SetAssocArray* array = new SetAssocArray(l1Lines, 8, rp, new IdHashFamily());
+        MESITerminalCC* cc = new MESITerminalCC(l1Lines, false /*bypass*/, name);
+        rp->setCC(cc);
+        FilterCache* l1 = new FilterCache(l1Lines/8, l1Lines, cc, array, rp, 4, 4, false, name);
+        l1->setSourceId(c);
+        l1->setParents(c, parents, nullptr);
+        l1s.push_back(l1);
+        children.push_back(l1);
+    }
+    l2->setChildren(children, nullptr);
+    return l1s;
+}
+
+/* Kernels */
+
+static void benchArrays(uint64_t ops) {
+    const uint32_t numLines = 1 << 15;  // 2MB
+    const char* configs[] = {"SetAssoc16/LRU", "SetAssoc16/TreeLRU", "SetAssoc16/NRU", "SetAssoc16/Rand", "SetAssoc16/LFU", "Z4/52/LRU"};
+    for (uint32_t cfg = 0; cfg < sizeof(configs)/sizeof(configs[0]); cfg++) {
+        for (uint32_t s = 0; s < NUM_STREAMS; s++) {
+            ReplPolicy* rp;
+            switch (cfg) {
+                case 0: case 5: rp = new LRUReplPolicy<true>(numLines); break;
+                case 1: rp = new TreeLRUReplPolicy(numLines, 16); break;
+                case 2: rp = new NRUReplPolicy(numLines, 16); break;
+                case 3: rp = new RandReplPolicy(16); break;
+                default: rp = new LFUReplPolicy(numLines);
+            }
+            FillCC* cc = new FillCC(numLines);
+            rp->setCC(cc);
+            CacheArray* array = (cfg == 5)? (CacheArray*) new ZArray(numLines, 4, 52, rp, new H3HashFamily(4, ilog2(numLines/4), 0xCAC7EAFFA1)) :
+                (CacheArray*) new SetAssocArray(numLines, 16, rp, new H3HashFamily(1, ilog2(numLines/16), 0xCAC7EAFFA1));
+            AddrStream stream((StreamKind)s, numLines + numLines/2);  // 1.5x the array, so there are hits and misses
+            MESIState state = I;
+            run("array", configs[cfg], streamNames[s], ops, [&](uint64_t i) {
+                Address lineAddr = stream.next();
+                MemReq req = {lineAddr, GETS, 0, &state, i, nullptr, I, 0, 0, 0};
+                if (array->lookup(lineAddr, &req, true) == -1) {
+                    Address wbLineAddr;
+                    uint32_t id = array->preinsert(lineAddr, &req, &wbLineAddr);
+                    array->postinsert(lineAddr, &req, id);
+                    cc->fill(id);
+                }
+            });
+        }
+    }
+}
+
+static void benchH3(uint64_t ops) {
+    H3HashFamily* hf = new H3HashFamily(1, 12, 0xCAC7EAFFA1);
+    uint64_t sink = 0;
+    for (uint32_t s = 0; s < NUM_STREAMS; s++) {
+        AddrStream stream((StreamKind)s, 1 << 20);
+        run("h3", "1x12b", streamNames[s], ops, [&](uint64_t i) {sink += hf->hash(0, stream.next() ^ (sink & 1));});
+    }
+    if (sink == 42) info("Lucky you");  // keeps the hashes live
+}
+
+static void benchFilterCache(uint64_t ops) {
+    g_vector<FilterCache*> l1s = buildHierarchy(1);
+    for (uint32_t s = 0; s < NUM_STREAMS; s++) {
+        AddrStream stream((StreamKind)s, (2 << 20)/64);  // 2MB, so there are L1 and L2 hits and misses
+        run("filter", "32KB/1MB", streamNames[s], ops, [&](uint64_t i) {
+            Address vAddr = stream.next() << lineBits;
+            if (i % 4 == 3) l1s[0]->store(vAddr, i);
+            else l1s[0]->load(vAddr, i);
+        });
+    }
+}
+
+static void benchInvalidations(uint64_t ops) {
+    const uint32_t cores = 16;
+    g_vector<FilterCache*> l1s = buildHierarchy(cores);
+    const uint32_t sharerCounts[] = {2, 8, 16};
+    for (uint32_t sharers : sharerCounts) {
+        char config[32];
+        snprintf(config, sizeof(config), "%d sharers", sharers);
+        for (uint32_t s = 0; s < NUM_STREAMS; s++) {
+            AddrStream stream((StreamKind)s, (512 << 10)/64);  // fits in the L2
+            run("inval", config, streamNames[s], ops/sharers, [&](uint64_t i) {
+                Address vAddr = stream.next() << lineBits;
+                for (uint32_t c = 1; c < sharers; c++) l1s[c]->load(vAddr, i);
+                l1s[0]->store(vAddr, i);
+            });
+        }
+    }
+}
+
+struct BenchEvent {
+    BenchEvent* next;
+    BenchEvent() : next(nullptr) {}
+};
+
+static void benchPrioQueue(uint64_t ops) {
+    const uint32_t inFlight = 1024;
+    const char* delayNames[] = {"short", "mixed", "far"};
+    const uint32_t maxDelays[] = {64, 512, 1 << 17};  // far delays go past the queue's 1024 blocks (64K cycles)
+    BenchEvent* events = new BenchEvent[inFlight];
+    for (uint32_t d = 0; d < 3; d++) {
+        PrioQueue<BenchEvent, 1024>* pq = new PrioQueue<BenchEvent, 1024>();
+        MTRand rnd(42 + d);
+        for (uint32_t e = 0; e < inFlight; e++) pq->enqueue(&events[e], 1 + rnd.randInt(maxDelays[d] - 1));
+        run("pq", "1K in flight", delayNames[d], ops, [&](uint64_t i) {
+            uint64_t cycle;
+            BenchEvent* ev = pq->dequeue(cycle);
+            pq->enqueue(ev, cycle + 1 + rnd.randInt(maxDelays[d] - 1));
+        });
+        while (pq->size()) {
+            uint64_t cycle;
+            pq->dequeue(cycle);
+        }
+        delete pq;
+    }
+    delete[] events;
+}
+
+#ifdef _WITH_RAMULATOR_
+static void benchRamulator(uint64_t ops, const char* configFile) {
+    if (!configFile) {
+        info("ramulator: no config given, skipping");
+        return;
+    }
+    if (access(configFile, R_OK)) panic("Can't read Ramulator config %s", configFile);
+    const char* configName = strrchr(configFile, '/')? strrchr(configFile, '/') + 1 : configFile;
+    for (uint32_t s = 0; s < NUM_STREAMS; s++) {
+        ramulator::RamulatorWrapper* wrapper = new ramulator::RamulatorWrapper(configFile, 1, 64, false, false, "simbench", false);
+        uint64_t sent = 0, done = 0;
+        auto cb = [&done](ramulator::Request& req) {done++;};
+        AddrStream stream((StreamKind)s, (256 << 20)/64);
+        double ticks = 0;
+        run("ramulator", configName, streamNames[s], ops, [&](uint64_t i) {
+            bool write = (i % 4 == 3);
+            ramulator::Request req((long)(stream.next() << lineBits), write? ramulator::Request::Type::WRITE : ramulator::Request::Type::READ, cb, 0);
+            while (!wrapper->send(req)) {wrapper->tick(); ticks++;}
+            if (!write) sent++;
+            wrapper->tick();
+            ticks++;
+            // Drain at the end of each pass, so its cost is counted
+            if (i == ops/4 - 1 || i == ops - 1) {
+                while (done < sent) {wrapper->tick(); ticks++;}
+            }
+        });
+        info("ramulator: %.2f ticks/op", ticks/(ops + ops/4));
+        delete wrapper;
+    }
+}
+#endif
+
+static void benchHDF5(uint64_t ops) {
+    // Roughly what 16 cores with private L1s/L2s, a banked L3 and a memory controller dump
+    AggregateStat* root = new AggregateStat();
+    root->init("root", "Stats");
+    g_vector<Counter*> counters;
+    const char* groups[] = {"core", "l1d", "l1i", "l2", "l3"};
+    for (const char* group : groups) {
+        AggregateStat* groupStat = new AggregateStat(true /*regular*/);
+        groupStat->init(group, "Group");
+        for (uint32_t b = 0; b < 16; b++) {
+            AggregateStat* bankStat = new AggregateStat();
+            bankStat->init(gm_strdup((std::string(group) + "-" + std::to_string(b)).c_str()), "Bank");
+            for (uint32_t c = 0; c < 24; c++) {
+                Counter* ctr = new Counter();
+                ctr->init(gm_strdup(("c" + std::to_string(c)).c_str()), "Counter");
+                bankStat->append(ctr);
+                counters.push_back(ctr);
+            }
+            VectorCounter* hist = new VectorCounter();
+            hist->init("hist", "Histogram", 32);
+            bankStat->append(hist);
+            groupStat->append(bankStat);
+        }
+        root->append(groupStat);
+    }
+    root->makeImmutable();
+
+    char file[] = "/tmp/simbench-XXXXXX";
+    int fd = mkstemp(file);
+    if (fd == -1) panic("Can't create a temporary stats file");
+    close(fd);
+    HDF5Backend* backend = new HDF5Backend(file, root, 1 << 20, false, true);
+    run("hdf5", "16 cores", "-", ops, [&](uint64_t i) {
+        counters[i % counters.size()]->inc();
+        backend->dump(true);
+    });
+    unlink(file);
+}
+
+int main(int argc, char *argv[]) {
+    InitLog("[B] ");
+    uint64_t ops = (argc > 1)? atol(argv[1]) : 1000000;
+    const char* kernel = (argc > 2)? argv[2] : "all";
+    zinfo = gm_calloc<GlobSimInfo>();
+    zinfo->numCores = 16;
+    zinfo->lineSize = 64;
+    zinfo->eventRecorders = gm_calloc<EventRecorder*>(zinfo->numCores);  // no weave phase
+
+    auto selected = [kernel](const char* k) {return !strcmp(kernel, "all") || !strcmp(kernel, k);};
+    info("%-10s %-18s %-8s %10s %10s", "kernel", "config", "stream", "ns/op", "allocs/op");
+    if (selected("array")) benchArrays(ops);
+    if (selected("h3")) benchH3(ops);
+    if (selected("filter")) benchFilterCache(ops);
+    if (selected("inval")) benchInvalidations(ops);
+    if (selected("pq")) benchPrioQueue(ops);
+#ifdef _WITH_RAMULATOR_
+    const char* ramulatorConfig = (argc > 3)? argv[3] : nullptr;
+    if (selected("ramulator")) benchRamulator(ops/10, ramulatorConfig);
+#else
+    if (!strcmp(kernel, "ramulator")) info("Skipping ramulator, built without Ramulator");
+#endif
+    if (selected("hdf5")) benchHDF5(ops/1000);
+    return 0;
+}
@@ -43,7 +43,7 @@ void SimpleCore::initStats(AggregateStat* parentStat) {
 }
 
 uint64_t SimpleCore::getPhaseCycles() const {
-    return curCycle % zinfo->phaseLength;
+    return curCycle - zinfo->globPhaseCycles;
 }
 
 void SimpleCore::OffloadBegin(THREADID tid) {
@@ -95,7 +95,15 @@ void SimpleCore::join() {
 
 //Static class functions: Function pointers and trampolines
 InstrFuncPtrs SimpleCore::GetFuncPtrs() {
-    return {LoadFunc, StoreFunc, BblFunc, BranchFunc, PredLoadFunc, PredStoreFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, {0}};
+    return {LoadFunc, StoreFunc, BblFunc, BranchFunc, PredLoadFunc, PredStoreFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, MemBatchFunc};
+}
+
+void SimpleCore::MemBatchFunc(THREADID tid, const BufferedAccess* accs, UINT32 n) {
+    SimpleCore* core = static_cast<SimpleCore*>(cores[tid]);
+    for (UINT32 i = 0; i < n; i++) {
+        if (accs[i].isStore) core->store(accs[i].addr, accs[i].size);
+        else core->load(accs[i].addr, accs[i].size);
+    }
 }
 
 void SimpleCore::LoadFunc(THREADID tid, ADDRINT addr, UINT32 size) {
@@ -120,7 +128,7 @@ void SimpleCore::BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
 
     while (core->curCycle > core->phaseEndCycle) {
         assert(core->phaseEndCycle == zinfo->globPhaseCycles + zinfo->phaseLength);
-        core->phaseEndCycle += zinfo->phaseLength;
+        core->phaseEndCycle += zinfo->nextPhaseLength;
 
         uint32_t cid = getCid(tid);
         //NOTE: TakeBarrier may take ownership of the core, and so it will be used by some other thread. If TakeBarrier context-switches us,
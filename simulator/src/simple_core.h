@@ -72,6 +72,7 @@ class SimpleCore : public Core {
         static void OffloadBegin(THREADID tid);
         static void OffloadEnd(THREADID tid);
 
+        static void MemBatchFunc(THREADID tid, const BufferedAccess* accs, UINT32 n);
         static void LoadFunc(THREADID tid, ADDRINT addr, UINT32 size);
         static void StoreFunc(THREADID tid, ADDRINT addr, UINT32 size);
         static void BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo);
@@ -0,0 +1,164 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synthetic_core.h"
+#include <algorithm>
+#include <string.h>
+#include "filter_cache.h"
+#include "zsim.h"
+
+SyntheticCore::SyntheticCore(FilterCache* _l1d, uint32_t domain, Pattern _pattern, Address _base, uint64_t _footprint, uint64_t _stride,
+        double _writeRatio, uint32_t _mlp, uint32_t _issueCycles, uint64_t _maxAccesses, uint64_t seed, g_string& _name)
+    : Core(_name), l1d(_l1d), pattern(_pattern), base(_base), footprint(_footprint), stride(_stride), writeRatio(_writeRatio),
+      mlp(_mlp), issueCycles(_issueCycles), maxAccesses(_maxAccesses), rnd(seed), pos(0), curCycle(0), phaseEndCycle(0),
+      respCycles(_mlp, 0), respHead(0), lastRespCycle(0), done(false), instrs(0), cRec(domain, _name)
+{
+    uint64_t lines = footprint >> lineBits;
+    if (lines == 0 || footprint % zinfo->lineSize) panic("[%s] footprint must be a non-zero multiple of the line size", name.c_str());
+    if (mlp == 0) panic("[%s] mlp must be > 0", name.c_str());
+    if (writeRatio < 0.0 || writeRatio > 1.0) panic("[%s] writeRatio must be in [0, 1]", name.c_str());
+
+    if (pattern == CHASE) {
+        // Sattolo's algorithm: a random permutation with a single cycle
+        if (lines > UINT32_MAX) panic("[%s] Chase footprint is too large", name.c_str());
+        chase.resize(lines);
+        for (uint32_t l = 0; l < lines; l++) chase[l] = l;
+        for (uint32_t l = lines - 1; l > 0; l--) std::swap(chase[l], chase[rnd.randInt(l - 1)]);
+    }
+}
+
+SyntheticCore::Pattern SyntheticCore::parsePattern(const char* str) {
+    if (strcmp(str, "Sequential") == 0) return SEQUENTIAL;
+    if (strcmp(str, "Strided") == 0) return STRIDED;
+    if (strcmp(str, "Random") == 0) return RANDOM;
+    if (strcmp(str, "Gather") == 0) return GATHER;
+    if (strcmp(str, "Chase") == 0) return CHASE;
+    panic("Invalid synthetic pattern %s", str);
+}
+
+uint64_t SyntheticCore::getPhaseCycles() const {
+    return curCycle - zinfo->globPhaseCycles;
+}
+
+void SyntheticCore::initStats(AggregateStat* parentStat) {
+    AggregateStat* coreStat = new AggregateStat();
+    coreStat->init(name.c_str(), "Core stats");
+
+    auto x = [this]() { return cRec.getUnhaltedCycles(curCycle); };
+    LambdaStat<decltype(x)>* cyclesStat = new LambdaStat<decltype(x)>(x);
+    cyclesStat->init("cycles", "Simulated unhalted cycles");
+    coreStat->append(cyclesStat);
+
+    auto y = [this]() { return cRec.getContentionCycles(); };
+    LambdaStat<decltype(y)>* cCyclesStat = new LambdaStat<decltype(y)>(y);
+    cCyclesStat->init("cCycles", "Cycles due to contention stalls");
+    coreStat->append(cCyclesStat);
+
+    ProxyStat* instrsStat = new ProxyStat();
+    instrsStat->init("instrs", "Simulated instructions (accesses issued)", &instrs);
+    coreStat->append(instrsStat);
+
+    profLoads.init("loads", "Loads issued"); coreStat->append(&profLoads);
+    profStores.init("stores", "Stores issued"); coreStat->append(&profStores);
+    profBoundLat.init("boundLat", "Total contention-free access latency"); coreStat->append(&profBoundLat);
+
+    parentStat->append(coreStat);
+}
+
+void SyntheticCore::join() {
+    curCycle = cRec.notifyJoin(curCycle);
+    phaseEndCycle = zinfo->globPhaseCycles + zinfo->phaseLength;
+}
+
+void SyntheticCore::leave() {
+    cRec.notifyLeave(curCycle);
+}
+
+InstrFuncPtrs SyntheticCore::GetFuncPtrs() {
+    panic("[%s] Synthetic cores can't run application threads", name.c_str());
+}
+
+bool SyntheticCore::runPhase() {
+    if (done) return false;
+    while (curCycle <= phaseEndCycle) {
+        if (maxAccesses && instrs >= maxAccesses) {
+            done = true;
+            leave();
+            return false;
+        }
+        issue();
+    }
+    phaseEndCycle += zinfo->nextPhaseLength;
+    return true;
+}
+
+void SyntheticCore::issue() {
+    Address addr;
+    bool dependent = false;
+    bool isStore = false;
+    switch (pattern) {
+        case SEQUENTIAL:
+            addr = base + (pos*8) % footprint;
+            break;
+        case STRIDED:
+            addr = base + (pos*stride) % footprint;
+            break;
+        case RANDOM:
+            addr = base + rnd.randInt((footprint >> 3) - 1)*8;
+            break;
+        case GATHER:
+            if (pos & 1) {
+                addr = base + rnd.randInt((footprint >> 3) - 1)*8;
+                dependent = true;
+            } else {
+                // Index array, right after the data
+                addr = base + footprint + (pos/2*8) % footprint;
+            }
+            break;
+        case CHASE:
+        default:
+            pos = chase[pos];
+            addr = base + (pos << lineBits);
+            dependent = true;
+    }
+    if (pattern != CHASE) pos++;
+    if (writeRatio > 0.0 && (pattern != GATHER || dependent)) isStore = rnd.randDblExc() < writeRatio;
+
+    // Wait for a free slot, i.e., for the access issued mlp accesses ago
+    uint64_t dispatchCycle = MAX(curCycle, respCycles[respHead]);
+    if (dependent) dispatchCycle = MAX(dispatchCycle, lastRespCycle);
+    uint64_t respCycle = isStore? l1d->store(addr, dispatchCycle) : l1d->load(addr, dispatchCycle);
+    cRec.record(curCycle, dispatchCycle, respCycle);
+
+    respCycles[respHead] = respCycle;
+    respHead = (respHead + 1) % mlp;
+    lastRespCycle = respCycle;
+    curCycle = dispatchCycle + issueCycles;
+
+    instrs++;
+    if (isStore) profStores.inc();
+    else profLoads.inc();
+    profBoundLat.inc(respCycle - dispatchCycle);
+}
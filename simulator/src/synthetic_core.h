@@ -0,0 +1,131 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTHETIC_CORE_H_
+#define SYNTHETIC_CORE_H_
+
+#include "core.h"
+#include "g_std/g_vector.h"
+#include "mtrand.h"
+#include "ooo_core_recorder.h"
+#include "pad.h"
+
+class FilterCache;
+
+/* A traffic generator core for memory-system studies without an application.
+ *
+ * Each core issues a parameterized stream of loads and stores through its
+ * dcache (sys.cores.X.type = "Synthetic"):
+ *  - pattern: Sequential (8-byte words), Strided (stride bytes apart), Random
+ *    (8-byte words), Gather (a sequential index read, then a dependent random
+ *    data access, as in A[B[i]]) or Chase (a dependent chain that visits
+ *    every line of the footprint once, in random order).
+ *  - footprint: bytes covered by the stream. Each core gets its own region,
+ *    unless shared = true.
+ *  - writeRatio: fraction of (data) accesses that are stores.
+ *  - mlp: maximum outstanding accesses. An access waits for the one issued
+ *    mlp accesses earlier to complete. Dependent accesses also wait for
+ *    their producer.
+ *  - issueCycles: cycles between consecutive issues, to sweep offered load.
+ *  - accesses: accesses to issue before the core stops (0 = until another
+ *    termination condition is met).
+ *
+ * Accesses count as instructions, so the sim.max*Instrs limits apply. Like
+ * OOO cores, synthetic cores record their accesses for the weave phase, so
+ * memory contention (e.g., in Ramulator) is reflected in their cycles.
+ *
+ * If all cores are synthetic, the simulation runs without an application:
+ * zsim runs the cores one after another on its main thread, phase by phase,
+ * and never starts process0 (whose command is ignored). Synthetic cores
+ * can't be mixed with other core types.
+ */
+class SyntheticCore : public Core {
+    public:
+        enum Pattern {SEQUENTIAL, STRIDED, RANDOM, GATHER, CHASE};
+
+    private:
+        FilterCache* l1d;
+
+        const Pattern pattern;
+        const Address base;
+        const uint64_t footprint;
+        const uint64_t stride;
+        const double writeRatio;
+        const uint32_t mlp;
+        const uint32_t issueCycles;
+        const uint64_t maxAccesses;
+
+        MTRand rnd;
+        uint64_t pos;  // index into the stream
+        g_vector<uint32_t> chase;  // Chase: next line of each line
+
+        uint64_t curCycle;  // phase 1 clock
+        uint64_t phaseEndCycle;
+        g_vector<uint64_t> respCycles;  // of the last mlp accesses, a circular buffer
+        uint32_t respHead;
+        uint64_t lastRespCycle;
+        bool done;
+
+        uint64_t instrs;  // accesses issued
+        Counter profLoads, profStores, profBoundLat;
+
+        OOOCoreRecorder cRec;
+
+    public:
+        SyntheticCore(FilterCache* _l1d, uint32_t domain, Pattern _pattern, Address _base, uint64_t _footprint, uint64_t _stride,
+                double _writeRatio, uint32_t _mlp, uint32_t _issueCycles, uint64_t _maxAccesses, uint64_t seed, g_string& _name);
+
+        static Pattern parsePattern(const char* str);
+
+        void offloadFunction_begin() {}
+        void offloadFunction_end() {}
+        int get_offload_code() {return 0;}
+
+        uint64_t getInstrs() const {return instrs;}
+        uint64_t getOffloadInstrs() const {return 0;}
+        uint64_t getPhaseCycles() const;
+        uint64_t getCycles() const {return cRec.getUnhaltedCycles(curCycle);}
+
+        void initStats(AggregateStat* parentStat);
+        void contextSwitch(int32_t gid) {}
+        void join();
+        void leave();
+
+        InstrFuncPtrs GetFuncPtrs();
+
+        // Issues accesses until the end of the current phase. Returns false
+        // once the core has issued all its accesses.
+        bool runPhase();
+
+        //Contention simulation interface
+        inline EventRecorder* getEventRecorder() {return cRec.getEventRecorder();}
+        void cSimStart() {curCycle = cRec.cSimStart(curCycle);}
+        void cSimEnd() {curCycle = cRec.cSimEnd(curCycle);}
+
+    private:
+        inline void issue();
+} ATTR_LINE_ALIGNED;
+
+#endif  // SYNTHETIC_CORE_H_
@@ -24,6 +24,7 @@
  */
 
 #include "timing_cache.h"
+#include "hash.h"
 #include "event_recorder.h"
 #include "timing_event.h"
 #include "zsim.h"
@@ -110,8 +111,14 @@ void TimingCache::initStats(AggregateStat* parentStat) {
     parentStat->append(cacheStat);
 }
 
-// TODO(dsm): This is copied verbatim from Cache. We should split Cache into different methods, then call those.
 uint64_t TimingCache::access(MemReq& req) {
+    return accessImpl(req, array, cc);
+}
+
+// TODO(dsm): This is copied verbatim from Cache. We should split Cache into different methods, then call those.
+// Templated like Cache::accessImpl, see StaticTimingCache
+template <typename A, typename C>
+uint64_t TimingCache::accessImpl(MemReq& req, A* array, C* cc) {
     EventRecorder* evRec = zinfo->eventRecorders[req.srcId];
     assert_msg(evRec, "TimingCache is not connected to TimingCore");
 
@@ -267,6 +274,24 @@ uint64_t TimingCache::access(MemReq& req) {
 }
 
 
+/* StaticTimingCache */
+
+template <typename A, typename C>
+uint64_t StaticTimingCache<A, C>::access(MemReq& req) {
+    return accessImpl(req, static_cast<A*>(array), static_cast<C*>(cc));
+}
+
+template <typename A, typename C>
+uint64_t StaticTimingCache<A, C>::invalidate(const InvReq& req) {
+    static_cast<C*>(cc)->startInv(req.lineAddr);
+    return finishInvalidateImpl(req, static_cast<A*>(array), static_cast<C*>(cc));
+}
+
+template class StaticTimingCache<StaticSetAssocArray<LRUReplPolicy<true>, IdHashFamily>, MESICC>;
+template class StaticTimingCache<StaticSetAssocArray<LRUReplPolicy<true>, H3HashFamily>, MESICC>;
+template class StaticTimingCache<StaticSetAssocArray<LRUReplPolicy<false>, IdHashFamily>, MESICC>;
+template class StaticTimingCache<StaticSetAssocArray<LRUReplPolicy<false>, H3HashFamily>, MESICC>;
+
 uint64_t TimingCache::highPrioAccess(uint64_t cycle) {
     assert(cycle >= lastFreeCycle);
     uint64_t lookupCycle = MAX(cycle, lastAccCycle+1);
@@ -52,10 +52,6 @@ class TimingCache : public Cache {
         // For zcache replacement simulation (pessimistic, assumes we walk the whole tree)
         uint32_t tagLat, ways, cands;
 
-        PAD();
-        lock_t topLock;
-        PAD();
-
     public:
         TimingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, uint32_t mshrs,
                 uint32_t tagLat, uint32_t ways, uint32_t cands, uint32_t _domain, bool bypass, const g_string& _name);
@@ -69,9 +65,26 @@ class TimingCache : public Cache {
         void simulateMissWriteback(MissWritebackEvent* ev, uint64_t cycle, MissStartEvent* mse);
         void simulateReplAccess(ReplAccessEvent* ev, uint64_t cycle);
 
+    protected:
+        template <typename A, typename C> uint64_t accessImpl(MemReq& req, A* array, C* cc);
+
     private:
         uint64_t highPrioAccess(uint64_t cycle);
         uint64_t tryLowPrioAccess(uint64_t cycle);
 };
 
+/* TimingCache with its array (A) and coherence controller (C) types fixed at compile time, as StaticCache.
+ * BuildCacheBank uses it for Timing caches with the same configurations. Instantiated in timing_cache.cpp.
+ */
+template <typename A, typename C>
+class StaticTimingCache final : public TimingCache {
+    public:
+        StaticTimingCache(uint32_t _numLines, C* _cc, A* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, uint32_t mshrs,
+                uint32_t tagLat, uint32_t ways, uint32_t cands, uint32_t _domain, bool bypass, const g_string& _name)
+            : TimingCache(_numLines, _cc, _array, _rp, _accLat, _invLat, mshrs, tagLat, ways, cands, _domain, bypass, _name) {}
+
+        uint64_t access(MemReq& req);
+        uint64_t invalidate(const InvReq& req);
+};
+
 #endif  // TIMING_CACHE_H_
@@ -34,7 +34,7 @@ TimingCore::TimingCore(FilterCache* _l1i, FilterCache* _l1d, uint32_t _domain, g
     : Core(_name), l1i(_l1i), l1d(_l1d), instrs(0), curCycle(0), cRec(_domain, _name) {}
 
 uint64_t TimingCore::getPhaseCycles() const {
-    return curCycle % zinfo->phaseLength;
+    return curCycle - zinfo->globPhaseCycles;
 }
 
 void TimingCore::initStats(AggregateStat* parentStat) {
@@ -126,7 +126,7 @@ void TimingCore::bblAndRecord(Address bblAddr, BblInfo* bblInfo) {
 
 
 InstrFuncPtrs TimingCore::GetFuncPtrs() {
-    return {LoadAndRecordFunc, StoreAndRecordFunc, BblAndRecordFunc, BranchFunc, PredLoadAndRecordFunc, PredStoreAndRecordFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, {0}};
+    return {LoadAndRecordFunc, StoreAndRecordFunc, BblAndRecordFunc, BranchFunc, PredLoadAndRecordFunc, PredStoreAndRecordFunc, OffloadBegin, OffloadEnd, FPTR_ANALYSIS, MemBatchFunc};
 }
 
 void TimingCore::OffloadBegin(THREADID tid) {
@@ -135,6 +135,14 @@ void TimingCore::OffloadBegin(THREADID tid) {
 void TimingCore::OffloadEnd(THREADID tid) {
     static_cast<TimingCore*>(cores[tid])->offloadFunction_end();
 }
+void TimingCore::MemBatchFunc(THREADID tid, const BufferedAccess* accs, UINT32 n) {
+    TimingCore* core = static_cast<TimingCore*>(cores[tid]);
+    for (UINT32 i = 0; i < n; i++) {
+        if (accs[i].isStore) core->storeAndRecord(accs[i].addr, accs[i].size);
+        else core->loadAndRecord(accs[i].addr, accs[i].size);
+    }
+}
+
 void TimingCore::LoadAndRecordFunc(THREADID tid, ADDRINT addr, UINT32 size) {
     static_cast<TimingCore*>(cores[tid])->loadAndRecord(addr, size);
 }
@@ -148,7 +156,7 @@ void TimingCore::BblAndRecordFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInf
     core->bblAndRecord(bblAddr, bblInfo);
 
     while (core->curCycle > core->phaseEndCycle) {
-        core->phaseEndCycle += zinfo->phaseLength;
+        core->phaseEndCycle += zinfo->nextPhaseLength;
         uint32_t cid = getCid(tid);
         uint32_t newCid = TakeBarrier(tid, cid);
         if (newCid != cid) break; /*context-switch*/
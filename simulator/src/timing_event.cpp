@@ -150,6 +150,7 @@ void CrossingEvent::simulate(uint64_t simCycle) {
         __sync_synchronize(); //not needed --- these are all volatile, and by TSO, if we see a cycle > doneCycle, by force we must see doneCycle set
         if (!called) { //have to check again, AFTER reading the cycles! Otherwise, we have a race
             zinfo->contentionSim->setPrio(domain, (nextCycle == simCycle)? 1 : 2);
+            zinfo->contentionSim->countStall(domain);
 
 #if PROFILE_CROSSINGS
             simCount++;
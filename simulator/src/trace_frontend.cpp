@@ -0,0 +1,190 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trace_frontend.h"
+#include <stddef.h>
+#include <string.h>
+#include "galloc.h"
+#include "log.h"
+#include "zsim.h"
+
+static const char TRACE_MAGIC[4] = {'Z', 'T', 'R', '1'};
+static const uint8_t TRACE_OOO_UOPS = 1;  // header flag: BblInfos carry oooBbl
+static const size_t TRACE_BUF_BYTES = 1 << 20;
+
+static inline uint64_t zigzag(int64_t v) {return (v << 1) ^ (v >> 63);}
+static inline int64_t unzigzag(uint64_t v) {return (v >> 1) ^ -(int64_t)(v & 1);}
+
+// Bytes of a decoded BblInfo (see Decoder::decodeBbl)
+static uint32_t bblInfoBytes(const BblInfo* bblInfo, bool oooUops) {
+    return oooUops? offsetof(BblInfo, oooBbl) + DynBbl::bytes(bblInfo->oooBbl[0].uops) : sizeof(BblInfo);
+}
+
+/* TraceWriter */
+
+TraceWriter::TraceWriter(const char* path) : lastDataAddr(0), lastPc(0) {
+    f = fopen(path, "w");
+    if (!f) panic("Could not open trace %s for writing", path);
+    setvbuf(f, nullptr, _IOFBF, TRACE_BUF_BYTES);
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), f);
+    putc_unlocked(zinfo->oooDecode? TRACE_OOO_UOPS : 0, f);
+}
+
+TraceWriter::~TraceWriter() {
+    putc_unlocked(TR_END, f);
+    fclose(f);
+}
+
+void TraceWriter::bbl(ADDRINT bblAddr, BblInfo* bblInfo) {
+    auto it = bblIds.find(bblInfo);
+    uint32_t id;
+    if (it == bblIds.end()) {
+        id = bblIds.size();
+        bblIds[bblInfo] = id;
+        uint32_t bytes = bblInfoBytes(bblInfo, zinfo->oooDecode);
+        putc_unlocked(TR_BBL_DEF, f);
+        putVarint(bblAddr);
+        putVarint(bytes);
+        fwrite(bblInfo, 1, bytes, f);
+    } else {
+        id = it->second;
+    }
+    putc_unlocked(TR_BBL, f);
+    putVarint(id);
+}
+
+void TraceWriter::access(RecordTag tag, ADDRINT addr, UINT32 size) {
+    putc_unlocked(tag, f);
+    putDelta(addr, lastDataAddr);
+    putVarint(size);
+}
+
+void TraceWriter::branch(ADDRINT pc, BOOL taken, ADDRINT takenNpc, ADDRINT notTakenNpc) {
+    putc_unlocked(taken? TR_BRANCH_T : TR_BRANCH_NT, f);
+    putDelta(pc, lastPc);
+    putVarint(zigzag(takenNpc - pc));
+    putVarint(notTakenNpc - pc);  // the fall-through is always after the branch
+}
+
+void TraceWriter::putVarint(uint64_t v) {
+    while (v >= 0x80) {
+        putc_unlocked((v & 0x7f) | 0x80, f);
+        v >>= 7;
+    }
+    putc_unlocked(v, f);
+}
+
+void TraceWriter::putDelta(uint64_t v, uint64_t& last) {
+    putVarint(zigzag(v - last));
+    last = v;
+}
+
+/* TraceReader */
+
+TraceReader::TraceReader(const char* path) : lastDataAddr(0), lastPc(0) {
+    f = fopen(path, "r");
+    if (!f) panic("Could not open trace %s", path);
+    setvbuf(f, nullptr, _IOFBF, TRACE_BUF_BYTES);
+    char magic[sizeof(TRACE_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) {
+        panic("%s is not a zsim trace", path);
+    }
+    int flags = getc_unlocked(f);
+    if (zinfo->oooDecode && !(flags & TRACE_OOO_UOPS)) {
+        panic("Trace %s was captured without OOO decoding, can't replay it on OOO cores", path);
+    }
+}
+
+TraceReader::~TraceReader() {
+    fclose(f);
+}
+
+bool TraceReader::next(Record& r) {
+    while (true) {
+        int tag = getc_unlocked(f);
+        switch (tag) {
+            case TraceWriter::TR_BBL_DEF: {
+                ADDRINT bblAddr = getVarint();
+                uint32_t bytes = getVarint();
+                // Bbls live for the whole simulation, as decoded ones do
+                BblInfo* bblInfo = static_cast<BblInfo*>(gm_malloc(bytes));
+                if (fread(bblInfo, 1, bytes, f) != bytes) panic("Truncated trace");
+                bbls.push_back(std::make_pair(bblAddr, bblInfo));
+                continue;
+            }
+            case TraceWriter::TR_BBL: {
+                uint64_t id = getVarint();
+                assert(id < bbls.size());
+                r.addr = bbls[id].first;
+                r.bblInfo = bbls[id].second;
+                break;
+            }
+            case TraceWriter::TR_LOAD:
+            case TraceWriter::TR_STORE:
+                r.addr = getDelta(lastDataAddr);
+                r.size = getVarint();
+                break;
+            case TraceWriter::TR_PRED_LOAD:
+            case TraceWriter::TR_PRED_STORE: {
+                r.addr = getDelta(lastDataAddr);
+                r.size = getVarint();
+                int pred = getc_unlocked(f);
+                if (pred == EOF) panic("Truncated trace");
+                r.pred = pred;
+                break;
+            }
+            case TraceWriter::TR_BRANCH_NT:
+            case TraceWriter::TR_BRANCH_T:
+                r.addr = getDelta(lastPc);
+                r.takenNpc = r.addr + unzigzag(getVarint());
+                r.notTakenNpc = r.addr + getVarint();
+                break;
+            case TraceWriter::TR_END:
+                return false;
+            default:
+                // A trace cut short (e.g., the capture run was killed) ends here too
+                if (tag != EOF) panic("Corrupted trace, tag %d", tag);
+                warn("Trace ended without an end record");
+                return false;
+        }
+        r.tag = (TraceWriter::RecordTag)tag;
+        return true;
+    }
+}
+
+uint64_t TraceReader::getVarint() {
+    uint64_t v = 0;
+    for (uint32_t shift = 0; ; shift += 7) {
+        int c = getc_unlocked(f);
+        if (c == EOF) panic("Truncated trace");
+        v |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return v;
+    }
+}
+
+uint64_t TraceReader::getDelta(uint64_t& last) {
+    last += unzigzag(getVarint());
+    return last;
+}
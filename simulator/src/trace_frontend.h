@@ -0,0 +1,108 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_FRONTEND_H_
+#define TRACE_FRONTEND_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "core.h"
+
+/* Record-once, replay-many instruction and address traces.
+ *
+ * With sim.traceCapture = <dir>, each thread of process 0 writes the stream
+ * its core is fed through InstrFuncPtrs (basic blocks, loads, stores and
+ * conditional branches) to <dir>/p0t<tid>.trace. Predicated loads and stores
+ * are recorded whether they execute or not, with their predicate, since cores
+ * expect an address for every memory uop. Only simulated code is
+ * recorded, not fast-forwarded code. Every BblInfo is stored the first time
+ * its thread runs it, including the OOO uops if the capture run decoded them,
+ * so replays need neither Pin's BBLs nor the decoder.
+ *
+ * With sim.traceReplay = <dir>, run misc/hooks/replay_host <dir> as the
+ * workload. Each of its threads calls zsim_replay_thread(i), which feeds trace
+ * i through the thread's fPtrs just as Pin analysis calls would, then returns.
+ * The workload itself never runs, so one capture serves any number of
+ * independent (and concurrent) replays against different memory systems.
+ * Replays with OOO cores need a trace captured with OOO decoding.
+ *
+ * Encoding: a tag byte per record, then LEB128 varints. Addresses are zigzag
+ * deltas from the previous address of the same kind, so strided accesses
+ * take 2-3 bytes.
+ */
+
+class TraceWriter {
+    public:
+        explicit TraceWriter(const char* path);
+        ~TraceWriter();  // writes the end record and closes the file
+
+        void bbl(ADDRINT bblAddr, BblInfo* bblInfo);
+        void load(ADDRINT addr, UINT32 size) {access(TR_LOAD, addr, size);}
+        void store(ADDRINT addr, UINT32 size) {access(TR_STORE, addr, size);}
+        void predLoad(ADDRINT addr, BOOL pred, UINT32 size) {access(TR_PRED_LOAD, addr, size); putc_unlocked(pred? 1 : 0, f);}
+        void predStore(ADDRINT addr, BOOL pred, UINT32 size) {access(TR_PRED_STORE, addr, size); putc_unlocked(pred? 1 : 0, f);}
+        void branch(ADDRINT pc, BOOL taken, ADDRINT takenNpc, ADDRINT notTakenNpc);
+
+        // Predicated accesses are tagged last, so traces without them read as before
+        enum RecordTag : uint8_t {TR_BBL_DEF, TR_BBL, TR_LOAD, TR_STORE, TR_BRANCH_NT, TR_BRANCH_T, TR_END, TR_PRED_LOAD, TR_PRED_STORE};
+
+    private:
+        FILE* f;
+        std::unordered_map<BblInfo*, uint32_t> bblIds;
+        uint64_t lastDataAddr, lastPc;
+
+        void access(RecordTag tag, ADDRINT addr, UINT32 size);
+        void putVarint(uint64_t v);
+        void putDelta(uint64_t v, uint64_t& last);
+};
+
+class TraceReader {
+    public:
+        struct Record {
+            TraceWriter::RecordTag tag;  // never TR_BBL_DEF, the reader consumes those
+            ADDRINT addr;  // bbl, data or branch address
+            UINT32 size;
+            BOOL pred;  // predicated accesses only
+            BblInfo* bblInfo;
+            ADDRINT takenNpc, notTakenNpc;
+        };
+
+        explicit TraceReader(const char* path);
+        ~TraceReader();
+
+        bool next(Record& r);  // false at the end of the trace
+
+    private:
+        FILE* f;
+        std::vector<std::pair<ADDRINT, BblInfo*>> bbls;
+        uint64_t lastDataAddr, lastPc;
+
+        uint64_t getVarint();
+        uint64_t getDelta(uint64_t& last);
+};
+
+#endif  // TRACE_FRONTEND_H_
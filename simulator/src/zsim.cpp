@@ -54,13 +54,20 @@
 #include "galloc.h"
 #include "init.h"
 #include "log.h"
+#include "phase_controller.h"
 #include "pin.H"
 #include "pin_cmd.h"
 #include "process_tree.h"
 #include "profile_stats.h"
+#include "ramulator_mem_ctrl.h"
+#include "rdtsc.h"
+#include "self_profiler.h"
+#include "Request.h"
 #include "scheduler.h"
 #include "stats.h"
+#include "synthetic_core.h"
 #include "trace_driver.h"
+#include "trace_frontend.h"
 #include "virt/virt.h"
 
 //#include <signal.h> //can't include this, conflicts with PIN's
@@ -148,7 +155,7 @@ VOID SimThreadStart(THREADID tid);
 VOID SimThreadFini(THREADID tid);
 VOID SimEnd();
 
-VOID HandleMagicOp(THREADID tid, ADDRINT op);
+VOID HandleMagicOp(THREADID tid, ADDRINT op, ADDRINT arg);
 
 VOID FakeCPUIDPre(THREADID tid, REG eax, REG ecx);
 VOID FakeCPUIDPost(THREADID tid, ADDRINT* eax, ADDRINT* ebx, ADDRINT* ecx, ADDRINT* edx); //REG* eax, REG* ebx, REG* ecx, REG* edx);
@@ -172,14 +179,17 @@ VOID FFThread(VOID* arg);
 InstrFuncPtrs fPtrs[MAX_THREADS] ATTR_LINE_ALIGNED; //minimize false sharing
 
 VOID PIN_FAST_ANALYSIS_CALL IndirectLoadSingle(THREADID tid, ADDRINT addr, UINT32 size) {
+    SelfProfScope sp(SelfProfiler::SP_LOADSTORE, getCid(tid));
     fPtrs[tid].loadPtr(tid, addr, size);
 }
 
 VOID PIN_FAST_ANALYSIS_CALL IndirectStoreSingle(THREADID tid, ADDRINT addr, UINT32 size) {
+    SelfProfScope sp(SelfProfiler::SP_LOADSTORE, getCid(tid));
     fPtrs[tid].storePtr(tid, addr, size);
 }
 
 VOID PIN_FAST_ANALYSIS_CALL IndirectBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
+    SelfProfScope sp(SelfProfiler::SP_BBL, getCid(tid));
     fPtrs[tid].bblPtr(tid, bblAddr, bblInfo);
 }
 
@@ -188,13 +198,159 @@ VOID PIN_FAST_ANALYSIS_CALL IndirectRecordBranch(THREADID tid, ADDRINT branchPc,
 }
 
 VOID PIN_FAST_ANALYSIS_CALL IndirectPredLoadSingle(THREADID tid, ADDRINT addr, BOOL pred, UINT32 size) {
+    SelfProfScope sp(SelfProfiler::SP_LOADSTORE, getCid(tid));
     fPtrs[tid].predLoadPtr(tid, addr, pred, size);
 }
 
 VOID PIN_FAST_ANALYSIS_CALL IndirectPredStoreSingle(THREADID tid, ADDRINT addr, BOOL pred, UINT32 size) {
+    SelfProfScope sp(SelfProfiler::SP_LOADSTORE, getCid(tid));
     fPtrs[tid].predStorePtr(tid, addr, pred, size);
 }
 
+/* Buffered memory instrumentation (sim.bufferedMemInstr). Loads and stores
+ * append their address to a per-thread buffer, with analysis routines simple
+ * enough for Pin to inline, and the next basic block hands the whole buffer to
+ * the core. Basic blocks with predicated accesses are not buffered (see
+ * BufferableAccesses). The core sees the same sequence as with
+ * per-access calls (bbl, its accesses, next bbl), with one indirect call per
+ * basic block instead of one per access.
+ */
+struct MemAccessBuffer {
+    UINT32 n;
+    BufferedAccess accs[MAX_BUFFERED_ACCESSES];
+} ATTR_LINE_ALIGNED;
+
+MemAccessBuffer memBufs[MAX_THREADS];
+
+VOID PIN_FAST_ANALYSIS_CALL BufferLoad(THREADID tid, ADDRINT addr, UINT32 size) {
+    BufferedAccess& a = memBufs[tid].accs[memBufs[tid].n++];
+    a.addr = addr;
+    a.size = size;
+    a.isStore = 0;
+}
+
+VOID PIN_FAST_ANALYSIS_CALL BufferStore(THREADID tid, ADDRINT addr, UINT32 size) {
+    BufferedAccess& a = memBufs[tid].accs[memBufs[tid].n++];
+    a.addr = addr;
+    a.size = size;
+    a.isStore = 1;
+}
+
+static inline void FlushMemBuffer(THREADID tid) {
+    MemAccessBuffer& b = memBufs[tid];
+    UINT32 n = b.n;
+    if (!n) return;
+    b.n = 0;
+    if (fPtrs[tid].memBatchPtr) {
+        fPtrs[tid].memBatchPtr(tid, b.accs, n);
+    } else {
+        // Reread the pointers on every access, the first one may join
+        for (UINT32 i = 0; i < n; i++) {
+            if (b.accs[i].isStore) fPtrs[tid].storePtr(tid, b.accs[i].addr, b.accs[i].size);
+            else fPtrs[tid].loadPtr(tid, b.accs[i].addr, b.accs[i].size);
+        }
+    }
+}
+
+VOID PIN_FAST_ANALYSIS_CALL BufferedBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
+    FlushMemBuffer(tid);
+    fPtrs[tid].bblPtr(tid, bblAddr, bblInfo);
+}
+
+/* Trace capture (sim.traceCapture, see trace_frontend.h). These wrap the
+ * indirect calls and are only inserted when capturing.
+ */
+TraceWriter* traceWriters[MAX_THREADS];
+
+static TraceWriter* GetTraceWriter(THREADID tid) {
+    // Only record what the core simulates (joining threads simulate this call)
+    if (fPtrs[tid].type == FPTR_NOP || fPtrs[tid].type == FPTR_RETRY || procIdx != 0) return nullptr;
+    if (!traceWriters[tid]) {
+        std::stringstream ss;
+        ss << zinfo->traceCapture << "/p" << procIdx << "t" << tid << ".trace";
+        traceWriters[tid] = new TraceWriter(ss.str().c_str());
+    }
+    return traceWriters[tid];
+}
+
+VOID PIN_FAST_ANALYSIS_CALL CaptureLoadSingle(THREADID tid, ADDRINT addr, UINT32 size) {
+    TraceWriter* tw = GetTraceWriter(tid);
+    if (tw) tw->load(addr, size);
+    fPtrs[tid].loadPtr(tid, addr, size);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL CaptureStoreSingle(THREADID tid, ADDRINT addr, UINT32 size) {
+    TraceWriter* tw = GetTraceWriter(tid);
+    if (tw) tw->store(addr, size);
+    fPtrs[tid].storePtr(tid, addr, size);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL CaptureBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
+    TraceWriter* tw = GetTraceWriter(tid);
+    if (tw) tw->bbl(bblAddr, bblInfo);
+    fPtrs[tid].bblPtr(tid, bblAddr, bblInfo);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL CaptureRecordBranch(THREADID tid, ADDRINT branchPc, BOOL taken, ADDRINT takenNpc, ADDRINT notTakenNpc) {
+    TraceWriter* tw = GetTraceWriter(tid);
+    if (tw) tw->branch(branchPc, taken, takenNpc, notTakenNpc);
+    fPtrs[tid].branchPtr(tid, branchPc, taken, takenNpc, notTakenNpc);
+}
+
+// Predicated accesses are recorded even if they don't execute, cores still expect them
+VOID PIN_FAST_ANALYSIS_CALL CapturePredLoadSingle(THREADID tid, ADDRINT addr, BOOL pred, UINT32 size) {
+    TraceWriter* tw = GetTraceWriter(tid);
+    if (tw) tw->predLoad(addr, pred, size);
+    fPtrs[tid].predLoadPtr(tid, addr, pred, size);
+}
+
+VOID PIN_FAST_ANALYSIS_CALL CapturePredStoreSingle(THREADID tid, ADDRINT addr, BOOL pred, UINT32 size) {
+    TraceWriter* tw = GetTraceWriter(tid);
+    if (tw) tw->predStore(addr, pred, size);
+    fPtrs[tid].predStorePtr(tid, addr, pred, size);
+}
+
+static void CloseTraceWriter(THREADID tid) {
+    delete traceWriters[tid];
+    traceWriters[tid] = nullptr;
+}
+
+// Feeds a captured trace through tid's fPtrs, as Pin analysis calls would
+static void ReplayTrace(THREADID tid, ADDRINT traceIdx) {
+    if (!zinfo->traceReplay) panic("Thread %d: zsim_replay_thread() needs sim.traceReplay", tid);
+    std::stringstream ss;
+    ss << zinfo->traceReplay << "/p0t" << traceIdx << ".trace";
+    info("Thread %d replaying %s", tid, ss.str().c_str());
+
+    TraceReader tr(ss.str().c_str());
+    TraceReader::Record r;
+    while (tr.next(r)) {
+        switch (r.tag) {
+            case TraceWriter::TR_BBL:
+                fPtrs[tid].bblPtr(tid, r.addr, r.bblInfo);
+                break;
+            case TraceWriter::TR_LOAD:
+                fPtrs[tid].loadPtr(tid, r.addr, r.size);
+                break;
+            case TraceWriter::TR_STORE:
+                fPtrs[tid].storePtr(tid, r.addr, r.size);
+                break;
+            case TraceWriter::TR_PRED_LOAD:
+                fPtrs[tid].predLoadPtr(tid, r.addr, r.pred, r.size);
+                break;
+            case TraceWriter::TR_PRED_STORE:
+                fPtrs[tid].predStorePtr(tid, r.addr, r.pred, r.size);
+                break;
+            case TraceWriter::TR_BRANCH_NT:
+            case TraceWriter::TR_BRANCH_T:
+                fPtrs[tid].branchPtr(tid, r.addr, r.tag == TraceWriter::TR_BRANCH_T, r.takenNpc, r.notTakenNpc);
+                break;
+            default:
+                panic("Unexpected trace record %d", r.tag);
+        }
+    }
+}
+
 
 //Non-simulation variants of analysis functions
 
@@ -317,7 +473,7 @@ VOID FFITrackNFFInterval() {
         *_ffiPrevFFStartInstrs = *_ffiFFStartInstrs;
         *_ffiFFStartInstrs = zinfo->processStats->getProcessInstrs(p);
     };
-    zinfo->eventQueue->insert(makeAdaptiveEvent(ffiGet, ffiFire, 0, ffiInstrsLimit - ffiInstrsDone, MAX_IPC*zinfo->phaseLength));
+    zinfo->eventQueue->insert(makeAdaptiveEvent(ffiGet, ffiFire, 0, ffiInstrsLimit - ffiInstrsDone, MAX_IPC*zinfo->maxPhaseLength));
 
     ffiNFF = true;
 }
@@ -509,6 +665,7 @@ VOID CheckForTermination() {
  */
 VOID EndOfPhaseActions() {
     zinfo->profSimTime->transition(PROF_WEAVE);
+    if (zinfo->selfProf) zinfo->selfProf->startEndOfPhase();
     if (zinfo->globalPauseFlag) {
         info("Simulation entering global pause");
         zinfo->profSimTime->transition(PROF_FF);
@@ -534,12 +691,19 @@ VOID EndOfPhaseActions() {
     CheckForTermination();
     zinfo->contentionSim->simulatePhase(zinfo->globPhaseCycles + zinfo->phaseLength);
     zinfo->eventQueue->tick();
+    if (zinfo->selfProf) zinfo->selfProf->endEndOfPhase();
     zinfo->profSimTime->transition(PROF_BOUND);
 }
 
 
 uint32_t TakeBarrier(uint32_t tid, uint32_t cid) {
+    uint64_t barrierStart = 0;
+    if (zinfo->selfProf) {
+        zinfo->selfProf->leaveCore(cid);
+        barrierStart = rdtsc();
+    }
     uint32_t newCid = zinfo->sched->sync(procIdx, tid, cid);
+    if (zinfo->selfProf) zinfo->selfProf->barrier(rdtsc() - barrierStart);
     clearCid(tid); //this is after the sync for a hack needed to make EndOfPhase reliable
     setCid(tid, newCid);
 
@@ -572,16 +736,37 @@ static void PrintIp(THREADID tid, ADDRINT ip) {
 }
 #endif
 
-VOID Instruction(INS ins) {
+// Number of memory accesses a basic block buffers, or (uint32_t)-1 if it has predicated ones. Those keep
+// their immediate IARG_EXECUTING calls, so buffering the rest would let them reach the core out of order
+static uint32_t BufferableAccesses(BBL bbl) {
+    uint32_t accs = 0;
+    for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
+        uint32_t insAccs = INS_IsMemoryRead(ins) + INS_HasMemoryRead2(ins) + INS_IsMemoryWrite(ins);
+        if (insAccs && INS_IsPredicated(ins)) return (uint32_t)-1;
+        accs += insAccs;
+    }
+    return accs;
+}
+
+VOID Instruction(INS ins, bool bufferMem) {
     //Uncomment to print an instruction trace
     //INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)PrintIp, IARG_THREAD_ID, IARG_REG_VALUE, REG_INST_PTR, IARG_END);
 
     if (!procTreeNode->isInFastForward() || !zinfo->ffReinstrument ) {
-        AFUNPTR LoadFuncPtr = (AFUNPTR) IndirectLoadSingle;
-        AFUNPTR StoreFuncPtr = (AFUNPTR) IndirectStoreSingle;
+        AFUNPTR LoadFuncPtr = bufferMem? (AFUNPTR) BufferLoad : (AFUNPTR) IndirectLoadSingle;
+        AFUNPTR StoreFuncPtr = bufferMem? (AFUNPTR) BufferStore : (AFUNPTR) IndirectStoreSingle;
 
         AFUNPTR PredLoadFuncPtr = (AFUNPTR) IndirectPredLoadSingle;
         AFUNPTR PredStoreFuncPtr = (AFUNPTR) IndirectPredStoreSingle;
+        AFUNPTR BranchFuncPtr = (AFUNPTR) IndirectRecordBranch;
+
+        if (zinfo->traceCapture) {
+            LoadFuncPtr = (AFUNPTR) CaptureLoadSingle;
+            StoreFuncPtr = (AFUNPTR) CaptureStoreSingle;
+            PredLoadFuncPtr = (AFUNPTR) CapturePredLoadSingle;
+            PredStoreFuncPtr = (AFUNPTR) CapturePredStoreSingle;
+            BranchFuncPtr = (AFUNPTR) CaptureRecordBranch;
+        }
 
         if (INS_IsMemoryRead(ins)) {
             if (!INS_IsPredicated(ins)) {
@@ -609,7 +794,7 @@ VOID Instruction(INS ins) {
 
         // Instrument only conditional branches
         if (INS_Category(ins) == XED_CATEGORY_COND_BR && !INS_IsXend(ins)) {
-            INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR) IndirectRecordBranch, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID,
+            INS_InsertCall(ins, IPOINT_BEFORE, BranchFuncPtr, IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID,
                     IARG_INST_PTR, IARG_BRANCH_TAKEN, IARG_BRANCH_TARGET_ADDR, IARG_FALLTHROUGH_ADDR, IARG_END);
         }
     }
@@ -621,7 +806,7 @@ VOID Instruction(INS ins) {
      */
     if (INS_IsXchg(ins) && INS_OperandReg(ins, 0) == LEVEL_BASE::REG_RCX && INS_OperandReg(ins, 1) == LEVEL_BASE::REG_RCX) {
         //info("Instrumenting magic op");
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR) HandleMagicOp, IARG_THREAD_ID, IARG_REG_VALUE, REG_ECX, IARG_END);
+        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR) HandleMagicOp, IARG_THREAD_ID, IARG_REG_VALUE, REG_ECX, IARG_REG_VALUE, LEVEL_BASE::REG_RDX, IARG_END);
     }
 
     if (INS_Opcode(ins) == XED_ICLASS_CPUID) {
@@ -645,15 +830,19 @@ VOID Trace(TRACE trace, VOID *v) {
         // Visit every basic block in the trace
         for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
             BblInfo* bblInfo = Decoder::decodeBbl(bbl, zinfo->oooDecode, zinfo->acceleratorDecode);
-            BBL_InsertCall(bbl, IPOINT_BEFORE /*could do IPOINT_ANYWHERE if we redid load and store simulation in OOO*/, (AFUNPTR)IndirectBasicBlock, IARG_FAST_ANALYSIS_CALL,
+            // With buffering, every bbl flushes the previous one's accesses
+            AFUNPTR bblFuncPtr = zinfo->bufferedMemInstr? (AFUNPTR)BufferedBasicBlock : (AFUNPTR)IndirectBasicBlock;
+            if (zinfo->traceCapture) bblFuncPtr = (AFUNPTR)CaptureBasicBlock;
+            BBL_InsertCall(bbl, IPOINT_BEFORE /*could do IPOINT_ANYWHERE if we redid load and store simulation in OOO*/, bblFuncPtr, IARG_FAST_ANALYSIS_CALL,
                  IARG_THREAD_ID, IARG_ADDRINT, BBL_Address(bbl), IARG_PTR, bblInfo, IARG_END);
         }
     }
 
     //Instruction instrumentation now here to ensure proper ordering
     for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+        bool bufferMem = zinfo->bufferedMemInstr && BufferableAccesses(bbl) <= MAX_BUFFERED_ACCESSES;
         for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
-            Instruction(ins);
+            Instruction(ins, bufferMem);
         }
     }
 }
@@ -925,6 +1114,8 @@ VOID SimThreadFini(THREADID tid) {
 
 VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 flags, VOID *v) {
     //NOTE: Thread has no valid cid here!
+    memBufs[tid].n = 0;  // the last accesses have no core to go to
+    CloseTraceWriter(tid);
     if (fPtrs[tid].type == FPTR_NOP) {
         //info("Shadow/NOP thread %d finished", tid);
         return;
@@ -936,6 +1127,7 @@ VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 flags, VOID *v) {
 
 //Need to remove ourselves from running threads in case the syscall is blocking
 VOID SyscallEnter(THREADID tid, CONTEXT *ctxt, SYSCALL_STANDARD std, VOID *v) {
+    FlushMemBuffer(tid);  // while we still hold the core
     bool isNopThread = fPtrs[tid].type == FPTR_NOP;
     bool isRetryThread = fPtrs[tid].type == FPTR_RETRY;
 
@@ -1148,6 +1340,7 @@ VOID SimEnd() {
     //at this point, we're in charge of exiting our whole process, but we still need to race for the stats
 
     //per-process
+    for (uint32_t tid = 0; tid < MAX_THREADS; tid++) CloseTraceWriter(tid);
 #ifdef BBL_PROFILING
     Decoder::dumpBblProfile();
 #endif
@@ -1194,8 +1387,76 @@ VOID SimEnd() {
 #define ZSIM_MAGIC_OP_HEARTBEAT         (1028)
 #define ZSIM_MAGIC_OP_FUNCTION_BEGIN    (1031)
 #define ZSIM_MAGIC_OP_FUNCTION_END      (1032)
+#define ZSIM_MAGIC_OP_PLACE_CORE        (1033)
+#define ZSIM_MAGIC_OP_PLACE_VAULT       (1034)
+#define ZSIM_MAGIC_OP_PLACE_INTERLEAVE  (1035)
+#define ZSIM_MAGIC_OP_ATOMIC_RANGE      (1036)
+#define ZSIM_MAGIC_OP_REPLAY_THREAD     (1037)
+
+// Argument of the placement ops, passed by address in rdx (zsim_placement_t in zsim_hooks.h)
+struct MagicPlacement {
+    uint64_t start;
+    uint64_t size;
+    uint64_t target;  // core, vault, or interleaving granularity in bytes (0 = line size)
+};
+
+static void HandlePlacementOp(THREADID tid, ADDRINT op, ADDRINT arg) {
+    MagicPlacement mp;
+    if (PIN_SafeCopy(&mp, (const VOID*)arg, sizeof(mp)) != sizeof(mp)) {
+        warn("Thread %d: ignoring placement magic op, argument 0x%lx is not readable", tid, arg);
+        return;
+    }
+    if (!zinfo->ramulator_memory) {
+        static bool warned = false;
+        if (!warned) warn("Placement magic ops only affect Ramulator memories, ignoring them");
+        warned = true;
+        return;
+    }
+    if (mp.size == 0) return;
+
+    ramulator::Placement placement;
+    switch (op) {
+        case ZSIM_MAGIC_OP_PLACE_CORE: placement.type = ramulator::Placement::Type::Core; break;
+        case ZSIM_MAGIC_OP_PLACE_VAULT: placement.type = ramulator::Placement::Type::Vault; break;
+        default:
+            placement.type = ramulator::Placement::Type::Interleave;
+            if (mp.target == 0) mp.target = zinfo->lineSize;
+    }
+    placement.start = mp.start;
+    placement.size = mp.size;
+    placement.target = mp.target;
+    zinfo->ramulator->addPlacement(placement);
+}
+
+// Argument of the atomic range op (zsim_atomic_range_t in zsim_hooks.h)
+struct MagicAtomicRange {
+    uint64_t start;
+    uint64_t size;
+    uint64_t op;  // in ramulator::Request::AtomicOp order
+};
 
-VOID HandleMagicOp(THREADID tid, ADDRINT op) {
+static void HandleAtomicRangeOp(THREADID tid, ADDRINT arg) {
+    MagicAtomicRange mr;
+    if (PIN_SafeCopy(&mr, (const VOID*)arg, sizeof(mr)) != sizeof(mr)) {
+        warn("Thread %d: ignoring atomic range magic op, argument 0x%lx is not readable", tid, arg);
+        return;
+    }
+    if (!zinfo->ramulator_memory || !zinfo->ramulator->supportsAtomics()) {
+        static bool warned = false;
+        if (!warned) warn("Near-memory atomics need a Ramulator HMC memory, ignoring atomic ranges");
+        warned = true;
+        return;
+    }
+    if (mr.op >= (uint64_t)ramulator::Request::AtomicOp::MAX) {
+        warn("Thread %d: ignoring atomic range with invalid op %ld", tid, mr.op);
+        return;
+    }
+    if (mr.size == 0) return;
+    zinfo->ramulator->addAtomicRange(mr.start, mr.size, mr.op);
+}
+
+VOID HandleMagicOp(THREADID tid, ADDRINT op, ADDRINT arg) {
+    FlushMemBuffer(tid);  // magic ops may switch fPtrs, so accesses before them use the old ones
     //std::cout << "HandleMagicOp: " << op << std::endl;
     switch (op) {
         case ZSIM_MAGIC_OP_ROI_BEGIN:
@@ -1265,6 +1526,17 @@ VOID HandleMagicOp(THREADID tid, ADDRINT op) {
             //cerr  << "@zsim.cpp - Offload end \n";
             fPtrs[tid].OffloadEnd(tid);
             return;
+        case ZSIM_MAGIC_OP_PLACE_CORE:
+        case ZSIM_MAGIC_OP_PLACE_VAULT:
+        case ZSIM_MAGIC_OP_PLACE_INTERLEAVE:
+            HandlePlacementOp(tid, op, arg);
+            return;
+        case ZSIM_MAGIC_OP_ATOMIC_RANGE:
+            HandleAtomicRangeOp(tid, arg);
+            return;
+        case ZSIM_MAGIC_OP_REPLAY_THREAD:
+            ReplayTrace(tid, arg);
+            return;
         // HACK: Ubik magic ops
         case 1029:
         case 1030:
@@ -1634,9 +1906,27 @@ int main(int argc, char *argv[]) {
             EndOfPhaseActions();
             zinfo->numPhases++;
             zinfo->globPhaseCycles += zinfo->phaseLength;
+            if (zinfo->phaseController) zinfo->phaseController->endPhase();
         }
         info("Finished trace-driven simulation");
         SimEnd();
+    } else if (zinfo->syntheticDriven) {
+        info("Running synthetic simulation, %d cores", zinfo->numCores);
+        for (uint32_t cid = 0; cid < zinfo->numCores; cid++) zinfo->cores[cid]->join();
+        bool running = true;
+        while (!zinfo->terminationConditionMet && running) {
+            running = false;
+            for (uint32_t cid = 0; cid < zinfo->numCores; cid++) {
+                running |= static_cast<SyntheticCore*>(zinfo->cores[cid])->runPhase();
+            }
+            // Even if all cores are done, simulate their last phase
+            EndOfPhaseActions();
+            zinfo->numPhases++;
+            zinfo->globPhaseCycles += zinfo->phaseLength;
+            if (zinfo->phaseController) zinfo->phaseController->endPhase();
+        }
+        info("Finished synthetic simulation");
+        SimEnd();
     } else {
         // Never returns
         PIN_StartProgram();
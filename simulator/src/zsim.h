@@ -45,6 +45,8 @@ class ProcessStats;
 class ProcStats;
 class EventQueue;
 class ContentionSim;
+class PhaseController;
+class SelfProfiler;
 class EventRecorder;
 class PinCmd;
 class PortVirtualizer;
@@ -93,11 +95,15 @@ struct GlobSimInfo {
     uint32_t numDomains;
     ContentionSim* contentionSim;
     EventRecorder** eventRecorders; //CID->EventRecorder* array
+    PhaseController* phaseController; //nullptr unless phases are adaptive
+    SelfProfiler* selfProf; //nullptr unless sim.selfProfile
 
     PAD();
 
     //World-readable
-    uint32_t phaseLength;
+    uint32_t phaseLength; //of the current phase; fixed unless phases are adaptive (sim.adaptivePhases)
+    uint32_t nextPhaseLength; //of the following one, see PhaseController
+    uint32_t maxPhaseLength;
     uint32_t statsPhaseInterval;
     uint32_t freqMHz;
 
@@ -120,7 +126,7 @@ struct GlobSimInfo {
 
     //Writable, rarely read, unshared in a single phase
     uint64_t numPhases;
-    uint64_t globPhaseCycles; //just numPhases*phaseCycles. It behooves us to precompute it, since it is very frequently used in tracing code.
+    uint64_t globPhaseCycles; //just numPhases*phaseCycles (the sum of past phase lengths, if adaptive). It behooves us to precompute it, since it is very frequently used in tracing code.
 
     uint64_t procEventualDumps;
 
@@ -174,6 +180,9 @@ struct GlobSimInfo {
 
     struct LibInfo libzsimAddrs;
 
+    const char* traceCapture; //if set, directory where threads record what they simulate (see trace_frontend.h)
+    const char* traceReplay; //if set, directory of the traces zsim_replay_thread() replays
+    bool bufferedMemInstr; //true if loads and stores are buffered per basic block instead of simulated with one analysis call each
     bool ffReinstrument; //true if we should reinstrument on ffwd, works fine with ST apps and it's faster since we run with basically no instrumentation, but it's not precise with MT apps
 
     //fftoggle stuff
@@ -189,6 +198,9 @@ struct GlobSimInfo {
     bool traceDriven;
     TraceDriver* traceDriver;
 
+    // Synthetic-core simulation (no application, see synthetic_core.h)
+    bool syntheticDriven;
+
     bool ramulator_memory = false;
     Ramulator  *ramulator;
     std::string application;
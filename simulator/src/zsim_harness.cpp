@@ -204,7 +204,7 @@ static uint64_t lastCycles = 0;
 string application_name;
 
 static void printHeartbeat(GlobSimInfo* zinfo) {
-    uint64_t cycles = zinfo->numPhases*zinfo->phaseLength;
+    uint64_t cycles = zinfo->globPhaseCycles;
     time_t curTime = time(nullptr);
     time_t elapsedSecs = curTime - startTime;
     time_t heartbeatSecs = curTime - lastHeartbeatTime;